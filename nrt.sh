@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# processes the scenes of one tile and year as they land, i.e. one pass of
+# the watcher, e.g.
+#   ${bin_dir}/watcher -l ${cube_dir} -c "./nrt.sh {tile} {year} {files}" -p SEN2
+# the indices of the new BOA images are computed, then the disturbances of
+# the year are detected again from all indices of the year, see stage.sh;
+# the reference period of the year before must exist, e.g. from workflow.sh
+
+tile=$1
+this_year=$2
+
+out_dir="$HOME/temp/beetle-with-reverse-5/${tile}"
+
+bin_dir="src/temp/bin"
+
+# a failed pass is retried by the watcher, only redo what changed
+incremental="-f stat"
+
+set -e
+
+if [ $# -lt 3 ]; then
+  echo "Usage: $0 tile year boa-image(s)" >&2
+  exit 1
+fi
+
+shift 2
+
+prev_year=$((this_year - 1))
+
+${bin_dir}/spectral_index -j 64 ${incremental} \
+  -x ${out_dir}/mask_${prev_year}.tif \
+  -d ${out_dir} \
+  "$@"
+
+$(dirname $0)/stage.sh disturbance_detection ${tile} ${this_year}
@@ -0,0 +1,59 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file parses command line arguments for client
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#include "args_client.h"
+
+void usage(char *exe, int exit_code){
+  printf("Usage: %s -s socket stage [arguments]\n", exe);
+  printf("\n");
+  printf("  -s = Unix domain socket of a server\n");
+  printf("\n");
+  printf("  stage and arguments, as if the stage executable was called, e.g.\n");
+  printf("  %s -s socket spectral_index -j 8 -x mask.tif -d out *BOA.tif\n", exe);
+  printf("  the stage writes to the standard output and error of the client,\n");
+  printf("  and the client exits with the exit status of the stage\n");
+  printf("\n");
+  exit(exit_code);
+  return;
+}
+
+void parse_args(int argc, char *argv[], args_t *args){
+  int opt, received_n = 0, expected_n = 1;
+  opterr = 0;
+
+  // options after the stage are the stage's
+  while ((opt = getopt(argc, argv, "+s:")) != -1){
+    switch(opt){
+      case 's':
+        copy_string(args->socket, STRLEN, optarg);
+        received_n++;
+        break;
+      case '?':
+        if (isprint(optopt)){
+          fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+        } else {
+          fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+        }
+        usage(argv[0], FAILURE);
+      default:
+        fprintf(stderr, "Error parsing arguments.\n");
+        usage(argv[0], FAILURE);
+    }
+  }
+
+  if (received_n != expected_n){
+    fprintf(stderr, "Not all arguments received.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (optind >= argc){
+    fprintf(stderr, "No stage given.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  args->argc = argc - optind;
+  args->argv = argv + optind;
+
+  return;
+}
@@ -0,0 +1,34 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Argument parsing header for client
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#ifndef ARGS_CLIENT_H
+#define ARGS_CLIENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <ctype.h>
+
+#include "../utils/const.h"
+#include "../utils/string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  char socket[STRLEN];
+  int argc;
+  char **argv;
+} args_t;
+
+void usage(char *exe, int exit_code);
+void parse_args(int argc, char *argv[], args_t *args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,11 +5,17 @@ This file parses command line arguments for combine_disturbances
 #include "args_combine_disturbances.h"
 
 void usage(char *exe, int exit_code){
-  printf("Usage: %s -j cpus -o output-image input-image(s)\n", exe);
+  printf("Usage: %s -j cpus -o output-image [-b block-rows] [-f mode] input-image(s)\n", exe);
   printf("\n");
   printf("  -j = number of CPUs to use\n");
   printf("\n");
   printf("  -o = output image\n");
+  printf("  -b = optional number of rows per processing block (default: 256)\n");
+  printf("  -f = optional incremental mode, stat or hash (default: always run), the\n");
+  printf("       run is skipped if the manifests of all outputs (output.manifest)\n");
+  printf("       match the parameters and inputs, i.e. no input changed in size or\n");
+  printf("       modification time (stat), or in content (hash), outputs that are\n");
+  printf("       not up to date are overwritten; the manifests are written in any mode\n");
   printf("\n");
   printf("  input-image(s) = one or more input images to compute temporal variability from\n");
   printf("\n");
@@ -21,7 +27,11 @@ void parse_args(int argc, char *argv[], args_t *args){
   int opt, received_n = 0, expected_n = 2;
   opterr = 0;
 
-  while ((opt = getopt(argc, argv, "j:o:")) != -1){
+  // optional arguments
+  args->incremental = _MANIFEST_OFF_;
+  args->block_rows = 256;
+
+  while ((opt = getopt(argc, argv, "j:o:b:f:")) != -1){
     switch(opt){
       case 'j':
         args->n_cpus = atoi(optarg);
@@ -31,6 +41,15 @@ void parse_args(int argc, char *argv[], args_t *args){
         copy_string(args->path_output, STRLEN, optarg);
         received_n++;
         break;
+      case 'b':
+        args->block_rows = atoi(optarg);
+        break;
+      case 'f':
+        if ((args->incremental = manifest_mode(optarg)) < 0){
+          fprintf(stderr, "Unknown incremental mode %s.\n", optarg);
+          usage(argv[0], FAILURE);
+        }
+        break;
       case '?':
         if (isprint(optopt)){
           fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -63,7 +82,7 @@ void parse_args(int argc, char *argv[], args_t *args){
     }
   }
   
-  if (fileexist(args->path_output)){
+  if (args->incremental == _MANIFEST_OFF_ && fileexist(args->path_output)){
     fprintf(stderr, "Output file %s already exists.\n", args->path_output);
     usage(argv[0], FAILURE);
   }
@@ -73,5 +92,10 @@ void parse_args(int argc, char *argv[], args_t *args){
     usage(argv[0], FAILURE);
   }
 
+  if (args->block_rows < 1){
+    fprintf(stderr, "Number of rows per block must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
   return;
 }
@@ -13,6 +13,7 @@ Argument parsing header for combine_disturbances
 #include "../utils/alloc.h"
 #include "../utils/const.h"
 #include "../utils/dir.h"
+#include "../utils/manifest.h"
 #include "../utils/string.h"
 
 #ifdef __cplusplus
@@ -22,8 +23,10 @@ extern "C" {
 typedef struct {
   int n_cpus;
   int n_images;
+  int block_rows;
   char **path_input;
   char path_output[STRLEN];
+  int incremental;
 } args_t;
 
 void usage(char *exe, int exit_code);
@@ -0,0 +1,141 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file parses command line arguments for coordinator
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#include "args_coordinator.h"
+
+void usage(char *exe, int exit_code){
+  printf("Usage: %s -q queue -y year -e last-year -s stages\n", exe);
+  printf("          [-a attempts] [-w] [-i seconds] tile-1 tile-2 ...\n");
+  printf("\n");
+  printf("  -q = queue file on a file system shared by all nodes, created if it\n");
+  printf("       does not exist, workers lease the jobs from there, see worker\n");
+  printf("  -y = first year\n");
+  printf("  -e = last year\n");
+  printf("  -s = comma-separated list of stages, e.g. reference_period,spectral_index\n");
+  printf("       one job is enqueued per tile, year and stage, in this order; the\n");
+  printf("       jobs of a tile run one after another, those of different tiles\n");
+  printf("       run concurrently\n");
+  printf("\n");
+  printf("  -a = optional number of attempts before a job fails (default: 3), a job\n");
+  printf("       is retried when its command fails or its lease expires; when a job\n");
+  printf("       fails, the later jobs of its tile are skipped\n");
+  printf("  -w = optional, wait until all jobs are finished and print the queue,\n");
+  printf("       fails if a job failed\n");
+  printf("  -i = optional polling interval in seconds for -w (default: 10)\n");
+  printf("\n");
+  printf("  tile-1 tile-2 ... = tiles to process\n");
+  printf("\n");
+  printf("  tile and stage names only contain A-Z, a-z, 0-9, _, . and -, since\n");
+  printf("  the workers paste them into a shell command\n");
+  printf("\n");
+  printf("  jobs that are already queued are not enqueued again, failed and skipped\n");
+  printf("  jobs are retried, i.e. the coordinator can be re-run after fixing a fault\n");
+  printf("\n");
+  exit(exit_code);
+  return;
+}
+
+void parse_args(int argc, char *argv[], args_t *args){
+  int opt, received_n = 0, expected_n = 4;
+  char stages[STRLEN];
+  char *ptr = NULL, *saveptr = NULL;
+  opterr = 0;
+
+  // optional arguments
+  args->max_attempts = 3;
+  args->wait = false;
+  args->poll = 10;
+
+  while ((opt = getopt(argc, argv, "q:y:e:s:a:wi:")) != -1){
+    switch(opt){
+      case 'q':
+        copy_string(args->queue, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'y':
+        args->year = atoi(optarg);
+        received_n++;
+        break;
+      case 'e':
+        args->last_year = atoi(optarg);
+        received_n++;
+        break;
+      case 's':
+        copy_string(stages, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'a':
+        args->max_attempts = atoi(optarg);
+        break;
+      case 'w':
+        args->wait = true;
+        break;
+      case 'i':
+        args->poll = atoi(optarg);
+        break;
+      case '?':
+        if (isprint(optopt)){
+          fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+        } else {
+          fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+        }
+        usage(argv[0], FAILURE);
+      default:
+        fprintf(stderr, "Error parsing arguments.\n");
+        usage(argv[0], FAILURE);
+    }
+  }
+
+  if (received_n != expected_n){
+    fprintf(stderr, "Not all arguments received.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if ((args->n_tiles = argc - optind) < 1){
+    fprintf(stderr, "No tiles given.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  alloc_2D((void***)&args->tiles, args->n_tiles, _JOB_NAMELEN_, sizeof(char));
+  for (int i=0; i<args->n_tiles; i++){
+    if (!job_name_valid(argv[optind + i], _JOB_NAMELEN_)){
+      fprintf(stderr, "Tile name %s is too long, or contains characters other than A-Z, a-z, 0-9, _, . and -.\n", argv[optind + i]);
+      usage(argv[0], FAILURE);
+    }
+    copy_string(args->tiles[i], _JOB_NAMELEN_, argv[optind + i]);
+  }
+
+  args->n_stages = 0;
+  alloc_2D((void***)&args->stages, STRLEN / 2, _JOB_NAMELEN_, sizeof(char));
+
+  for (ptr = strtok_r(stages, ",", &saveptr); ptr != NULL; ptr = strtok_r(NULL, ",", &saveptr)){
+    if (!job_name_valid(ptr, _JOB_NAMELEN_)){
+      fprintf(stderr, "Stage name %s is too long, or contains characters other than A-Z, a-z, 0-9, _, . and -.\n", ptr);
+      usage(argv[0], FAILURE);
+    }
+    copy_string(args->stages[args->n_stages++], _JOB_NAMELEN_, ptr);
+  }
+
+  if (args->n_stages < 1){
+    fprintf(stderr, "No stages given.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->year < 1971 || args->year > 2100 || args->last_year < args->year || args->last_year > 2100){
+    fprintf(stderr, "years must be between 1971 and 2100, and the last year must not be before the first year.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->max_attempts < 1){
+    fprintf(stderr, "Number of attempts must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->poll < 1){
+    fprintf(stderr, "Polling interval must be at least 1 second.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  return;
+}
@@ -0,0 +1,43 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Argument parsing header for coordinator
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#ifndef ARGS_COORDINATOR_H
+#define ARGS_COORDINATOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <ctype.h>
+
+#include "../utils/alloc.h"
+#include "../utils/const.h"
+#include "../utils/string.h"
+#include "../utils/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  char queue[STRLEN];
+  int year;
+  int last_year;
+  int n_stages;
+  char **stages;
+  int n_tiles;
+  char **tiles;
+  int max_attempts;
+  bool wait;
+  int poll;
+} args_t;
+
+void usage(char *exe, int exit_code);
+void parse_args(int argc, char *argv[], args_t *args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
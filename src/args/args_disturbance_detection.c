@@ -7,6 +7,9 @@ This file parses command line arguments for disturbance detection
 void usage(char *exe, int exit_code){
   printf("Usage: %s -j cpus -c coefficient-image -s variability-image -x mask-image -o output-image\n", exe);
   printf("          -m modes -t trend -d threshold_variability -r threshold_residual -n confirmation-number\n");
+  printf("          [-b opposite-output-image] [-e event-list] [-a alert-log]\n");
+  printf("          [-p previous-state-image] [-w state-image] [-l] [-f mode]\n");
+  printf("          [-u next-mask-image] [-i combined-input-image] [-k combined-output-image]\n");
   printf("          input-image(s)\n");
   printf("\n");
   printf("  -j = number of CPUs to use\n");
@@ -15,12 +18,37 @@ void usage(char *exe, int exit_code){
   printf("  -c = path to coefficients\n");
   printf("  -s = path to statistics\n");
   printf("  -o = output file (.tif)\n");
+  printf("  -b = optional output file (.tif) for anomalies in the opposite direction of -r,\n");
+  printf("       both directions are tracked in the same pass\n");
+  printf("  -e = optional sparse event list (.csv for text, binary otherwise)\n");
+  printf("  -a = optional append-only alert log, raised, confirmed and reverted alerts\n");
+  printf("       newer than the latest logged date are appended (index: alert-log.idx)\n");
+  printf("\n");
+  printf("  -p = optional detection state of a previous run (rolling-window mode)\n");
+  printf("  -w = optional output detection state (rolling-window mode)\n");
+  printf("       in rolling-window mode, input images may span several years, and\n");
+  printf("       images already processed in the previous run are skipped. Alerts\n");
+  printf("       that are still active keep using the coefficients of the previous run\n");
+  printf("\n");  
+  printf("  -u = optional mask for the next year, disturbed pixels are removed from\n");
+  printf("       the mask (same as update_mask)\n");
+  printf("  -k = optional combined disturbance image, the disturbances of this run are\n");
+  printf("       merged into the combined image of -i (same as combine_disturbances)\n");
+  printf("  -i = optional combined disturbance image of the previous run, to be used\n");
+  printf("       with -k, if not given, the combined image starts with this run\n");
   printf("\n");  
   printf("  -m = number of modes for fitting the harmonic model (1-3)\n");
   printf("  -t = use trend coefficient when fitting the harmonic model? (0 = no, 1 = yes)\n");
   printf("  -d = standard deviation threshold\n");
   printf("  -r = minimum residuum threshold\n");
   printf("  -n = number of consecutive observations to detect disturbance event\n");
+  printf("  -l = optional, use int16 baseline tables per DOY instead of predicting\n");
+  printf("       each observation (faster, predictions are rounded to integers)\n");
+  printf("  -f = optional incremental mode, stat or hash (default: always run), the\n");
+  printf("       run is skipped if the manifests of all outputs (output.manifest)\n");
+  printf("       match the parameters and inputs, i.e. no input changed in size or\n");
+  printf("       modification time (stat), or in content (hash), outputs that are\n");
+  printf("       not up to date are overwritten; the manifests are written in any mode\n");
   printf("\n");
   printf("  input-image(s) = input images to compute disturbances from\n");
   printf("\n");
@@ -32,7 +60,19 @@ void parse_args(int argc, char *argv[], args_t *args){
   int opt, received_n = 0, expected_n = 10;
   opterr = 0;
 
-  while ((opt = getopt(argc, argv, "j:c:s:o:m:t:d:r:n:x:")) != -1){
+  // optional arguments
+  args->incremental = _MANIFEST_OFF_;
+  args->path_output_opposite[0] = '\0';
+  args->path_events[0] = '\0';
+  args->path_alerts[0] = '\0';
+  args->path_state_input[0] = '\0';
+  args->path_state_output[0] = '\0';
+  args->path_output_mask[0] = '\0';
+  args->path_combined_input[0] = '\0';
+  args->path_combined_output[0] = '\0';
+  args->lookup = false;
+
+  while ((opt = getopt(argc, argv, "j:c:s:o:m:t:d:r:n:x:b:e:a:p:w:u:i:k:lf:")) != -1){
     switch(opt){
       case 'j':
         args->n_cpus = atoi(optarg);
@@ -74,6 +114,39 @@ void parse_args(int argc, char *argv[], args_t *args){
         copy_string(args->path_mask, STRLEN, optarg);
         received_n++;
         break;
+      case 'b':
+        copy_string(args->path_output_opposite, STRLEN, optarg);
+        break;
+      case 'e':
+        copy_string(args->path_events, STRLEN, optarg);
+        break;
+      case 'a':
+        copy_string(args->path_alerts, STRLEN, optarg);
+        break;
+      case 'p':
+        copy_string(args->path_state_input, STRLEN, optarg);
+        break;
+      case 'w':
+        copy_string(args->path_state_output, STRLEN, optarg);
+        break;
+      case 'u':
+        copy_string(args->path_output_mask, STRLEN, optarg);
+        break;
+      case 'i':
+        copy_string(args->path_combined_input, STRLEN, optarg);
+        break;
+      case 'k':
+        copy_string(args->path_combined_output, STRLEN, optarg);
+        break;
+      case 'l':
+        args->lookup = true;
+        break;
+      case 'f':
+        if ((args->incremental = manifest_mode(optarg)) < 0){
+          fprintf(stderr, "Unknown incremental mode %s.\n", optarg);
+          usage(argv[0], FAILURE);
+        }
+        break;
       case '?':
         if (isprint(optopt)){
           fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -116,11 +189,51 @@ void parse_args(int argc, char *argv[], args_t *args){
     usage(argv[0], FAILURE);
   }
 
-  if (fileexist(args->path_output)){
+  if (args->incremental == _MANIFEST_OFF_ && fileexist(args->path_output)){
     fprintf(stderr, "Output file %s already exists.\n", args->path_output);
     usage(argv[0], FAILURE);
   }
 
+  if (args->incremental == _MANIFEST_OFF_ && args->path_output_opposite[0] != '\0' && fileexist(args->path_output_opposite)){
+    fprintf(stderr, "Output file %s already exists.\n", args->path_output_opposite);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->incremental == _MANIFEST_OFF_ && args->path_events[0] != '\0' && fileexist(args->path_events)){
+    fprintf(stderr, "Event file %s already exists.\n", args->path_events);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->path_state_input[0] != '\0' && !fileexist(args->path_state_input)){
+    fprintf(stderr, "State file %s does not exist.\n", args->path_state_input);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->incremental == _MANIFEST_OFF_ && args->path_state_output[0] != '\0' && fileexist(args->path_state_output)){
+    fprintf(stderr, "State file %s already exists.\n", args->path_state_output);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->incremental == _MANIFEST_OFF_ && args->path_output_mask[0] != '\0' && fileexist(args->path_output_mask)){
+    fprintf(stderr, "Output file %s already exists.\n", args->path_output_mask);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->path_combined_input[0] != '\0' && args->path_combined_output[0] == '\0'){
+    fprintf(stderr, "Combined input image (-i) requires a combined output image (-k).\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->path_combined_input[0] != '\0' && !fileexist(args->path_combined_input)){
+    fprintf(stderr, "Combined input file %s does not exist.\n", args->path_combined_input);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->incremental == _MANIFEST_OFF_ && args->path_combined_output[0] != '\0' && fileexist(args->path_combined_output)){
+    fprintf(stderr, "Output file %s already exists.\n", args->path_combined_output);
+    usage(argv[0], FAILURE);
+  }
+
   if (args->n_cpus < 1){
     fprintf(stderr, "Number of CPUs must be at least 1.\n");
     usage(argv[0], FAILURE);
@@ -9,10 +9,12 @@ Argument parsing header for disturbance_detection
 #include <stdlib.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <stdbool.h>
 
 #include "../utils/alloc.h"
 #include "../utils/const.h"
 #include "../utils/dir.h"
+#include "../utils/manifest.h"
 #include "../utils/string.h"
 
 #ifdef __cplusplus
@@ -27,11 +29,21 @@ typedef struct {
   char path_variability[STRLEN];
   char path_coefficients[STRLEN];
   char path_output[STRLEN];
+  char path_output_opposite[STRLEN];
+  char path_events[STRLEN];
+  char path_alerts[STRLEN];
+  char path_state_input[STRLEN];
+  char path_state_output[STRLEN];
+  char path_output_mask[STRLEN];
+  char path_combined_input[STRLEN];
+  char path_combined_output[STRLEN];
   int modes;
   int trend;
   float threshold_variability;
   float threshold_residual;
   int confirmation_number;
+  bool lookup;
+  int incremental;
 } args_t;
 
 void usage(char *exe, int exit_code);
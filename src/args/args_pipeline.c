@@ -0,0 +1,277 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file parses command line arguments for pipeline
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#include "args_pipeline.h"
+
+void usage(char *exe, int exit_code){
+  printf("Usage: %s -j cpus -x mask-image -o output-directory -y year\n", exe);
+  printf("          -m modes -t trend -s threshold -n confirmation-number\n");
+  printf("          -d threshold_variability -r threshold_residual -c confirmation-number\n");
+  printf("          [-i index] [-q qai-rules] [-b block-rows] [-g memory-limit] [-k] [-w]\n");
+  printf("          reflectance-image-1 reflectance-image-2 ...\n");
+  printf("\n");
+  printf("  -j = number of CPUs to use\n");
+  printf("\n");
+  printf("  -x = initial mask image, i.e. the mask of the year before -y\n");
+  printf("  -o = output directory, the disturbances of each year and the combined\n");
+  printf("       disturbances of the last year are written, named as in workflow.sh:\n");
+  printf("       disturbance_YYYY.tif and disturbances_YYYY.tif\n");
+  printf("  -y = first year to detect disturbances in (e.g., 2018), all later years\n");
+  printf("       up to the year of the latest reflectance image are processed\n");
+  printf("\n");
+  printf("  -m = number of modes for fitting the harmonic model (1-3)\n");
+  printf("  -t = use trend coefficient when fitting the harmonic model? (0 = no, 1 = yes)\n");
+  printf("\n");
+  printf("  reference period, see reference_period:\n");
+  printf("  -s = threshold for detecting change (e.g., 200)\n");
+  printf("  -n = confirmation number for detecting change (e.g., 3)\n");
+  printf("\n");
+  printf("  disturbance detection, see disturbance_detection:\n");
+  printf("  -d = standard deviation threshold\n");
+  printf("  -r = minimum residuum threshold\n");
+  printf("  -c = confirmation number\n");
+  printf("\n");
+  printf("  -i = optional index (default: %s), available: ", _INDICES_DEFAULT_);
+  print_indices(stdout);
+  printf("\n");
+  printf("  -q = optional QAI screening rules, list or file with rule names, e.g.\n");
+  printf("       NODATA,CLOUD_OPAQUE,CLOUD_SHADOW (default: %s)\n", _QAI_RULES_DEFAULT_);
+  printf("  -b = optional number of rows per processing block (default: 64), the\n");
+  printf("       index of all scenes is held in memory for one block\n");
+  printf("  -g = optional memory limit in MB (default: none), the block size, the\n");
+  printf("       number of threads (at most -j), the number of images read at the\n");
+  printf("       same time and the block cache are planned to fit, -b is the largest\n");
+  printf("       block; fails before reading any pixel if the job does not fit\n");
+  printf("  -k = optional, checkpoint completed blocks in output-directory/checkpoint,\n");
+  printf("       a run with the same arguments resumes from there, the outputs are\n");
+  printf("       written once all blocks are completed\n");
+  printf("  -w = optional, also write the intermediates for debugging: the index\n");
+  printf("       images, and the reference period, coefficients, mask and combined\n");
+  printf("       disturbances of each year\n");
+  printf("\n");
+  printf("  reflectance-image-1 reflectance-image-2 ... = FORCE BOA images of the\n");
+  printf("       whole history, ordered by date (earliest to latest), the quality\n");
+  printf("       images are found by replacing BOA with QAI in the file names\n");
+  printf("\n");
+  exit(exit_code);
+  return;
+}
+
+void parse_args(int argc, char *argv[], args_t *args){
+  int opt, received_n = 0, expected_n = 11;
+  char fname[STRLEN], basename[STRLEN], dirname[STRLEN], suffixed[STRLEN];
+  opterr = 0;
+
+  // optional arguments
+  args->block_rows = 64;
+  args->memory = 0;
+  args->checkpoint = false;
+  args->intermediates = false;
+  copy_string(args->index, STRLEN, _INDICES_DEFAULT_);
+  copy_string(args->qai_rules, STRLEN, _QAI_RULES_DEFAULT_);
+
+  while ((opt = getopt(argc, argv, "j:x:o:y:m:t:s:n:d:r:c:i:q:b:g:kw")) != -1){
+    switch(opt){
+      case 'j':
+        args->n_cpus = atoi(optarg);
+        received_n++;
+        break;
+      case 'x':
+        copy_string(args->path_mask, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'o':
+        copy_string(args->dir_output, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'y':
+        args->year = atoi(optarg);
+        received_n++;
+        break;
+      case 'm':
+        args->modes = atoi(optarg);
+        received_n++;
+        break;
+      case 't':
+        args->trend = atoi(optarg);
+        received_n++;
+        break;
+      case 's':
+        args->threshold_reference = atoi(optarg);
+        received_n++;
+        break;
+      case 'n':
+        args->confirmation_reference = atoi(optarg);
+        received_n++;
+        break;
+      case 'd':
+        args->threshold_variability = atof(optarg);
+        received_n++;
+        break;
+      case 'r':
+        args->threshold_residual = atof(optarg);
+        received_n++;
+        break;
+      case 'c':
+        args->confirmation_number = atoi(optarg);
+        received_n++;
+        break;
+      case 'i':
+        copy_string(args->index, STRLEN, optarg);
+        break;
+      case 'q':
+        copy_string(args->qai_rules, STRLEN, optarg);
+        break;
+      case 'b':
+        args->block_rows = atoi(optarg);
+        break;
+      case 'k':
+        args->checkpoint = true;
+        break;
+      case 'g':
+        args->memory = atoi(optarg);
+        break;
+      case 'w':
+        args->intermediates = true;
+        break;
+      case '?':
+        if (isprint(optopt)){
+          fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+        } else {
+          fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+        }
+        usage(argv[0], FAILURE);
+      default:
+        fprintf(stderr, "Error parsing arguments.\n");
+        usage(argv[0], FAILURE);
+    }
+  }
+
+  if (received_n != expected_n){
+    fprintf(stderr, "Not all arguments received.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if ((args->n_scenes = argc - optind) < 1){
+    fprintf(stderr, "No reflectance images given.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (select_indices(args->index, &args->indices) != SUCCESS){
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->indices.n != 1){
+    fprintf(stderr, "Exactly one index must be selected.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (!fileexist(args->dir_output)){
+    fprintf(stderr, "Output directory %s does not exist.\n", args->dir_output);
+    usage(argv[0], FAILURE);
+  }
+
+  alloc_2D((void***)&args->path_reflectance, args->n_scenes, STRLEN, sizeof(char));
+  alloc_2D((void***)&args->path_quality,     args->n_scenes, STRLEN, sizeof(char));
+  alloc_2D((void***)&args->path_index,       args->n_scenes, STRLEN, sizeof(char));
+
+  for (int i=0; i<args->n_scenes; i++){
+
+    copy_string(args->path_reflectance[i], STRLEN, argv[optind + i]);
+
+    // quality image: replace BOA with QAI in the file name
+    directoryname(args->path_reflectance[i], dirname, STRLEN);
+    basename_with_ext(args->path_reflectance[i], fname, STRLEN);
+    if (strstr(fname, "BOA") == NULL){
+      fprintf(stderr, "Reflectance file %s is not a BOA image.\n", args->path_reflectance[i]);
+      usage(argv[0], FAILURE);
+    }
+    replace_string(fname, "BOA", "QAI", STRLEN);
+    concat_string_2(args->path_quality[i], STRLEN, dirname, fname, "/");
+
+    // index image, only written with -w: basename with index suffix in output directory
+    basename_without_ext(args->path_reflectance[i], basename, STRLEN);
+    concat_string_2(suffixed, STRLEN, basename, args->indices.index[0]->name, "_");
+    concat_string_2(fname, STRLEN, suffixed, "tif", ".");
+    concat_string_2(args->path_index[i], STRLEN, args->dir_output, fname, "/");
+
+    if (!fileexist(args->path_reflectance[i])){
+      fprintf(stderr, "Reflectance file %s does not exist.\n", args->path_reflectance[i]);
+      usage(argv[0], FAILURE);
+    }
+
+    if (!fileexist(args->path_quality[i])){
+      fprintf(stderr, "Quality file %s does not exist.\n", args->path_quality[i]);
+      usage(argv[0], FAILURE);
+    }
+
+    if (args->intermediates && fileexist(args->path_index[i])){
+      fprintf(stderr, "Output file %s already exists.\n", args->path_index[i]);
+      usage(argv[0], FAILURE);
+    }
+
+  }
+
+  if (args->checkpoint && args->intermediates){
+    fprintf(stderr, "Checkpoints (-k) cannot be combined with intermediates (-w).\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (!fileexist(args->path_mask)){
+    fprintf(stderr, "Mask file %s does not exist.\n", args->path_mask);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->n_cpus < 1){
+    fprintf(stderr, "Number of CPUs must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->block_rows < 1){
+    fprintf(stderr, "Number of block rows must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->memory < 0){
+    fprintf(stderr, "Memory limit must not be negative.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->year < 1971 || args->year > 2100){
+    fprintf(stderr, "year must be between 1971 and 2100.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->modes != 1 && args->modes != 2 && args->modes != 3){
+    fprintf(stderr, "modes must be between 1, 2, or 3.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->trend != 0 && args->trend != 1){
+    fprintf(stderr, "trend must be 0 (no) or 1 (yes).\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->threshold_reference == 0){
+    fprintf(stderr, "threshold must be non-zero.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->threshold_variability == 0){
+    fprintf(stderr, "variability threshold must be non-zero.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->threshold_residual == 0){
+    fprintf(stderr, "residual threshold must be non-zero.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->confirmation_reference < 1 || args->confirmation_number < 1){
+    fprintf(stderr, "confirmation numbers must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  return;
+}
@@ -0,0 +1,57 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Argument parsing header for pipeline
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#ifndef ARGS_PIPELINE_H
+#define ARGS_PIPELINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <ctype.h>
+
+#include "../utils/alloc.h"
+#include "../utils/const.h"
+#include "../utils/dir.h"
+#include "../utils/indices.h"
+#include "../utils/quality.h"
+#include "../utils/string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  int n_cpus;
+  int n_scenes;
+  int block_rows;
+  bool checkpoint;
+  int memory;
+  char **path_reflectance;
+  char **path_quality;
+  char **path_index;
+  char path_mask[STRLEN];
+  char dir_output[STRLEN];
+  char index[STRLEN];
+  indexlist_t indices;
+  char qai_rules[STRLEN];
+  bool intermediates;
+  int year;
+  int modes;
+  int trend;
+  int threshold_reference;
+  int confirmation_reference;
+  float threshold_variability;
+  float threshold_residual;
+  int confirmation_number;
+} args_t;
+
+void usage(char *exe, int exit_code);
+void parse_args(int argc, char *argv[], args_t *args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -11,7 +11,8 @@ void usage(char *exe, int exit_code){
   printf("Usage: %s -j cpus -x mask-image \n", exe);
   printf("          -p input-reference-image -r output-reference-period-image\n");
   printf("          -i input-coefficient-image -c output-coefficient-image\n");
-  printf("          -m modes -t trend -e year -s threshold -n confirmation-number input-image(s)\n");
+  printf("          -m modes -t trend -y year -s threshold -n confirmation-number\n");
+  printf("          [-v output-variability-image] [-e estimator] [-l] [-f mode] input-image(s)\n");
   printf("\n");
   printf("  -j = number of CPUs to use\n");
   printf("\n");
@@ -26,6 +27,22 @@ void usage(char *exe, int exit_code){
   printf("  -y = latest year to fit reference period to (e.g., 2020)\n");
   printf("  -s = threshold for detecting change (e.g., 500)\n");
   printf("  -n = confirmation number for detecting change (e.g., 3)\n");
+  printf("  -v = optional output variability image, standard deviation (band 1) and\n");
+  printf("       robust standard deviation (band 2) of the observations in the last\n");
+  printf("       year of the reference period, computed in the same pass\n");
+  printf("       (replaces temporal_variability)\n");
+  printf("  -e = optional robust estimator for band 2 of -v (default: mad)\n");
+  printf("       mad:  1.4826 x median absolute deviation\n");
+  printf("       iqr:  interquartile range / 1.349\n");
+  printf("       trim: standard deviation without the lowest and highest %.0f%%\n", _ROBUST_TRIM_ * 100);
+  printf("  -l = optional, use int16 baseline tables per DOY instead of predicting\n");
+  printf("       each observation when scanning for anomalies (faster, predictions\n");
+  printf("       are rounded to integers)\n");
+  printf("  -f = optional incremental mode, stat or hash (default: always run), the\n");
+  printf("       run is skipped if the manifests of all outputs (output.manifest)\n");
+  printf("       match the parameters and inputs, i.e. no input changed in size or\n");
+  printf("       modification time (stat), or in content (hash), outputs that are\n");
+  printf("       not up to date are overwritten; the manifests are written in any mode\n");
   printf("\n");
   printf("  input-image(s) = input images to compute reference period from\n");
   printf("                   images must be ordered by date (earliest to latest)\n");
@@ -41,7 +58,13 @@ void parse_args(int argc, char *argv[], args_t *args){
 int opt, received_n = 0, expected_n = 11;
   opterr = 0;
 
-  while ((opt = getopt(argc, argv, "j:x:p:r:i:c:m:t:y:s:n:")) != -1){
+  // optional arguments
+  args->incremental = _MANIFEST_OFF_;
+  args->lookup = false;
+  args->path_output_variability[0] = '\0';
+  args->robust = _ROBUST_MAD_;
+
+  while ((opt = getopt(argc, argv, "j:x:p:r:i:c:m:t:y:s:n:v:e:lf:")) != -1){
     switch(opt){
       case 'j':
         args->n_cpus = atoi(optarg);
@@ -87,6 +110,30 @@ int opt, received_n = 0, expected_n = 11;
         args->confirmation_number = atoi(optarg);
         received_n++;
         break;  
+      case 'v':
+        copy_string(args->path_output_variability, STRLEN, optarg);
+        break;
+      case 'e':
+        if (strcmp(optarg, "mad") == 0){
+          args->robust = _ROBUST_MAD_;
+        } else if (strcmp(optarg, "iqr") == 0){
+          args->robust = _ROBUST_IQR_;
+        } else if (strcmp(optarg, "trim") == 0){
+          args->robust = _ROBUST_TRIMMED_;
+        } else {
+          fprintf(stderr, "Unknown robust estimator %s.\n", optarg);
+          usage(argv[0], FAILURE);
+        }
+        break;
+      case 'l':
+        args->lookup = true;
+        break;
+      case 'f':
+        if ((args->incremental = manifest_mode(optarg)) < 0){
+          fprintf(stderr, "Unknown incremental mode %s.\n", optarg);
+          usage(argv[0], FAILURE);
+        }
+        break;
       case '?':
         if (isprint(optopt)){
           fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -124,17 +171,22 @@ int opt, received_n = 0, expected_n = 11;
     usage(argv[0], FAILURE);
   }
 
-  if (fileexist(args->path_output_coefficient)){
+  if (args->incremental == _MANIFEST_OFF_ && fileexist(args->path_output_coefficient)){
     fprintf(stderr, "Output file %s already exists.\n", args->path_output_coefficient);
     usage(argv[0], FAILURE);
   }
 
+  if (args->incremental == _MANIFEST_OFF_ && args->path_output_variability[0] != '\0' && fileexist(args->path_output_variability)){
+    fprintf(stderr, "Output file %s already exists.\n", args->path_output_variability);
+    usage(argv[0], FAILURE);
+  }
+
   if (!fileexist(args->path_input_reference_period)){
     fprintf(stderr, "Input reference period file %s does not exist.\n", args->path_input_reference_period);
     usage(argv[0], FAILURE);
   }
 
-  if (fileexist(args->path_output_reference_period)){
+  if (args->incremental == _MANIFEST_OFF_ && fileexist(args->path_output_reference_period)){
     fprintf(stderr, "Output file %s already exists.\n", args->path_output_reference_period);
     usage(argv[0], FAILURE);
   }
@@ -10,10 +10,13 @@ Argument parsing header
 #include <stdlib.h>  // standard general utilities library
 #include <unistd.h>   // essential POSIX functions and constants
 #include <ctype.h>
+#include <stdbool.h>
 
 #include "../utils/alloc.h"
 #include "../utils/const.h"
 #include "../utils/dir.h"
+#include "../utils/manifest.h"
+#include "../utils/stats.h"
 #include "../utils/string.h"
 
 #ifdef __cplusplus
@@ -30,11 +33,15 @@ typedef struct {
   char path_output_reference_period[STRLEN];
   char path_input_coefficient[STRLEN];
   char path_output_coefficient[STRLEN];
+  char path_output_variability[STRLEN];
+  int robust;
   int modes;
   int trend;
   int year;
   int threshold;
   int confirmation_number;
+  bool lookup;
+  int incremental;
 } args_t;
 
 void usage(char *exe, int exit_code);
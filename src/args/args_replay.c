@@ -0,0 +1,210 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file parses command line arguments for replay
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#include "args_replay.h"
+
+void usage(char *exe, int exit_code){
+  printf("Usage: %s -j cpus -x mask-image -o output-directory -y year\n", exe);
+  printf("          -m modes -t trend -s threshold -n confirmation-number\n");
+  printf("          -d threshold_variability -r threshold_residual -c confirmation-number\n");
+  printf("          [-b block-rows] [-g memory-limit] [-k] input-image(s)\n");
+  printf("\n");
+  printf("  -j = number of CPUs to use\n");
+  printf("\n");
+  printf("  -x = initial mask image, i.e. the mask of the year before -y\n");
+  printf("  -o = output directory, the yearly outputs are named as in workflow.sh:\n");
+  printf("       reference_period_YYYY.tif and coefficients_YYYY.tif for the previous\n");
+  printf("       year, disturbance_YYYY.tif, mask_YYYY.tif and disturbances_YYYY.tif\n");
+  printf("  -y = first year to detect disturbances in (e.g., 2018), all later years\n");
+  printf("       up to the year of the latest input image are replayed\n");
+  printf("\n");
+  printf("  -m = number of modes for fitting the harmonic model (1-3)\n");
+  printf("  -t = use trend coefficient when fitting the harmonic model? (0 = no, 1 = yes)\n");
+  printf("\n");
+  printf("  reference period, see reference_period:\n");
+  printf("  -s = threshold for detecting change (e.g., 200)\n");
+  printf("  -n = confirmation number for detecting change (e.g., 3)\n");
+  printf("\n");
+  printf("  disturbance detection, see disturbance_detection:\n");
+  printf("  -d = standard deviation threshold\n");
+  printf("  -r = minimum residuum threshold\n");
+  printf("  -c = confirmation number\n");
+  printf("\n");
+  printf("  -b = optional number of rows per processing block (default: 64), all\n");
+  printf("       input images are held in memory for one block\n");
+  printf("  -g = optional memory limit in MB (default: none), the block size, the\n");
+  printf("       number of threads (at most -j), the number of images read at the\n");
+  printf("       same time and the block cache are planned to fit, -b is the largest\n");
+  printf("       block; fails before reading any pixel if the job does not fit\n");
+  printf("  -k = optional, checkpoint completed blocks in output-directory/checkpoint,\n");
+  printf("       a run with the same arguments resumes from there, the outputs are\n");
+  printf("       written once all blocks are completed\n");
+  printf("\n");
+  printf("  input-image(s) = index images of the whole history, e.g. *_CREM.tif\n");
+  printf("                   images must be ordered by date (earliest to latest)\n");
+  printf("                   the mask is applied year by year, i.e. the images\n");
+  printf("                   can be computed with the initial mask\n");
+  printf("\n");
+  exit(exit_code);
+  return;
+}
+
+void parse_args(int argc, char *argv[], args_t *args){
+  int opt, received_n = 0, expected_n = 11;
+  opterr = 0;
+
+  // optional arguments
+  args->block_rows = 64;
+  args->memory = 0;
+  args->checkpoint = false;
+
+  while ((opt = getopt(argc, argv, "j:x:o:y:m:t:s:n:d:r:c:b:g:k")) != -1){
+    switch(opt){
+      case 'j':
+        args->n_cpus = atoi(optarg);
+        received_n++;
+        break;
+      case 'x':
+        copy_string(args->path_mask, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'o':
+        copy_string(args->dir_output, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'y':
+        args->year = atoi(optarg);
+        received_n++;
+        break;
+      case 'm':
+        args->modes = atoi(optarg);
+        received_n++;
+        break;
+      case 't':
+        args->trend = atoi(optarg);
+        received_n++;
+        break;
+      case 's':
+        args->threshold_reference = atoi(optarg);
+        received_n++;
+        break;
+      case 'n':
+        args->confirmation_reference = atoi(optarg);
+        received_n++;
+        break;
+      case 'd':
+        args->threshold_variability = atof(optarg);
+        received_n++;
+        break;
+      case 'r':
+        args->threshold_residual = atof(optarg);
+        received_n++;
+        break;
+      case 'c':
+        args->confirmation_number = atoi(optarg);
+        received_n++;
+        break;
+      case 'b':
+        args->block_rows = atoi(optarg);
+        break;
+      case 'k':
+        args->checkpoint = true;
+        break;
+      case 'g':
+        args->memory = atoi(optarg);
+        break;
+      case '?':
+        if (isprint(optopt)){
+          fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+        } else {
+          fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+        }
+        usage(argv[0], FAILURE);
+      default:
+        fprintf(stderr, "Error parsing arguments.\n");
+        usage(argv[0], FAILURE);
+    }
+  }
+
+  if (received_n != expected_n){
+    fprintf(stderr, "Not all arguments received.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if ((args->n_images = argc - optind) < 1){
+    fprintf(stderr, "At least one input image must be provided.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  alloc_2D((void***)&args->path_input, args->n_images, STRLEN, sizeof(char));
+  for (int i=0; i<args->n_images; i++){
+    copy_string(args->path_input[i], STRLEN, argv[optind + i]);
+    if (!fileexist(args->path_input[i])){
+      fprintf(stderr, "Input file %s does not exist.\n", args->path_input[i]);
+      usage(argv[0], FAILURE);
+    }
+  }
+
+  if (!fileexist(args->path_mask)){
+    fprintf(stderr, "Mask file %s does not exist.\n", args->path_mask);
+    usage(argv[0], FAILURE);
+  }
+
+  if (!fileexist(args->dir_output)){
+    fprintf(stderr, "Output directory %s does not exist.\n", args->dir_output);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->n_cpus < 1){
+    fprintf(stderr, "Number of CPUs must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->block_rows < 1){
+    fprintf(stderr, "Number of block rows must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->memory < 0){
+    fprintf(stderr, "Memory limit must not be negative.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->year < 1971 || args->year > 2100){
+    fprintf(stderr, "year must be between 1971 and 2100.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->modes != 1 && args->modes != 2 && args->modes != 3){
+    fprintf(stderr, "modes must be between 1, 2, or 3.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->trend != 0 && args->trend != 1){
+    fprintf(stderr, "trend must be 0 (no) or 1 (yes).\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->threshold_reference == 0){
+    fprintf(stderr, "threshold must be non-zero.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->threshold_variability == 0){
+    fprintf(stderr, "variability threshold must be non-zero.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->threshold_residual == 0){
+    fprintf(stderr, "residual threshold must be non-zero.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->confirmation_reference < 1 || args->confirmation_number < 1){
+    fprintf(stderr, "confirmation numbers must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  return;
+}
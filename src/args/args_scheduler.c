@@ -0,0 +1,253 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file parses command line arguments for scheduler
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#include "args_scheduler.h"
+
+void usage(char *exe, int exit_code){
+  printf("Usage: %s -j cpus -g memory -l cube-directory -x mask-directory\n", exe);
+  printf("          -o output-directory -y year -e last-year\n");
+  printf("          -m modes -t trend -s threshold -n confirmation-number\n");
+  printf("          -d threshold_variability -r threshold_residual -c confirmation-number\n");
+  printf("          [-f mask-file] [-p pattern] [-i index] [-q qai-rules] [-b block-rows] [-k]\n");
+  printf("          tile-1 tile-2 ...\n");
+  printf("\n");
+  printf("  -j = number of CPUs to use, shared by all tiles\n");
+  printf("  -g = memory budget in MB, tiles are only started while the estimated\n");
+  printf("       memory of all started tiles stays below the budget (at least one\n");
+  printf("       tile is always running), the rows per task and the number of threads\n");
+  printf("       are planned such that each tile fits into the budget on its own;\n");
+  printf("       fails before reading any pixel if a tile does not fit\n");
+  printf("\n");
+  printf("  -l = datacube directory with one sub-directory per tile, e.g. X0055_Y0053,\n");
+  printf("       that holds the FORCE BOA and QAI images\n");
+  printf("  -x = mask directory with one sub-directory per tile\n");
+  printf("  -o = output directory, the outputs of each tile are written to a sub-\n");
+  printf("       directory, see pipeline\n");
+  printf("  -y = first year to detect disturbances in (e.g., 2018)\n");
+  printf("  -e = last year to detect disturbances in, later images are not used\n");
+  printf("\n");
+  printf("  -m = number of modes for fitting the harmonic model (1-3)\n");
+  printf("  -t = use trend coefficient when fitting the harmonic model? (0 = no, 1 = yes)\n");
+  printf("\n");
+  printf("  reference period, see reference_period:\n");
+  printf("  -s = threshold for detecting change (e.g., 200)\n");
+  printf("  -n = confirmation number for detecting change (e.g., 3)\n");
+  printf("\n");
+  printf("  disturbance detection, see disturbance_detection:\n");
+  printf("  -d = standard deviation threshold\n");
+  printf("  -r = minimum residuum threshold\n");
+  printf("  -c = confirmation number\n");
+  printf("\n");
+  printf("  -f = optional name of the initial mask image in the tile directory\n");
+  printf("       (default: forest.tif)\n");
+  printf("  -p = optional pattern that the BOA file names must contain, e.g. SEN2\n");
+  printf("       (default: none)\n");
+  printf("  -i = optional index (default: %s), available: ", _INDICES_DEFAULT_);
+  print_indices(stdout);
+  printf("\n");
+  printf("  -q = optional QAI screening rules, list or file with rule names, e.g.\n");
+  printf("       NODATA,CLOUD_OPAQUE,CLOUD_SHADOW (default: %s)\n", _QAI_RULES_DEFAULT_);
+  printf("  -b = optional largest number of rows per task (default: 16)\n");
+  printf("  -k = optional, checkpoint completed blocks in the checkpoint sub-\n");
+  printf("       directory of each tile, a run with the same arguments resumes from\n");
+  printf("       there, the outputs of a tile are written once all blocks are completed\n");
+  printf("\n");
+  printf("  tile-1 tile-2 ... = tiles to process, in this order\n");
+  printf("\n");
+  exit(exit_code);
+  return;
+}
+
+void parse_args(int argc, char *argv[], args_t *args){
+  int opt, received_n = 0, expected_n = 14;
+  opterr = 0;
+
+  // optional arguments
+  args->checkpoint = false;
+  args->block_rows = 16;
+  copy_string(args->mask, STRLEN, "forest.tif");
+  args->pattern[0] = '\0';
+  copy_string(args->index, STRLEN, _INDICES_DEFAULT_);
+  copy_string(args->qai_rules, STRLEN, _QAI_RULES_DEFAULT_);
+
+  while ((opt = getopt(argc, argv, "j:g:l:x:o:y:e:m:t:s:n:d:r:c:f:p:i:q:b:k")) != -1){
+    switch(opt){
+      case 'j':
+        args->n_cpus = atoi(optarg);
+        received_n++;
+        break;
+      case 'g':
+        args->memory = atoi(optarg);
+        received_n++;
+        break;
+      case 'l':
+        copy_string(args->dir_cube, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'x':
+        copy_string(args->dir_mask, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'o':
+        copy_string(args->dir_output, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'y':
+        args->year = atoi(optarg);
+        received_n++;
+        break;
+      case 'e':
+        args->last_year = atoi(optarg);
+        received_n++;
+        break;
+      case 'm':
+        args->modes = atoi(optarg);
+        received_n++;
+        break;
+      case 't':
+        args->trend = atoi(optarg);
+        received_n++;
+        break;
+      case 's':
+        args->threshold_reference = atoi(optarg);
+        received_n++;
+        break;
+      case 'n':
+        args->confirmation_reference = atoi(optarg);
+        received_n++;
+        break;
+      case 'd':
+        args->threshold_variability = atof(optarg);
+        received_n++;
+        break;
+      case 'r':
+        args->threshold_residual = atof(optarg);
+        received_n++;
+        break;
+      case 'c':
+        args->confirmation_number = atoi(optarg);
+        received_n++;
+        break;
+      case 'f':
+        copy_string(args->mask, STRLEN, optarg);
+        break;
+      case 'p':
+        copy_string(args->pattern, STRLEN, optarg);
+        break;
+      case 'i':
+        copy_string(args->index, STRLEN, optarg);
+        break;
+      case 'q':
+        copy_string(args->qai_rules, STRLEN, optarg);
+        break;
+      case 'b':
+        args->block_rows = atoi(optarg);
+        break;
+      case 'k':
+        args->checkpoint = true;
+        break;
+      case '?':
+        if (isprint(optopt)){
+          fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+        } else {
+          fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+        }
+        usage(argv[0], FAILURE);
+      default:
+        fprintf(stderr, "Error parsing arguments.\n");
+        usage(argv[0], FAILURE);
+    }
+  }
+
+  if (received_n != expected_n){
+    fprintf(stderr, "Not all arguments received.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if ((args->n_tiles = argc - optind) < 1){
+    fprintf(stderr, "No tiles given.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  alloc_2D((void***)&args->tiles, args->n_tiles, STRLEN, sizeof(char));
+  for (int i=0; i<args->n_tiles; i++){
+    copy_string(args->tiles[i], STRLEN, argv[optind + i]);
+  }
+
+  if (select_indices(args->index, &args->indices) != SUCCESS){
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->indices.n != 1){
+    fprintf(stderr, "Exactly one index must be selected.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (!fileexist(args->dir_cube)){
+    fprintf(stderr, "Datacube directory %s does not exist.\n", args->dir_cube);
+    usage(argv[0], FAILURE);
+  }
+
+  if (!fileexist(args->dir_mask)){
+    fprintf(stderr, "Mask directory %s does not exist.\n", args->dir_mask);
+    usage(argv[0], FAILURE);
+  }
+
+  if (!fileexist(args->dir_output)){
+    fprintf(stderr, "Output directory %s does not exist.\n", args->dir_output);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->n_cpus < 1){
+    fprintf(stderr, "Number of CPUs must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->memory < 1){
+    fprintf(stderr, "Memory budget must be at least 1 MB.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->block_rows < 1){
+    fprintf(stderr, "Number of block rows must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->year < 1971 || args->year > 2100 || args->last_year < args->year || args->last_year > 2100){
+    fprintf(stderr, "years must be between 1971 and 2100, and the last year must not be before the first year.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->modes != 1 && args->modes != 2 && args->modes != 3){
+    fprintf(stderr, "modes must be between 1, 2, or 3.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->trend != 0 && args->trend != 1){
+    fprintf(stderr, "trend must be 0 (no) or 1 (yes).\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->threshold_reference == 0){
+    fprintf(stderr, "threshold must be non-zero.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->threshold_variability == 0){
+    fprintf(stderr, "variability threshold must be non-zero.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->threshold_residual == 0){
+    fprintf(stderr, "residual threshold must be non-zero.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->confirmation_reference < 1 || args->confirmation_number < 1){
+    fprintf(stderr, "confirmation numbers must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  return;
+}
@@ -0,0 +1,58 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Argument parsing header for scheduler
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#ifndef ARGS_SCHEDULER_H
+#define ARGS_SCHEDULER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <ctype.h>
+
+#include "../utils/alloc.h"
+#include "../utils/const.h"
+#include "../utils/dir.h"
+#include "../utils/indices.h"
+#include "../utils/quality.h"
+#include "../utils/string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  int n_cpus;
+  int memory;
+  int n_tiles;
+  int block_rows;
+  bool checkpoint;
+  char **tiles;
+  char dir_cube[STRLEN];
+  char dir_mask[STRLEN];
+  char dir_output[STRLEN];
+  char mask[STRLEN];
+  char pattern[STRLEN];
+  char index[STRLEN];
+  indexlist_t indices;
+  char qai_rules[STRLEN];
+  int year;
+  int last_year;
+  int modes;
+  int trend;
+  int threshold_reference;
+  int confirmation_reference;
+  float threshold_variability;
+  float threshold_residual;
+  int confirmation_number;
+} args_t;
+
+void usage(char *exe, int exit_code);
+void parse_args(int argc, char *argv[], args_t *args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
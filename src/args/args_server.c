@@ -0,0 +1,84 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file parses command line arguments for server
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#include "args_server.h"
+
+void usage(char *exe, int exit_code){
+  printf("Usage: %s -s socket [-g MB] [-n jobs]\n", exe);
+  printf("\n");
+  printf("  -s = Unix domain socket to listen on, jobs are sent with client, e.g.\n");
+  printf("       client -s socket disturbance_detection -j 8 -c ... -o ...\n");
+  printf("       the stages are spectral_index, reference_period,\n");
+  printf("       disturbance_detection, temporal_variability, update_mask and\n");
+  printf("       combine_disturbances, with the same arguments as the executables\n");
+  printf("\n");
+  printf("  -g = optional memory budget of the image cache in MB (default: 4096),\n");
+  printf("       images that are read by two jobs, e.g. masks and coefficients,\n");
+  printf("       are kept in memory until their file changes; 0 disables the cache\n");
+  printf("  -n = optional number of jobs that run at the same time (default: 1),\n");
+  printf("       each job uses the number of CPUs given with its -j\n");
+  printf("\n");
+  printf("  each job runs in a process forked from the server, i.e. a failing\n");
+  printf("  job does not stop the server; SIGINT or SIGTERM stop the server when\n");
+  printf("  the running jobs finished\n");
+  printf("\n");
+  exit(exit_code);
+  return;
+}
+
+void parse_args(int argc, char *argv[], args_t *args){
+  int opt, received_n = 0, expected_n = 1;
+  opterr = 0;
+
+  // optional arguments
+  args->cache = 4096;
+  args->n_jobs = 1;
+
+  while ((opt = getopt(argc, argv, "s:g:n:")) != -1){
+    switch(opt){
+      case 's':
+        copy_string(args->socket, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'g':
+        args->cache = atoi(optarg);
+        break;
+      case 'n':
+        args->n_jobs = atoi(optarg);
+        break;
+      case '?':
+        if (isprint(optopt)){
+          fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+        } else {
+          fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+        }
+        usage(argv[0], FAILURE);
+      default:
+        fprintf(stderr, "Error parsing arguments.\n");
+        usage(argv[0], FAILURE);
+    }
+  }
+
+  if (received_n != expected_n){
+    fprintf(stderr, "Not all arguments received.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (optind < argc){
+    fprintf(stderr, "Too many arguments.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->cache < 0){
+    fprintf(stderr, "Cache budget must not be negative.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->n_jobs < 1){
+    fprintf(stderr, "Number of jobs must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  return;
+}
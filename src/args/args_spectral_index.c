@@ -6,13 +6,36 @@ This file parses command line arguments for spectral index computation
 
 void usage(char *exe, int exit_code){
   printf("Usage: %s -r reflectance-image -q quality-image -x mask-image -o output-image\n", exe);
+  printf("          [-j cpus] [-i indices] [-s qai-rules] [-f mode]\n");
+  printf("   or: %s -x mask-image -d output-directory\n", exe);
+  printf("          [-j cpus] [-i indices] [-m memory] [-s qai-rules] [-f mode]\n");
+  printf("          reflectance-image-1 reflectance-image-2 ...\n");
+  printf("\n");
+  printf("  -j = optional number of CPUs to use (default: 1)\n");
   printf("\n");
   printf("  -r = reflectance image, FORCE BOA image, either Sentinel-2 or Landsat\n");
   printf("  -q = quality image, FORCE QAI image\n");
   printf("  -x = mask image\n");
-  printf("  -o = output image\n");
+  printf("  -o = output image, if several indices are selected, the index name\n");
+  printf("       is appended to the file name, e.g. output_NBR.tif\n");
+  printf("  -i = optional list of indices, e.g. CREM,NBR (default: %s)\n", _INDICES_DEFAULT_);
+  printf("       available: ");
+  print_indices(stdout);
+  printf("\n");
+  printf("  -s = optional QAI screening rules, list or file with rule names, e.g.\n");
+  printf("       NODATA,CLOUD_OPAQUE,CLOUD_SHADOW (default: %s)\n", _QAI_RULES_DEFAULT_);
+  printf("  -f = optional incremental mode, stat or hash (default: always run), the\n");
+  printf("       run is skipped if the manifests of all outputs (output.manifest)\n");
+  printf("       match the parameters and inputs, i.e. no input changed in size or\n");
+  printf("       modification time (stat), or in content (hash), outputs that are\n");
+  printf("       not up to date are overwritten; the manifests are written in any mode\n");
   printf("\n");
-  printf("  The spectral index to compute is currently fixed to continuum-removed SWIR1.\n");
+  printf("  batch mode, all scenes are processed in one process:\n");
+  printf("  -d = output directory, the outputs are named after the reflectance\n");
+  printf("       images with the index name as suffix, e.g. _CREM.tif\n");
+  printf("  -m = optional memory limit in MB for all scenes in flight (default: no limit)\n");
+  printf("  reflectance-image-1 reflectance-image-2 ... = FORCE BOA images, the quality\n");
+  printf("       images are found by replacing BOA with QAI in the file names\n");
   printf("\n");
   exit(exit_code);
   return;
@@ -20,16 +43,29 @@ void usage(char *exe, int exit_code){
 
 void parse_args(int argc, char *argv[], args_t *args){
   int opt, received_n = 0, expected_n = 4;
+  char path_reflectance[STRLEN] = "\0";
+  char path_quality[STRLEN] = "\0";
+  char path_output[STRLEN] = "\0";
+  char dir_output[STRLEN] = "\0";
+  char fname[STRLEN], basename[STRLEN], dirname[STRLEN], ext[STRLEN], suffixed[STRLEN];
+  int n;
   opterr = 0;
 
-  while ((opt = getopt(argc, argv, "r:q:x:o:")) != -1){
+  // optional arguments
+  args->incremental = _MANIFEST_OFF_;
+  args->n_cpus = 1;
+  args->memory = 0;
+  copy_string(args->index, STRLEN, _INDICES_DEFAULT_);
+  copy_string(args->qai_rules, STRLEN, _QAI_RULES_DEFAULT_);
+
+  while ((opt = getopt(argc, argv, "r:q:x:o:s:j:d:m:i:f:")) != -1){
     switch(opt){
       case 'r':
-        copy_string(args->path_reflectance, STRLEN, optarg);
+        copy_string(path_reflectance, STRLEN, optarg);
         received_n++;
         break;
       case 'q':
-        copy_string(args->path_quality, STRLEN, optarg);
+        copy_string(path_quality, STRLEN, optarg);
         received_n++;
         break;
       case 'x':
@@ -37,9 +73,30 @@ void parse_args(int argc, char *argv[], args_t *args){
         received_n++;
         break;
       case 'o':
-        copy_string(args->path_output, STRLEN, optarg);
+        copy_string(path_output, STRLEN, optarg);
         received_n++;
         break;
+      case 'd':
+        copy_string(dir_output, STRLEN, optarg);
+        break;
+      case 'm':
+        args->memory = atoi(optarg);
+        break;
+      case 'i':
+        copy_string(args->index, STRLEN, optarg);
+        break;
+      case 's':
+        copy_string(args->qai_rules, STRLEN, optarg);
+        break;
+      case 'j':
+        args->n_cpus = atoi(optarg);
+        break;
+      case 'f':
+        if ((args->incremental = manifest_mode(optarg)) < 0){
+          fprintf(stderr, "Unknown incremental mode %s.\n", optarg);
+          usage(argv[0], FAILURE);
+        }
+        break;
       case '?':
         if (isprint(optopt)){
           fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -53,28 +110,131 @@ void parse_args(int argc, char *argv[], args_t *args){
     }
   }
 
-  if (received_n != expected_n){
-    fprintf(stderr, "Not all arguments received.\n");
-    usage(argv[0], FAILURE);
+  // batch mode: mask and output directory, scenes are positional
+  if (dir_output[0] != '\0'){
+
+    if (received_n != 1 || path_reflectance[0] != '\0' ||
+        path_quality[0] != '\0' || path_output[0] != '\0'){
+      fprintf(stderr, "Batch mode expects -x and -d, but not -r, -q or -o.\n");
+      usage(argv[0], FAILURE);
+    }
+
+    if ((args->n_scenes = argc - optind) < 1){
+      fprintf(stderr, "No reflectance images given.\n");
+      usage(argv[0], FAILURE);
+    }
+
+    if (!fileexist(dir_output)){
+      fprintf(stderr, "Output directory %s does not exist.\n", dir_output);
+      usage(argv[0], FAILURE);
+    }
+
+  } else {
+
+    if (received_n != expected_n){
+      fprintf(stderr, "Not all arguments received.\n");
+      usage(argv[0], FAILURE);
+    }
+
+    if (argc > optind){
+      fprintf(stderr, "Reflectance images can only be listed in batch mode (-d).\n");
+      usage(argv[0], FAILURE);
+    }
+
+    args->n_scenes = 1;
+
   }
 
-  if (!fileexist(args->path_reflectance)){
-    fprintf(stderr, "Reflectance file %s does not exist.\n", args->path_reflectance);
+  if (select_indices(args->index, &args->indices) != SUCCESS){
     usage(argv[0], FAILURE);
   }
 
-  if (!fileexist(args->path_quality)){
-    fprintf(stderr, "Quality file %s does not exist.\n", args->path_quality);
-    usage(argv[0], FAILURE);
+  n = args->indices.n;
+
+  alloc_2D((void***)&args->path_reflectance, args->n_scenes,     STRLEN, sizeof(char));
+  alloc_2D((void***)&args->path_quality,     args->n_scenes,     STRLEN, sizeof(char));
+  alloc_2D((void***)&args->path_output,      args->n_scenes * n, STRLEN, sizeof(char));
+
+  if (dir_output[0] != '\0'){
+
+    for (int i=0; i<args->n_scenes; i++){
+
+      copy_string(args->path_reflectance[i], STRLEN, argv[optind + i]);
+
+      // quality image: replace BOA with QAI in the file name
+      directoryname(args->path_reflectance[i], dirname, STRLEN);
+      basename_with_ext(args->path_reflectance[i], fname, STRLEN);
+      if (strstr(fname, "BOA") == NULL){
+        fprintf(stderr, "Reflectance file %s is not a BOA image.\n", args->path_reflectance[i]);
+        usage(argv[0], FAILURE);
+      }
+      replace_string(fname, "BOA", "QAI", STRLEN);
+      concat_string_2(args->path_quality[i], STRLEN, dirname, fname, "/");
+
+      // output images: basename with index suffix in output directory
+      basename_without_ext(args->path_reflectance[i], basename, STRLEN);
+      for (int k=0; k<n; k++){
+        concat_string_2(suffixed, STRLEN, basename, args->indices.index[k]->name, "_");
+        concat_string_2(fname, STRLEN, suffixed, "tif", ".");
+        concat_string_2(args->path_output[i*n + k], STRLEN, dir_output, fname, "/");
+      }
+
+    }
+
+  } else {
+
+    copy_string(args->path_reflectance[0], STRLEN, path_reflectance);
+    copy_string(args->path_quality[0], STRLEN, path_quality);
+
+    // output images: index name appended if more than one index
+    if (n == 1){
+      copy_string(args->path_output[0], STRLEN, path_output);
+    } else {
+      directoryname(path_output, dirname, STRLEN);
+      basename_without_ext(path_output, basename, STRLEN);
+      extension(path_output, ext, STRLEN);
+      for (int k=0; k<n; k++){
+        concat_string_2(suffixed, STRLEN, basename, args->indices.index[k]->name, "_");
+        concat_string_2(fname, STRLEN, suffixed, ext, "");
+        concat_string_2(args->path_output[k], STRLEN, dirname, fname, "/");
+      }
+    }
+
+  }
+
+  for (int i=0; i<args->n_scenes; i++){
+
+    if (!fileexist(args->path_reflectance[i])){
+      fprintf(stderr, "Reflectance file %s does not exist.\n", args->path_reflectance[i]);
+      usage(argv[0], FAILURE);
+    }
+
+    if (!fileexist(args->path_quality[i])){
+      fprintf(stderr, "Quality file %s does not exist.\n", args->path_quality[i]);
+      usage(argv[0], FAILURE);
+    }
+
+    for (int k=0; k<n; k++){
+      if (args->incremental == _MANIFEST_OFF_ && fileexist(args->path_output[i*n + k])){
+        fprintf(stderr, "Output file %s already exists.\n", args->path_output[i*n + k]);
+        usage(argv[0], FAILURE);
+      }
+    }
+
   }
 
   if (!fileexist(args->path_mask)){
     fprintf(stderr, "Mask file %s does not exist.\n", args->path_mask);
     usage(argv[0], FAILURE);
   }
-  
-  if (fileexist(args->path_output)){
-    fprintf(stderr, "Output file %s already exists.\n", args->path_output);
+
+  if (args->n_cpus < 1){
+    fprintf(stderr, "Number of CPUs must be at least 1.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->memory < 0){
+    fprintf(stderr, "Memory limit must not be negative.\n");
     usage(argv[0], FAILURE);
   }
 
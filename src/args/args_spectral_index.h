@@ -13,6 +13,9 @@ Argument parsing header for spectral_index
 #include "../utils/alloc.h"
 #include "../utils/const.h"
 #include "../utils/dir.h"
+#include "../utils/manifest.h"
+#include "../utils/indices.h"
+#include "../utils/quality.h"
 #include "../utils/string.h"
 
 #ifdef __cplusplus
@@ -20,11 +23,17 @@ extern "C" {
 #endif
 
 typedef struct {
-  char path_reflectance[STRLEN];
-  char path_quality[STRLEN];
+  int n_cpus;
+  int memory;
+  int n_scenes;
+  char **path_reflectance;
+  char **path_quality;
+  char **path_output; // n_scenes x n_indices, scene-major
   char path_mask[STRLEN];
-  char path_output[STRLEN];
   char index[STRLEN];
+  indexlist_t indices;
+  char qai_rules[STRLEN];
+  int incremental;
 } args_t;
 
 void usage(char *exe, int exit_code);
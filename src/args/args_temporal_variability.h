@@ -13,6 +13,7 @@ Argument parsing header for temporal_variability
 #include "../utils/alloc.h"
 #include "../utils/const.h"
 #include "../utils/dir.h"
+#include "../utils/manifest.h"
 #include "../utils/string.h"
 
 #ifdef __cplusplus
@@ -22,10 +23,12 @@ extern "C" {
 typedef struct {
   int n_cpus;
   int n_images;
+  int block_rows;
   char **path_input;
   char path_mask[STRLEN];
   char path_reference[STRLEN];
   char path_output[STRLEN];
+  int incremental;
 } args_t;
 
 void usage(char *exe, int exit_code);
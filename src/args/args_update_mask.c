@@ -5,11 +5,16 @@ This file parses command line arguments for update_mask
 #include "args_update_mask.h"
 
 void usage(char *exe, int exit_code){
-  printf("Usage: %s -d disturbance-image -x mask-image -o output-image\n", exe);
+  printf("Usage: %s -d disturbance-image -x mask-image -o output-image [-f mode]\n", exe);
   printf("\n");
   printf("  -d = disturbance image\n");
   printf("  -x = mask image\n");
   printf("  -o = output image\n");
+  printf("  -f = optional incremental mode, stat or hash (default: always run), the\n");
+  printf("       run is skipped if the manifests of all outputs (output.manifest)\n");
+  printf("       match the parameters and inputs, i.e. no input changed in size or\n");
+  printf("       modification time (stat), or in content (hash), outputs that are\n");
+  printf("       not up to date are overwritten; the manifests are written in any mode\n");
   printf("\n");
   exit(exit_code);
   return;
@@ -19,7 +24,10 @@ void parse_args(int argc, char *argv[], args_t *args){
   int opt, received_n = 0, expected_n = 3;
   opterr = 0;
 
-  while ((opt = getopt(argc, argv, "d:x:o:")) != -1){
+  // optional arguments
+  args->incremental = _MANIFEST_OFF_;
+
+  while ((opt = getopt(argc, argv, "d:x:o:f:")) != -1){
     switch(opt){
       case 'd':
         copy_string(args->path_disturbance, STRLEN, optarg);
@@ -33,6 +41,12 @@ void parse_args(int argc, char *argv[], args_t *args){
         copy_string(args->path_output, STRLEN, optarg);
         received_n++;
         break;
+      case 'f':
+        if ((args->incremental = manifest_mode(optarg)) < 0){
+          fprintf(stderr, "Unknown incremental mode %s.\n", optarg);
+          usage(argv[0], FAILURE);
+        }
+        break;
       case '?':
         if (isprint(optopt)){
           fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -61,7 +75,7 @@ void parse_args(int argc, char *argv[], args_t *args){
     usage(argv[0], FAILURE);
   }
   
-  if (fileexist(args->path_output)){
+  if (args->incremental == _MANIFEST_OFF_ && fileexist(args->path_output)){
     fprintf(stderr, "Output file %s already exists.\n", args->path_output);
     usage(argv[0], FAILURE);
   }
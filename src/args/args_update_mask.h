@@ -13,6 +13,7 @@ Argument parsing header for update_mask
 #include "../utils/alloc.h"
 #include "../utils/const.h"
 #include "../utils/dir.h"
+#include "../utils/manifest.h"
 #include "../utils/string.h"
 
 #ifdef __cplusplus
@@ -23,6 +24,7 @@ typedef struct {
   char path_mask[STRLEN];
   char path_disturbance[STRLEN];
   char path_output[STRLEN];
+  int incremental;
 } args_t;
 
 void usage(char *exe, int exit_code);
@@ -0,0 +1,118 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file parses command line arguments for watcher
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#include "args_watcher.h"
+
+void usage(char *exe, int exit_code){
+  printf("Usage: %s -l cube-directory -c command [-p pattern] [-d seconds]\n", exe);
+  printf("          [-m seconds] [-t stamp-file] [tile-1 tile-2 ...]\n");
+  printf("\n");
+  printf("  -l = datacube directory with one sub-directory per tile, e.g. X0055_Y0053,\n");
+  printf("       new BOA/QAI pairs that land there are detected with inotify, i.e.\n");
+  printf("       they must be written on this node\n");
+  printf("  -c = command that processes the new scenes of one tile and year, split\n");
+  printf("       into words at blanks and run without a shell, {tile} and {year} are\n");
+  printf("       replaced by the tile and year, a word with {files} is repeated for\n");
+  printf("       each new BOA image, e.g. \"./nrt.sh {tile} {year} {files}\"; failed\n");
+  printf("       commands are retried after the maximum delay (-m)\n");
+  printf("\n");
+  printf("  -p = optional pattern that the BOA file names must contain, e.g. SEN2\n");
+  printf("       (default: none)\n");
+  printf("  -d = optional debounce interval in seconds (default: 60), a pair is\n");
+  printf("       complete once both images were not written for this long, a\n");
+  printf("       burst of arrivals is processed in one pass once all of them are\n");
+  printf("       complete\n");
+  printf("  -m = optional maximum delay in seconds (default: 600), complete pairs\n");
+  printf("       are processed after this long, even if more arrive\n");
+  printf("  -t = optional stamp file, pairs that were written after the stamp are\n");
+  printf("       processed at startup, i.e. pairs that landed while the watcher was\n");
+  printf("       not running; the stamp is advanced after each pass, but not past\n");
+  printf("       pairs that are still waiting or failed (default: only pairs that\n");
+  printf("       land while the watcher is running are processed)\n");
+  printf("\n");
+  printf("  tile-1 tile-2 ... = optional tiles to watch (default: all tiles, including\n");
+  printf("       tiles that are created later)\n");
+  printf("\n");
+  exit(exit_code);
+  return;
+}
+
+void parse_args(int argc, char *argv[], args_t *args){
+  int opt, received_n = 0, expected_n = 2;
+  opterr = 0;
+
+  // optional arguments
+  args->pattern[0] = '\0';
+  args->stamp[0] = '\0';
+  args->debounce = 60;
+  args->max_delay = 600;
+
+  while ((opt = getopt(argc, argv, "l:c:p:d:m:t:")) != -1){
+    switch(opt){
+      case 'l':
+        copy_string(args->dir_cube, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'c':
+        copy_string(args->command, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'p':
+        copy_string(args->pattern, STRLEN, optarg);
+        break;
+      case 'd':
+        args->debounce = atoi(optarg);
+        break;
+      case 'm':
+        args->max_delay = atoi(optarg);
+        break;
+      case 't':
+        copy_string(args->stamp, STRLEN, optarg);
+        break;
+      case '?':
+        if (isprint(optopt)){
+          fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+        } else {
+          fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+        }
+        usage(argv[0], FAILURE);
+      default:
+        fprintf(stderr, "Error parsing arguments.\n");
+        usage(argv[0], FAILURE);
+    }
+  }
+
+  if (received_n != expected_n){
+    fprintf(stderr, "Not all arguments received.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  args->n_tiles = argc - optind;
+
+  if (args->n_tiles > 0){
+    alloc_2D((void***)&args->tiles, args->n_tiles, STRLEN, sizeof(char));
+    for (int i=0; i<args->n_tiles; i++){
+      copy_string(args->tiles[i], STRLEN, argv[optind + i]);
+    }
+  } else {
+    args->tiles = NULL;
+  }
+
+  if (!fileexist(args->dir_cube)){
+    fprintf(stderr, "Datacube directory %s does not exist.\n", args->dir_cube);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->debounce < 1){
+    fprintf(stderr, "Debounce interval must be at least 1 second.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->max_delay < args->debounce){
+    fprintf(stderr, "Maximum delay must not be shorter than the debounce interval.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  return;
+}
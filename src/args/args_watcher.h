@@ -0,0 +1,41 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Argument parsing header for watcher
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#ifndef ARGS_WATCHER_H
+#define ARGS_WATCHER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <ctype.h>
+
+#include "../utils/alloc.h"
+#include "../utils/const.h"
+#include "../utils/dir.h"
+#include "../utils/string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  char dir_cube[STRLEN];
+  char command[STRLEN];
+  char pattern[STRLEN];
+  char stamp[STRLEN];
+  int debounce;
+  int max_delay;
+  int n_tiles;
+  char **tiles;
+} args_t;
+
+void usage(char *exe, int exit_code);
+void parse_args(int argc, char *argv[], args_t *args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file parses command line arguments for worker
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+#include "args_worker.h"
+
+void usage(char *exe, int exit_code){
+  printf("Usage: %s -q queue -c command [-l seconds] [-i seconds] [-w]\n", exe);
+  printf("\n");
+  printf("  -q = queue file on a file system shared by all nodes, see coordinator\n");
+  printf("  -c = command that runs one job, {tile}, {year} and {stage} are replaced\n");
+  printf("       by those of the job, the command is run with /bin/sh, e.g.\n");
+  printf("       \"./stage.sh {stage} {tile} {year} > logs/{tile}_{year}_{stage}.log 2>&1\"\n");
+  printf("       the job succeeds if the command exits with 0\n");
+  printf("\n");
+  printf("  -l = optional lease duration in seconds (default: 300), the lease is\n");
+  printf("       renewed every third of it while the command runs; if a worker\n");
+  printf("       dies or hangs, its job is reassigned once the lease expired, a\n");
+  printf("       worker that lost its lease stops its command\n");
+  printf("  -i = optional polling interval in seconds (default: 10), while all\n");
+  printf("       unfinished jobs are leased or wait for an earlier job of their tile\n");
+  printf("  -w = optional, keep waiting for new jobs when the queue is drained\n");
+  printf("       (default: exit)\n");
+  printf("\n");
+  printf("  the clocks of all nodes must be synchronized, e.g. with NTP\n");
+  printf("\n");
+  exit(exit_code);
+  return;
+}
+
+void parse_args(int argc, char *argv[], args_t *args){
+  int opt, received_n = 0, expected_n = 2;
+  opterr = 0;
+
+  // optional arguments
+  args->lease = 300;
+  args->poll = 10;
+  args->wait = false;
+
+  while ((opt = getopt(argc, argv, "q:c:l:i:w")) != -1){
+    switch(opt){
+      case 'q':
+        copy_string(args->queue, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'c':
+        copy_string(args->command, STRLEN, optarg);
+        received_n++;
+        break;
+      case 'l':
+        args->lease = atoi(optarg);
+        break;
+      case 'i':
+        args->poll = atoi(optarg);
+        break;
+      case 'w':
+        args->wait = true;
+        break;
+      case '?':
+        if (isprint(optopt)){
+          fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+        } else {
+          fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+        }
+        usage(argv[0], FAILURE);
+      default:
+        fprintf(stderr, "Error parsing arguments.\n");
+        usage(argv[0], FAILURE);
+    }
+  }
+
+  if (received_n != expected_n){
+    fprintf(stderr, "Not all arguments received.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (optind < argc){
+    fprintf(stderr, "Too many arguments.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (!args->wait && !fileexist(args->queue)){
+    fprintf(stderr, "Queue %s does not exist.\n", args->queue);
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->lease < 3){
+    fprintf(stderr, "Lease duration must be at least 3 seconds.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  if (args->poll < 1){
+    fprintf(stderr, "Polling interval must be at least 1 second.\n");
+    usage(argv[0], FAILURE);
+  }
+
+  return;
+}
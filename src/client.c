@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "utils/const.h"
+#include "utils/request.h"
+#include "args/args_client.h"
+
+
+int main ( int argc, char *argv[] ){
+args_t args;
+int fd, status;
+
+
+  parse_args(argc, argv, &args);
+
+  if ((fd = connect_socket(args.socket)) < 0){
+    fprintf(stderr, "No server is listening on %s.\n", args.socket);
+    exit(FAILURE);
+  }
+
+  if (send_request(fd, args.argc, args.argv) != SUCCESS) exit(FAILURE);
+
+  // the stage writes to our output directly, wait for its exit status
+  if (receive_status(fd, &status) != SUCCESS){
+    fprintf(stderr, "Lost the connection to the server on %s.\n", args.socket);
+    exit(FAILURE);
+  }
+
+  close(fd);
+
+  exit(status);
+}
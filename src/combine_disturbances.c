@@ -15,6 +15,7 @@
 #include "utils/date.h"
 #include "utils/dir.h"
 #include "utils/image_io.h"
+#include "utils/manifest.h"
 #include "utils/string.h"
 #include "utils/stats.h"
 #include "args/args_combine_disturbances.h"
@@ -22,53 +23,94 @@
 
 int main ( int argc, char *argv[] ){
 args_t args;
-image_t *input = NULL;
+image_t input;
 image_t output;
+manifest_t manifest;
 
 
   parse_args(argc, argv, &args);
 
+  init_manifest(&manifest, "combine_disturbances");
+  for (int i=0; i<args.n_images; i++) add_manifest_input(&manifest, args.path_input[i]);
+
+  char *outputs[] = { args.path_output };
+
+  if (outputs_fresh(&manifest, outputs, 1, args.incremental)){
+    printf("Output is up to date, skipping.\n");
+    free_manifest(&manifest);
+    exit(SUCCESS);
+  }
+
   GDALAllRegister();
 
+  // check the images, but do not read them yet
+  read_image_info(args.path_input[0], &output);
   
-  alloc((void**)&input, args.n_images, sizeof(image_t));
-  
-  for (int i=0; i<args.n_images; i++){
-    read_image(args.path_input[i], NULL, &input[i]);
-    if (i > 0) compare_images(&input[0], &input[i]);
+  for (int i=1; i<args.n_images; i++){
+    read_image_info(args.path_input[i], &input);
+    compare_images(&output, &input);
+    if (input.nb != output.nb){
+      fprintf(stderr, "Number of bands of %s and %s do not match.\n", args.path_input[0], args.path_input[i]);
+      exit(FAILURE);
+    }
   }
 
+  copy_string(output.path, STRLEN, args.path_output);
+  GDALDatasetH fp_output = create_image(&output);
 
-  copy_image(&input[0], &output, input[0].nb, input[0].nodata, args.path_output);
+  int n_blocks = (output.ny + args.block_rows - 1) / args.block_rows;
 
   
   omp_set_num_threads(args.n_cpus);
 
-  #pragma omp parallel shared(input, output, args) default(none)
+  #pragma omp parallel shared(args, output, fp_output, n_blocks) default(none)
   {
 
-  #pragma omp for
-  for (int p=0; p<output.nc; p++){
+  #pragma omp for schedule(dynamic)
+  for (int block=0; block<n_blocks; block++){
 
-    output.data[0][p] = output.nodata;
+    int row = block * args.block_rows;
+    int n_rows = (row + args.block_rows > output.ny) ? output.ny - row : args.block_rows;
+    image_t input_block, output_block;
 
+    // one input block at a time, latest valid disturbance wins
     for (int i=0; i<args.n_images; i++){
-      for (int b=0; b<input[i].nb; b++){
-        if (input[i].data[b][p] != input[i].nodata && input[i].data[b][p] > 0) output.data[b][p] = input[i].data[b][p];
+
+      read_image_rows(args.path_input[i], NULL, row, n_rows, &input_block);
+
+      if (i == 0){
+        copy_image(&input_block, &output_block, output.nb, output.nodata, args.path_output);
+        for (int p=0; p<output_block.nc; p++) output_block.data[0][p] = output_block.nodata;
       }
+
+      for (int b=0; b<input_block.nb; b++){
+        short *in = input_block.data[b];
+        short *out = output_block.data[b];
+        #pragma omp simd
+        for (int p=0; p<output_block.nc; p++){
+          if (in[p] != input_block.nodata && in[p] > 0) out[p] = in[p];
+        }
+      }
+
+      free_image(&input_block);
+
     }
 
+    #pragma omp critical
+    {
+      write_image_rows(fp_output, &output_block, row);
+    }
+
+    free_image(&output_block);
+
   }
 
   } // end omp parallel region
 
-  write_image(&output);
+  GDALClose(fp_output);
+  write_manifests(&manifest, outputs, 1, args.incremental);
+  free_manifest(&manifest);
 
-  for (int i=0; i<args.n_images; i++){
-    free_image(&input[i]);
-  }
-  free((void*)input);
-  free_image(&output);
   free_2D((void**)args.path_input, args.n_images);
   
   GDALDestroy();
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "utils/alloc.h"
+#include "utils/const.h"
+#include "utils/queue.h"
+#include "utils/string.h"
+#include "args/args_coordinator.h"
+
+
+int main ( int argc, char *argv[] ){
+args_t args;
+job_t *jobs = NULL;
+int n_years, n_jobs = 0;
+int counts[_JOB_STATES_];
+int previous[_JOB_STATES_];
+
+
+  parse_args(argc, argv, &args);
+
+  n_years = args.last_year - args.year + 1;
+  alloc((void**)&jobs, (size_t)args.n_tiles * n_years * args.n_stages, sizeof(job_t));
+
+  // the jobs of a tile are leased in this order
+  for (int t=0; t<args.n_tiles; t++){
+    for (int y=args.year; y<=args.last_year; y++){
+      for (int s=0; s<args.n_stages; s++){
+        copy_string(jobs[n_jobs].tile, _JOB_NAMELEN_, args.tiles[t]);
+        copy_string(jobs[n_jobs].stage, _JOB_NAMELEN_, args.stages[s]);
+        jobs[n_jobs].year = y;
+        n_jobs++;
+      }
+    }
+  }
+
+  enqueue_jobs(args.queue, jobs, n_jobs, args.max_attempts);
+
+  free((void*)jobs);
+  free_2D((void**)args.tiles, args.n_tiles);
+  free_2D((void**)args.stages, STRLEN / 2);
+
+  if (!args.wait) exit(SUCCESS);
+
+  // expired leases are also reclaimed here, in case all workers died
+  for (int s=0; s<_JOB_STATES_; s++) previous[s] = -1;
+
+  while (true){
+
+    poll_queue(args.queue, counts);
+
+    if (memcmp(counts, previous, sizeof(counts)) != 0){
+      printf("Jobs: %d pending, %d leased, %d done, %d failed, %d skipped.\n",
+        counts[_JOB_PENDING_], counts[_JOB_LEASED_], counts[_JOB_DONE_],
+        counts[_JOB_FAILED_], counts[_JOB_SKIPPED_]);
+      fflush(stdout);
+      memcpy(previous, counts, sizeof(counts));
+    }
+
+    if (counts[_JOB_PENDING_] + counts[_JOB_LEASED_] == 0) break;
+
+    sleep(args.poll);
+
+  }
+
+  print_queue(args.queue, stdout);
+
+  exit((counts[_JOB_FAILED_] + counts[_JOB_SKIPPED_] > 0) ? FAILURE : SUCCESS);
+}
+
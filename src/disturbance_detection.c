@@ -11,15 +11,22 @@
 #include <omp.h> // multi-platform shared memory multiprocessing
 
 #include "utils/const.h"
+#include "utils/alertlog.h"
 #include "utils/alloc.h"
 #include "utils/date.h"
+#include "utils/detection.h"
 #include "utils/dir.h"
+#include "utils/event.h"
 #include "utils/harmonic.h"
 #include "utils/image_io.h"
+#include "utils/manifest.h"
 #include "utils/string.h"
 #include "args/args_disturbance_detection.h"
 
 
+enum { _PRIMARY_, _OPPOSITE_, _DIRECTIONS_ };
+
+
 int main ( int argc, char *argv[] ){
 args_t args;
 date_t *dates = NULL;
@@ -27,11 +34,44 @@ image_t *input = NULL;
 image_t mask;
 image_t variability;
 image_t coefficients;
-image_t disturbance;
+image_t disturbance[_DIRECTIONS_];
+image_t state_input;
+image_t state_output;
+image_t carried;
+image_t next_mask;
+image_t combined_input;
+image_t combined_output;
+eventlist_t *events = NULL;
+alertlist_t *alerts = NULL;
+manifest_t manifest;
 
 
   parse_args(argc, argv, &args);
 
+  // the alert log is appended to, it is not an output of the manifest
+  init_manifest(&manifest, "disturbance_detection");
+  add_manifest_parameter(&manifest, "modes", "%d", args.modes);
+  add_manifest_parameter(&manifest, "trend", "%d", args.trend);
+  add_manifest_parameter(&manifest, "threshold_variability", "%g", args.threshold_variability);
+  add_manifest_parameter(&manifest, "threshold_residual", "%g", args.threshold_residual);
+  add_manifest_parameter(&manifest, "confirmation", "%d", args.confirmation_number);
+  add_manifest_parameter(&manifest, "lookup", "%d", args.lookup);
+  add_manifest_input(&manifest, args.path_mask);
+  add_manifest_input(&manifest, args.path_coefficients);
+  add_manifest_input(&manifest, args.path_variability);
+  add_manifest_input(&manifest, args.path_state_input);
+  add_manifest_input(&manifest, args.path_combined_input);
+  for (int i=0; i<args.n_images; i++) add_manifest_input(&manifest, args.path_input[i]);
+
+  char *outputs[] = { args.path_output, args.path_output_opposite, args.path_events,
+    args.path_state_output, args.path_output_mask, args.path_combined_output };
+
+  if (outputs_fresh(&manifest, outputs, 6, args.incremental)){
+    printf("Outputs are up to date, skipping.\n");
+    free_manifest(&manifest);
+    exit(SUCCESS);
+  }
+
   GDALAllRegister();
 
 
@@ -41,6 +81,11 @@ image_t disturbance;
   compare_images(&mask, &coefficients);
   compare_images(&mask, &variability);
 
+  // rolling-window mode: resume from and/or save the detection state
+  bool read_state  = (args.path_state_input[0] != '\0');
+  bool write_state = (args.path_state_output[0] != '\0');
+  bool rolling = read_state || write_state;
+
   alloc((void**)&input, args.n_images, sizeof(image_t));
   alloc((void**)&dates, args.n_images, sizeof(date_t));
 
@@ -58,8 +103,8 @@ image_t disturbance;
         fprintf(stderr, "Input images must be ordered by date (earliest to latest).\n");
         exit(FAILURE);
       }
-      if (dates[i].year != dates[i-1].year){
-        fprintf(stderr, "Input images should be from the same year.\n");
+      if (!rolling && dates[i].year != dates[i-1].year){
+        fprintf(stderr, "Input images should be from the same year (or use the rolling-window mode).\n");
         exit(FAILURE);
       }
     }
@@ -67,7 +112,17 @@ image_t disturbance;
   }
 
 
-  copy_image(&variability, &disturbance, 3, SHRT_MIN, args.path_output);
+  // detection rules, optionally for both directions
+  detection_rule_t rules[_DIRECTIONS_];
+  rules[_PRIMARY_].threshold_residual = args.threshold_residual;
+  rules[_PRIMARY_].threshold_variability = args.threshold_variability;
+  rules[_PRIMARY_].confirmation_number = args.confirmation_number;
+  opposite_detection_rule(&rules[_PRIMARY_], &rules[_OPPOSITE_]);
+
+  int n_directions = (args.path_output_opposite[0] != '\0') ? 2 : 1;
+
+  copy_image(&variability, &disturbance[_PRIMARY_], 3, SHRT_MIN, args.path_output);
+  if (n_directions > 1) copy_image(&variability, &disturbance[_OPPOSITE_], 3, SHRT_MIN, args.path_output_opposite);
 
   
   // pre-compute terms for harmonic fitting
@@ -81,16 +136,85 @@ image_t disturbance;
   alloc_2D((void***)&terms, args.n_images, n_coef, sizeof(float));
   compute_harmonic_terms(dates, args.n_images, args.modes, args.trend, terms);
 
+  // state: date of last processed image, detection state per direction, 
+  // coefficients that were in use for pixels with an active alert
+  int n_state = 1 + n_directions * _STATE_LENGTH_ + n_coef;
+  int state_coef = 1 + n_directions * _STATE_LENGTH_;
+  int last_date = dates[args.n_images-1].ce - 1970*365;
+
+  if (read_state){
+    read_image(args.path_state_input, NULL, &state_input);
+    compare_images(&mask, &state_input);
+    if (state_input.nb != n_state){
+      fprintf(stderr, "Number of bands in state image (%d) does not match the number of directions, modes and trend settings (%d).\n", state_input.nb, n_state);
+      exit(FAILURE);
+    }
+    // view on the carried coefficients, the data is owned by the state image
+    carried = coefficients;
+    carried.data = state_input.data + state_coef;
+    carried.nodata = state_input.nodata;
+  }
+
+  if (write_state) copy_image(&mask, &state_output, n_state, SHRT_MIN, args.path_state_output);
+
+  // finalize: next year's mask, and the running combined disturbance product
+  bool write_mask = (args.path_output_mask[0] != '\0');
+  bool read_combined  = (args.path_combined_input[0] != '\0');
+  bool write_combined = (args.path_combined_output[0] != '\0');
+
+  if (write_mask) copy_image(&mask, &next_mask, 1, SHRT_MIN, args.path_output_mask);
+
+  if (read_combined){
+    read_image(args.path_combined_input, NULL, &combined_input);
+    compare_images(&mask, &combined_input);
+    if (combined_input.nb != disturbance[_PRIMARY_].nb){
+      fprintf(stderr, "Number of bands in combined image (%d) does not match the disturbance image (%d).\n", 
+        combined_input.nb, disturbance[_PRIMARY_].nb);
+      exit(FAILURE);
+    }
+  }
+
+  if (write_combined){
+    if (read_combined){
+      copy_image(&combined_input, &combined_output, combined_input.nb, combined_input.nodata, args.path_combined_output);
+    } else {
+      copy_image(&disturbance[_PRIMARY_], &combined_output, disturbance[_PRIMARY_].nb, disturbance[_PRIMARY_].nodata, args.path_combined_output);
+    }
+  }
+
+  // per-thread event lists
+  bool write_events = (args.path_events[0] != '\0');
+  if (write_events) alloc((void**)&events, args.n_cpus, sizeof(eventlist_t));
+
+  // per-thread alert lists, only events after the log's watermark are new
+  bool write_alerts = (args.path_alerts[0] != '\0');
+  int watermark = INT_MIN;
+  if (write_alerts){
+    alloc((void**)&alerts, args.n_cpus, sizeof(alertlist_t));
+    watermark = alertlog_watermark(args.path_alerts);
+  }
+
   omp_set_num_threads(args.n_cpus);
 
-  int n_pixels = 0, n_alert = 0, n_reversed = 0, n_detected = 0;
+  int n_pixels = 0;
+  int n_alert[_DIRECTIONS_] = { 0, 0 };
+  int n_reversed[_DIRECTIONS_] = { 0, 0 };
+  int n_detected[_DIRECTIONS_] = { 0, 0 };
+  int n_logged = 0; // alerts at or before the watermark, already in the log
 
-  #pragma omp parallel shared(args, dates, input, mask, variability, coefficients, disturbance, n_coef, terms) reduction(+: n_pixels, n_alert, n_reversed, n_detected) default(none)
+  #pragma omp parallel shared(args, dates, input, mask, variability, coefficients, disturbance, n_coef, terms, events, write_events, alerts, write_alerts, watermark, rules, n_directions, read_state, write_state, state_input, state_output, carried, state_coef, last_date, write_mask, read_combined, write_combined, next_mask, combined_input, combined_output) reduction(+: n_pixels, n_logged, n_alert[:_DIRECTIONS_], n_reversed[:_DIRECTIONS_], n_detected[:_DIRECTIONS_]) default(none)
   {
 
-  #pragma omp for
-  for (int p=0; p<disturbance.nc; p++){
-//if (p != 1837*disturbance.ny + 1385) continue;
+  // per-thread baseline table, blocks are aligned with the schedule's chunks
+  baseline_t baseline;
+  if (args.lookup) init_baseline(dates, args.n_images, args.trend, &baseline);
+
+  #pragma omp for schedule(static, _BASELINE_BLOCK_)
+  for (int p=0; p<disturbance[_PRIMARY_].nc; p++){
+
+    if (write_state){
+      for (int b=0; b<state_output.nb; b++) state_output.data[b][p] = state_output.nodata;
+    }
 
     if (mask.data[0][p] == mask.nodata || mask.data[0][p] == 0) continue;
 
@@ -99,98 +223,175 @@ image_t disturbance;
 
     n_pixels++;
 
-    //printf("pixel %d is valid, proceed:\n", p);
-    //printf("  Variability: %.2f\n", (float)variability.data[0][p]);
-    //for (int b=0; b<coefficients.nb; b++){
-    //  printf("  Coefficient %d: %.2f\n", b, (float)coefficients.data[b][p] / _COEF_SCALE_);
-    //}
-    //printf("  Number of images: %d\n", args.n_images);
+    // independent alerting state per direction
+    detection_t detection[_DIRECTIONS_];
+    for (int d=0; d<n_directions; d++) init_detection(&detection[d]);
+
+    // resume from previous state, keep the coefficients of active alerts
+    image_t *coef = &coefficients;
+    int last = INT_MIN;
+    bool active = false;
+
+    if (read_state && state_input.data[0][p] != state_input.nodata){
+      last = state_input.data[0][p];
+      for (int d=0; d<n_directions; d++){
+        short state[_STATE_LENGTH_];
+        for (int s=0; s<_STATE_LENGTH_; s++) state[s] = state_input.data[1 + d*_STATE_LENGTH_ + s][p];
+        state_to_detection(state, &detection[d]);
+        active |= detection_is_active(&detection[d]);
+      }
+      if (active && carried.data[0][p] != carried.nodata) coef = &carried;
+    }
 
-    int alert_number = 0, candidate = 0;
-    int revert_number = 0;
-    bool confirmed = false;
+    bool lookup = args.lookup && coef == &coefficients;
+    if (lookup) predict_baseline(terms, &coefficients, n_coef, p, &baseline);
 
     for (int i=0; i<args.n_images; i++){
 
+      // already processed in a previous run
+      if (dates[i].ce - 1970*365 <= last) continue;
+
       if (input[i].data[0][p] == input[i].nodata) continue;
 
       // predict value and compute residual
-      float y_pred = predict_harmonic_value(terms[i], &coefficients, p, n_coef, args.modes, args.trend);
-      float residual = input[i].data[0][p] - y_pred;
-
-      //printf("Pixel %d, Date %d-%03d, ce %d, index %d: Observed = %.2f, Predicted = %.2f, Residual = %.2f\n", 
-      //  p, dates[i].year, dates[i].doy, dates[i].ce, i, (float)input[i].data[0][p], y_pred, residual);
-
-      if (!confirmed){
-        // not yet confirmed, check and potentially raise alert
-        //printf("  Not yet confirmed.\n");
-        if (
-          args.threshold_residual > 0 && 
-          residual > args.threshold_residual &&
-          residual > (args.threshold_variability * variability.data[1][p])){
-          alert_number++;
-          //printf(" -> alert %d raised. Residual: %f, variability: %d\n", alert_number, residual, variability.data[1][p]);
-        } else if (
-          args.threshold_residual < 0 && 
-          residual < args.threshold_residual &&
-          residual < (args.threshold_variability * variability.data[1][p])){
-          alert_number++;
-          //printf(" -> alert %d raised. Residual: %f, variability: %d\n", alert_number, residual, variability.data[1][p]);
-        } else {
-          alert_number = 0;
-        }
-
-        if (alert_number == 1) candidate = i;
-        if (alert_number == args.confirmation_number){
-          confirmed = true;
-          n_alert++;
-          //break;
-        }
-        //printf("  candidate: %d, Alert counter: %d, revert counter: %d\n", candidate, alert_number, revert_number);
+      float residual;
+      if (lookup){
+        residual = input[i].data[0][p] - baseline.value[baseline.row[i]][p - baseline.p0];
       } else {
-        // already confirmed, check for reversion
-        //printf("  Already confirmed.\n");
-        if (
-          args.threshold_residual > 0 && 
-          residual < (args.threshold_residual / 2)){
-          revert_number++;
-        } else if (
-          args.threshold_residual < 0 && 
-          residual > (args.threshold_residual / 2)){
-          revert_number++;
-        } else {
-          revert_number = 0;
-        }
+        float y_pred = predict_harmonic_value(terms[i], coef, p, n_coef, args.modes, args.trend);
+        residual = input[i].data[0][p] - y_pred;
+      }
 
-        if (revert_number == args.confirmation_number){
-          // disturbance reverted
-          confirmed = false;
-          n_reversed++;
-          alert_number = 0;
-          revert_number = 0;
+      for (int d=0; d<n_directions; d++){
+        int event = update_detection(&detection[d], &rules[d], residual, variability.data[1][p], dates[i].ce);
+        if (event & _ALERT_CONFIRMED_) n_alert[d]++;
+        if (event & _ALERT_REVERTED_)  n_reversed[d]++;
+
+        if (write_alerts && event != _ALERT_NONE_){
+          for (int type=_ALERT_RAISED_; type<=_ALERT_REVERTED_; type<<=1){
+            if (!(event & type)) continue;
+            if (dates[i].ce - 1970*365 > watermark){
+              add_alert(&alerts[omp_get_thread_num()], p, 
+                dates[i].ce - 1970*365, type, direction_of_detection_rule(&rules[d]));
+            } else {
+              n_logged++;
+            }
+          }
         }
-        //printf("  candidate: %d, Alert counter: %d, revert counter: %d\n", candidate, alert_number, revert_number);
       }
 
     }
 
-    if (!confirmed) continue;
+    if (write_state){
+      active = false;
+      state_output.data[0][p] = (short)((last > last_date) ? last : last_date);
+      for (int d=0; d<n_directions; d++){
+        short state[_STATE_LENGTH_];
+        detection_to_state(&detection[d], state);
+        for (int s=0; s<_STATE_LENGTH_; s++) state_output.data[1 + d*_STATE_LENGTH_ + s][p] = state[s];
+        active |= detection_is_active(&detection[d]);
+      }
+      if (active){
+        for (int b=0; b<n_coef; b++) state_output.data[state_coef + b][p] = coef->data[b][p];
+      }
+    }
+
+    for (int d=0; d<n_directions; d++){
+
+      if (!detection[d].confirmed) continue;
+
+      n_detected[d]++;
 
-    n_detected++;
+      int year, doy;
+      ce2doy(detection[d].candidate, &doy, &year);
 
-    disturbance.data[0][p] = dates[candidate].ce - 1970*365;
-    disturbance.data[1][p] = dates[candidate].year;
-    disturbance.data[2][p] = dates[candidate].doy;    
+      disturbance[d].data[0][p] = detection[d].candidate - 1970*365;
+      disturbance[d].data[1][p] = year;
+      disturbance[d].data[2][p] = doy;
+
+      if (write_events){
+        event_t event = {
+          .pixel = p, .x = p % disturbance[d].nx, .y = p / disturbance[d].nx,
+          .direction = direction_of_detection_rule(&rules[d]),
+          .candidate = detection[d].candidate - 1970*365,
+          .year = year, .doy = doy,
+          .confirmation = detection[d].confirmation - 1970*365,
+          .n_reversed = detection[d].n_reversed };
+        add_event(&events[omp_get_thread_num()], &event);
+      }
+
+    }
 
   }
 
-   } // end omp parallel
+  if (args.lookup) free_baseline(&baseline);
 
-  printf("Alerts were produced for %d out of %d pixels, i.e. %.2f%%.\n", n_alert, n_pixels, 100.0 * n_alert / n_pixels);
-  printf("Alerts were reversed for %d out of %d pixels, i.e. %.2f%%.\n", n_reversed, n_pixels, 100.0 * n_reversed / n_pixels);
-  printf("Disturbances were detected for %d out of %d pixels, i.e. %.2f%%.\n", n_detected, n_pixels, 100.0 * n_detected / n_pixels);
 
-  write_image(&disturbance);
+  // finalize with the buffers already in memory, no need to re-read
+  if (write_mask || write_combined){
+
+    #pragma omp for schedule(static)
+    for (int p=0; p<disturbance[_PRIMARY_].nc; p++){
+
+      bool disturbed = disturbance[_PRIMARY_].data[0][p] != disturbance[_PRIMARY_].nodata &&
+                       disturbance[_PRIMARY_].data[0][p] > 0;
+
+      if (write_mask){
+        next_mask.data[0][p] = mask.data[0][p];
+        if (mask.data[0][p] != mask.nodata && mask.data[0][p] != 0 && disturbed) next_mask.data[0][p] = 0;
+      }
+
+      if (write_combined){
+        for (int b=0; b<combined_output.nb; b++){
+          short value;
+          if (read_combined){
+            value = combined_input.data[b][p];
+          } else {
+            value = (b == 0) ? combined_output.nodata : 0;
+          }
+          if (disturbance[_PRIMARY_].data[b][p] != disturbance[_PRIMARY_].nodata && 
+              disturbance[_PRIMARY_].data[b][p] > 0) value = disturbance[_PRIMARY_].data[b][p];
+          combined_output.data[b][p] = value;
+        }
+      }
+
+    }
+
+  }
+
+  } // end omp parallel
+
+  for (int d=0; d<n_directions; d++){
+    if (n_directions > 1) printf("Direction %+d:\n", direction_of_detection_rule(&rules[d]));
+    printf("Alerts were produced for %d out of %d pixels, i.e. %.2f%%.\n", n_alert[d], n_pixels, 100.0 * n_alert[d] / n_pixels);
+    printf("Alerts were reversed for %d out of %d pixels, i.e. %.2f%%.\n", n_reversed[d], n_pixels, 100.0 * n_reversed[d] / n_pixels);
+    printf("Disturbances were detected for %d out of %d pixels, i.e. %.2f%%.\n", n_detected[d], n_pixels, 100.0 * n_detected[d] / n_pixels);
+  }
+
+  for (int d=0; d<n_directions; d++) write_image(&disturbance[d]);
+  if (write_state) write_image(&state_output);
+  if (write_mask) write_image(&next_mask);
+  if (write_combined) write_image(&combined_output);
+
+  if (write_events){
+    eventlist_t merged;
+    merge_eventlists(events, args.n_cpus, &merged);
+    write_eventlist(&merged, args.path_events);
+    printf("Wrote %d events to %s.\n", merged.n, args.path_events);
+    free_eventlist(&merged);
+    free((void*)events);
+  }
+
+  write_manifests(&manifest, outputs, 6, args.incremental);
+
+  if (write_alerts){
+    alertlist_t merged;
+    merge_alertlists(alerts, args.n_cpus, &merged);
+    append_alertlog(args.path_alerts, &merged);
+    if (n_logged > 0) printf("Skipped %d alerts at or before the last logged date, they are already in %s.\n", n_logged, args.path_alerts);
+    free_alertlist(&merged);
+    free((void*)alerts);
+  }
 
   
   for (int i=0; i<args.n_images; i++){
@@ -200,9 +401,16 @@ image_t disturbance;
   free_image(&mask);
   free_image(&variability);
   free_image(&coefficients);
+  for (int d=0; d<n_directions; d++) free_image(&disturbance[d]);
+  if (read_state) free_image(&state_input);
+  if (write_state) free_image(&state_output);
+  if (write_mask) free_image(&next_mask);
+  if (read_combined) free_image(&combined_input);
+  if (write_combined) free_image(&combined_output);
   free((void*)dates);
   free_2D((void**)terms, args.n_images);
   free_2D((void**)args.path_input, args.n_images);
+  free_manifest(&manifest);
   
   GDALDestroy();
 
@@ -0,0 +1,915 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains the hungrybeetle library, i.e. the processing stages on
+caller-provided buffers. The per-pixel logic is the same as in the stage
+executables, and uses the same utils. Errors are returned, not exited on.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "hungrybeetle.h"
+
+#include <stdio.h>    // core input and output functions
+#include <stdlib.h>   // standard general utilities library
+#include <stdbool.h>  // boolean data type
+#include <string.h>   // string handling functions
+#include <limits.h>   // macro constants of the integer types
+
+/** GNU Scientific Library (GSL) **/
+#include <gsl/gsl_multifit.h> // Linear Least Squares Fitting
+
+/** OpenMP **/
+#include <omp.h> // multi-platform shared memory multiprocessing
+
+#include "../utils/alloc.h"
+#include "../utils/const.h"
+#include "../utils/date.h"
+#include "../utils/detection.h"
+#include "../utils/harmonic.h"
+#include "../utils/image_io.h"
+#include "../utils/indices.h"
+#include "../utils/quality.h"
+#include "../utils/reference.h"
+#include "../utils/spectral.h"
+#include "../utils/stats.h"
+
+
+// years of the per-year image ranges, as in reference_period
+#define _HB_YEARS_ 2100
+
+enum { _PRIMARY_, _OPPOSITE_, _DIRECTIONS_ };
+
+static const char *HB_ERROR_STRINGS[HB_ERRORS] = {
+  "success",
+  "missing or invalid argument",
+  "rasters do not match, or wrong number of bands",
+  "dates are not ordered, or out of range",
+  "out of memory" };
+
+
+int check_raster(const hb_raster_t *raster, const hb_raster_t *like, int nb);
+int wrap_raster(const hb_raster_t *raster, image_t *image);
+int wrap_stack(const hb_raster_t *raster, image_t **images);
+void free_raster(image_t *image);
+void free_stack(image_t *images);
+int wrap_dates(const int *dates, int n, date_t **date);
+int year_ranges(date_t *dates, int n, int ***range);
+int number_of_threads(int n_threads);
+void init_library(void) __attribute__((constructor));
+
+
+/** Initialize the library, when it is loaded
++++ GSL calls its error handler from the fits, and the default handler
++++ aborts. The handler is process-wide, thus changing it around each call
++++ would race with concurrent callers. It is turned off once instead, as
++++ the stage executables do; the fits return their status.
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_library(void){
+
+  gsl_set_error_handler_off();
+
+  return;
+}
+
+
+/** Version of the API
++++ Return: HB_API_VERSION of the library, compare with the header's
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int hb_version(void){
+
+  return HB_API_VERSION;
+}
+
+
+/** Description of a status
+--- status: status returned by a function of the library
++++ Return: description
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+const char *hb_error_string(int status){
+
+  if (status < 0 || status >= HB_ERRORS) return "unknown status";
+
+  return HB_ERROR_STRINGS[status];
+}
+
+
+/** Date of an image
++++ Dates are passed as days since 1970, the same unit as the disturbance
++++ dates in the outputs, i.e. 365 days per year from 1970 on.
+--- year:   year
+--- month:  month
+--- day:    day
++++ Return: days since 1970
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int hb_date(int year, int month, int day){
+
+  return date2ce(year, month, day) - 1970*365;
+}
+
+
+/** Spectral index, see spectral_index
++++ This function screens the pixels by mask and QAI rules, and computes
++++ the selected indices. Pixels that are screened out are set to the no-
++++ data value of the index.
+--- reflectance: BOA reflectance, all bands in FORCE order, i.e. the bands
++++              used by the indices are at their FORCE band numbers
+--- quality:     QAI, 1 band
+--- mask:        mask, 1 band, 0 or nodata = skip
+--- indices:     indices, e.g. CREM,NBR, or NULL for CREM
+--- qai_rules:   QAI screening rules, or NULL for the default rules
+--- index:       indices, one band per index (returned)
+--- n_threads:   number of threads, 0 = all
++++ Return:      HB_SUCCESS or error
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int hb_spectral_index(const hb_raster_t *reflectance, const hb_raster_t *quality, const hb_raster_t *mask,
+  const char *indices, const char *qai_rules, hb_raster_t *index, int n_threads){
+char spec[STRLEN];
+indexlist_t list;
+qai_rules_t rules;
+int slot[_BAND_ROLES_];
+image_t reflectance_ = { .data = NULL };
+image_t quality_ = { .data = NULL };
+image_t mask_ = { .data = NULL };
+image_t *index_ = NULL;
+int status;
+
+
+  if (indices == NULL) indices = _INDICES_DEFAULT_;
+  if (qai_rules == NULL) qai_rules = _QAI_RULES_DEFAULT_;
+
+  // the utils exit on strings that are too long
+  if (strlen(indices) >= STRLEN || strlen(qai_rules) >= STRLEN) return HB_ERROR_ARGUMENT;
+
+  strcpy(spec, indices);
+  if (select_indices(spec, &list) != SUCCESS || list.n == 0) return HB_ERROR_ARGUMENT;
+
+  strcpy(spec, qai_rules);
+  if (compile_qai_rules(spec, &rules) != SUCCESS) return HB_ERROR_ARGUMENT;
+
+  if ((status = check_raster(reflectance, mask, 0)) != HB_SUCCESS ||
+      (status = check_raster(quality, mask, 1)) != HB_SUCCESS ||
+      (status = check_raster(mask, mask, 1)) != HB_SUCCESS ||
+      (status = check_raster(index, mask, list.n)) != HB_SUCCESS) return status;
+
+  for (int r=0; r<_BAND_ROLES_; r++){
+    slot[r] = (list.bands & (1 << r)) ? INDEX_BAND_NUMBERS[r] - 1 : -1;
+    if (slot[r] >= reflectance->nb) return HB_ERROR_SHAPE;
+  }
+
+  if (wrap_raster(reflectance, &reflectance_) != HB_SUCCESS) return HB_ERROR_MEMORY;
+  if (wrap_raster(quality, &quality_) != HB_SUCCESS ||
+      wrap_raster(mask, &mask_) != HB_SUCCESS ||
+      wrap_stack(index, &index_) != HB_SUCCESS){
+    status = HB_ERROR_MEMORY;
+    goto done;
+  }
+
+  if (compute_indices(&reflectance_, slot, &quality_, &mask_, &rules, &list, index_,
+        number_of_threads(n_threads)) != SUCCESS) status = HB_ERROR_MEMORY;
+
+  done:
+  free_raster(&reflectance_);
+  free_raster(&quality_);
+  free_raster(&mask_);
+  free_stack(index_);
+
+  return status;
+}
+
+
+/** Reference period, see reference_period
++++ This function extends the reference period of each pixel until the
++++ given year, and refits the harmonic model of the stable pixels. With-
++++ out previous coefficients, the model is fitted for the first time. The
++++ outputs are set to their nodata value outside the mask, and where
++++ there are not enough observations.
+--- input:                 index, one band per image, ordered by date
+--- dates:                 dates of the images, see hb_date, none after
++++                        the given year
+--- mask:                  mask, 1 band, 0 or nodata = skip
+--- previous_reference:    previous reference period, 2 bands, or NULL
+--- previous_coefficients: previous coefficients, or NULL for the first
++++                        fit (a 1-band raster counts as none as well)
+--- year:                  year to extend the reference period until
+--- modes:                 number of harmonic modes (1-3)
+--- trend:                 use a trend coefficient? (0/1)
+--- threshold:             residual threshold, the sign gives the direction
+--- confirmation_number:   consecutive anomalies to stop the extension
+--- lookup:                use the baseline tables? (0/1)
+--- reference:             reference period, 2 bands (returned)
+--- coefficients:          coefficients, 1 + 2 * modes + trend bands
++++                        (returned)
+--- variability:           variability in the last year of the reference
++++                        period, 2 bands (returned), or NULL
+--- robust:                robust estimator of band 2 of the variability,
++++                        HB_ROBUST_MAD, HB_ROBUST_IQR or HB_ROBUST_TRIMMED
+--- n_threads:             number of threads, 0 = all
++++ Return:                HB_SUCCESS or error
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int hb_reference_period(const hb_raster_t *input, const int *dates, const hb_raster_t *mask,
+  const hb_raster_t *previous_reference, const hb_raster_t *previous_coefficients,
+  int year, int modes, int trend, int threshold, int confirmation_number, int lookup,
+  hb_raster_t *reference, hb_raster_t *coefficients, hb_raster_t *variability, int robust, int n_threads){
+image_t *input_ = NULL;
+image_t mask_ = { .data = NULL };
+image_t input_reference_period = { .data = NULL };
+image_t input_coefficients = { .data = NULL };
+image_t output_reference_period = { .data = NULL };
+image_t output_coefficients = { .data = NULL };
+image_t output_variability = { .data = NULL };
+date_t *date = NULL;
+float **terms = NULL;
+int **range = NULL;
+int status;
+
+
+  if (modes < 1 || modes > 3 || (trend != 0 && trend != 1) || confirmation_number < 1 ||
+      robust < HB_ROBUST_MAD || robust > HB_ROBUST_TRIMMED) return HB_ERROR_ARGUMENT;
+
+  int n_coef = number_of_coefficients(modes, trend);
+  bool initial = previous_coefficients == NULL || previous_coefficients->nb == 1;
+
+  if ((status = check_raster(input, mask, 0)) != HB_SUCCESS ||
+      (status = check_raster(mask, mask, 1)) != HB_SUCCESS ||
+      (status = check_raster(reference, mask, 2)) != HB_SUCCESS ||
+      (status = check_raster(coefficients, mask, n_coef)) != HB_SUCCESS) return status;
+
+  if (variability != NULL && (status = check_raster(variability, mask, 2)) != HB_SUCCESS) return status;
+
+  if (!initial){
+    if ((status = check_raster(previous_reference, mask, 2)) != HB_SUCCESS ||
+        (status = check_raster(previous_coefficients, mask, n_coef)) != HB_SUCCESS) return status;
+  }
+
+  int n_images = input->nb;
+
+  if ((status = wrap_dates(dates, n_images, &date)) != HB_SUCCESS) return status;
+
+  int i_break = -1;
+
+  for (int i=0; i<n_images; i++){
+    if (date[i].year == year && i_break < 0) i_break = i;
+    if (date[i].year > year) status = HB_ERROR_DATE;
+  }
+
+  if (i_break < 0) status = HB_ERROR_DATE;
+  if (status != HB_SUCCESS){
+    free((void*)date);
+    return status;
+  }
+
+  // views on the caller's buffers
+  if (wrap_stack(input, &input_) != HB_SUCCESS ||
+      wrap_raster(mask, &mask_) != HB_SUCCESS ||
+      wrap_raster(reference, &output_reference_period) != HB_SUCCESS ||
+      wrap_raster(coefficients, &output_coefficients) != HB_SUCCESS ||
+      (variability != NULL && wrap_raster(variability, &output_variability) != HB_SUCCESS) ||
+      (!initial && wrap_raster(previous_reference, &input_reference_period) != HB_SUCCESS) ||
+      (!initial && wrap_raster(previous_coefficients, &input_coefficients) != HB_SUCCESS) ||
+      try_alloc_2D((void***)&terms, n_images, n_coef, sizeof(float)) != SUCCESS ||
+      (variability != NULL && year_ranges(date, n_images, &range) != HB_SUCCESS)){
+    status = HB_ERROR_MEMORY;
+    goto done;
+  }
+
+  reference_rule_t rule = {
+    .year = year, .threshold = threshold, .confirmation_number = confirmation_number,
+    .modes = modes, .trend = trend };
+
+  compute_harmonic_terms(date, n_images, modes, trend, terms);
+
+  bool failed = false;
+
+  #pragma omp parallel num_threads(number_of_threads(n_threads)) shared(rule, initial, lookup, date, i_break, n_images, n_coef, input_, mask_, terms, range, robust, variability, input_reference_period, input_coefficients, output_reference_period, output_coefficients, output_variability, failed) default(none)
+  {
+
+    gsl_vector *coef = gsl_vector_alloc(n_coef);
+    gsl_matrix *cov = gsl_matrix_alloc(n_coef, n_coef);
+
+    // per-thread baseline table of the given year's images, and scratch buffer
+    baseline_t baseline;
+    double *buffer = NULL;
+    bool use_baseline = lookup && !initial;
+    bool has_baseline = use_baseline && try_init_baseline(date + i_break, n_images - i_break, rule.trend, &baseline) == SUCCESS;
+    bool has_buffer = variability != NULL && try_alloc((void**)&buffer, n_images, sizeof(double)) == SUCCESS;
+    bool ready = coef != NULL && cov != NULL && has_baseline == use_baseline && has_buffer == (variability != NULL);
+
+    if (!ready){
+      #pragma omp atomic write
+      failed = true;
+    }
+
+  #pragma omp for schedule(static, _BASELINE_BLOCK_)
+  for (int p=0; p<output_reference_period.nc; p++){
+
+    if (!ready) continue;
+
+    for (int b=0; b<output_coefficients.nb; b++) output_coefficients.data[b][p] = output_coefficients.nodata;
+    for (int b=0; b<output_reference_period.nb; b++) output_reference_period.data[b][p] = output_reference_period.nodata;
+    if (variability != NULL){
+      for (int b=0; b<output_variability.nb; b++) output_variability.data[b][p] = output_variability.nodata;
+    }
+
+    if (mask_.data[0][p] == mask_.nodata || mask_.data[0][p] == 0) continue;
+
+    int outcome = extend_reference_period(&rule, input_, terms, n_images, i_break, initial,
+      initial ? NULL : &input_reference_period, initial ? NULL : &input_coefficients,
+      has_baseline ? &baseline : NULL, p, coef, cov, &output_reference_period, &output_coefficients);
+
+    if (outcome == _REFERENCE_INVALID_) continue;
+
+    if (variability != NULL) reference_variability(input_, range, output_reference_period.data[0][p], p, robust, buffer, &output_variability);
+
+  }
+
+    if (coef != NULL) gsl_vector_free(coef);
+    if (cov != NULL) gsl_matrix_free(cov);
+    if (has_baseline) free_baseline(&baseline);
+    free((void*)buffer);
+
+  } // end omp parallel region
+
+  if (failed) status = HB_ERROR_MEMORY;
+
+  done:
+  free_stack(input_);
+  free_raster(&mask_);
+  free_raster(&output_reference_period);
+  free_raster(&output_coefficients);
+  free_raster(&output_variability);
+  free_raster(&input_reference_period);
+  free_raster(&input_coefficients);
+  if (terms != NULL) free_2D((void**)terms, n_images);
+  if (range != NULL) free_2D((void**)range, _HB_YEARS_);
+  free((void*)date);
+
+  return status;
+}
+
+
+/** Temporal variability, see temporal_variability
++++ This function computes the standard deviation of the valid observa-
++++ tions of each pixel in the last year of its reference period. Pixels
++++ outside the mask are 0, pixels without observations are nodata.
+--- input:       index, one band per image, ordered by date
+--- dates:       dates of the images, see hb_date
+--- mask:        mask, 1 band, 0 or nodata = skip
+--- reference:   reference period, the year is band 1
+--- variability: variability, 1 band (returned)
+--- n_threads:   number of threads, 0 = all
++++ Return:      HB_SUCCESS or error
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int hb_temporal_variability(const hb_raster_t *input, const int *dates, const hb_raster_t *mask,
+  const hb_raster_t *reference, hb_raster_t *variability, int n_threads){
+image_t *input_ = NULL;
+image_t mask_ = { .data = NULL };
+image_t reference_ = { .data = NULL };
+image_t variability_ = { .data = NULL };
+date_t *date = NULL;
+int **range = NULL;
+int status;
+
+
+  if ((status = check_raster(input, mask, 0)) != HB_SUCCESS ||
+      (status = check_raster(mask, mask, 1)) != HB_SUCCESS ||
+      (status = check_raster(reference, mask, 0)) != HB_SUCCESS ||
+      (status = check_raster(variability, mask, 1)) != HB_SUCCESS) return status;
+
+  int n_images = input->nb;
+
+  if ((status = wrap_dates(dates, n_images, &date)) != HB_SUCCESS) return status;
+
+  if (wrap_stack(input, &input_) != HB_SUCCESS ||
+      wrap_raster(mask, &mask_) != HB_SUCCESS ||
+      wrap_raster(reference, &reference_) != HB_SUCCESS ||
+      wrap_raster(variability, &variability_) != HB_SUCCESS ||
+      year_ranges(date, n_images, &range) != HB_SUCCESS){
+    status = HB_ERROR_MEMORY;
+    goto done;
+  }
+
+  #pragma omp parallel for num_threads(number_of_threads(n_threads)) shared(input_, mask_, reference_, variability_, range) default(none) schedule(static)
+  for (int p=0; p<variability_.nc; p++){
+
+    short msk = mask_.data[0][p];
+    short ref = reference_.data[0][p];
+
+    if (msk == mask_.nodata || msk == 0){
+      variability_.data[0][p] = 0;
+      continue;
+    }
+
+    variability_.data[0][p] = variability_.nodata;
+
+    if (ref == reference_.nodata || ref < 0 || ref >= _HB_YEARS_) continue;
+
+    double n = 0, mean = 0, var = 0;
+
+    for (int i=range[ref][0]; i<range[ref][1]; i++){
+      if (input_[i].data[0][p] == input_[i].nodata) continue;
+      var_recurrence(input_[i].data[0][p], &mean, &var, ++n);
+    }
+
+    if (n > 0) variability_.data[0][p] = (short)standdev(var, n);
+
+  }
+
+  done:
+  free_stack(input_);
+  free_raster(&mask_);
+  free_raster(&reference_);
+  free_raster(&variability_);
+  if (range != NULL) free_2D((void**)range, _HB_YEARS_);
+  free((void*)date);
+
+  return status;
+}
+
+
+/** Disturbance detection, see disturbance_detection
++++ This function predicts each observation with the harmonic model, and
++++ runs the alerting state machine on the residuals. The disturbance
++++ bands are the date of the first anomaly (days since 1970), its year
++++ and DOY, and 0 where no disturbance was confirmed. With state, the
++++ detection resumes where the previous run stopped (rolling window).
+--- input:                 index, one band per image, ordered by date
+--- dates:                 dates of the images, see hb_date, all in the
++++                        same year without state
+--- mask:                  mask, 1 band, 0 or nodata = skip
+--- variability:           variability, band 2 is used, e.g. the reference
++++                        period
+--- coefficients:          coefficients, 1 + 2 * modes + trend bands
+--- modes:                 number of harmonic modes (1-3)
+--- trend:                 use a trend coefficient? (0/1)
+--- threshold_variability: variability multiplier, the sign gives the
++++                        direction
+--- threshold_residual:    residual threshold, same sign
+--- confirmation_number:   consecutive observations to confirm or revert
+--- lookup:                use the baseline tables? (0/1)
+--- state_input:           state of the previous run, or NULL
+--- state_output:          state after this run (returned), or NULL, both
++++                        have 1 + directions * 6 + coefficients bands
+--- disturbance:           disturbances, 3 bands (returned)
+--- opposite:              disturbances in the opposite direction, 3 bands
++++                        (returned), or NULL
+--- n_threads:             number of threads, 0 = all
++++ Return:                HB_SUCCESS or error
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int hb_disturbance_detection(const hb_raster_t *input, const int *dates, const hb_raster_t *mask,
+  const hb_raster_t *variability, const hb_raster_t *coefficients, int modes, int trend,
+  float threshold_variability, float threshold_residual, int confirmation_number, int lookup,
+  const hb_raster_t *state_input, hb_raster_t *state_output,
+  hb_raster_t *disturbance, hb_raster_t *opposite, int n_threads){
+image_t *input_ = NULL;
+image_t mask_ = { .data = NULL };
+image_t variability_ = { .data = NULL };
+image_t coefficients_ = { .data = NULL };
+image_t state_input_ = { .data = NULL };
+image_t state_output_ = { .data = NULL };
+image_t carried;
+image_t disturbance_[_DIRECTIONS_] = { { .data = NULL }, { .data = NULL } };
+date_t *date = NULL;
+float **terms = NULL;
+int status;
+
+
+  if (modes < 1 || modes > 3 || (trend != 0 && trend != 1) || confirmation_number < 1) return HB_ERROR_ARGUMENT;
+
+  int n_coef = number_of_coefficients(modes, trend);
+  int n_directions = (opposite != NULL) ? 2 : 1;
+  int n_state = 1 + n_directions * _STATE_LENGTH_ + n_coef;
+  int state_coef = 1 + n_directions * _STATE_LENGTH_;
+  bool read_state  = (state_input != NULL);
+  bool write_state = (state_output != NULL);
+  bool rolling = read_state || write_state;
+
+  if ((status = check_raster(input, mask, 0)) != HB_SUCCESS ||
+      (status = check_raster(mask, mask, 1)) != HB_SUCCESS ||
+      (status = check_raster(variability, mask, 0)) != HB_SUCCESS ||
+      (status = check_raster(coefficients, mask, n_coef)) != HB_SUCCESS ||
+      (status = check_raster(disturbance, mask, 3)) != HB_SUCCESS) return status;
+
+  if (variability->nb < 2) return HB_ERROR_SHAPE;
+  if (opposite != NULL && (status = check_raster(opposite, mask, 3)) != HB_SUCCESS) return status;
+  if (read_state && (status = check_raster(state_input, mask, n_state)) != HB_SUCCESS) return status;
+  if (write_state && (status = check_raster(state_output, mask, n_state)) != HB_SUCCESS) return status;
+
+  int n_images = input->nb;
+
+  if ((status = wrap_dates(dates, n_images, &date)) != HB_SUCCESS) return status;
+
+  for (int i=1; i<n_images; i++){
+    if (!rolling && date[i].year != date[i-1].year) status = HB_ERROR_DATE;
+  }
+
+  if (status != HB_SUCCESS){
+    free((void*)date);
+    return status;
+  }
+
+  if (wrap_stack(input, &input_) != HB_SUCCESS ||
+      wrap_raster(mask, &mask_) != HB_SUCCESS ||
+      wrap_raster(variability, &variability_) != HB_SUCCESS ||
+      wrap_raster(coefficients, &coefficients_) != HB_SUCCESS ||
+      wrap_raster(disturbance, &disturbance_[_PRIMARY_]) != HB_SUCCESS ||
+      (opposite != NULL && wrap_raster(opposite, &disturbance_[_OPPOSITE_]) != HB_SUCCESS) ||
+      (read_state && wrap_raster(state_input, &state_input_) != HB_SUCCESS) ||
+      (write_state && wrap_raster(state_output, &state_output_) != HB_SUCCESS) ||
+      try_alloc_2D((void***)&terms, n_images, n_coef, sizeof(float)) != SUCCESS){
+    status = HB_ERROR_MEMORY;
+    goto done;
+  }
+
+  // detection rules, optionally for both directions
+  detection_rule_t rules[_DIRECTIONS_];
+  rules[_PRIMARY_].threshold_residual = threshold_residual;
+  rules[_PRIMARY_].threshold_variability = threshold_variability;
+  rules[_PRIMARY_].confirmation_number = confirmation_number;
+  opposite_detection_rule(&rules[_PRIMARY_], &rules[_OPPOSITE_]);
+
+  compute_harmonic_terms(date, n_images, modes, trend, terms);
+
+  int last_date = date[n_images-1].ce - 1970*365;
+
+  // view on the carried coefficients, the data is owned by the state
+  if (read_state){
+    carried = coefficients_;
+    carried.data = state_input_.data + state_coef;
+    carried.nodata = state_input_.nodata;
+  }
+
+  bool failed = false;
+
+  #pragma omp parallel num_threads(number_of_threads(n_threads)) shared(date, n_images, input_, mask_, variability_, coefficients_, disturbance_, n_coef, modes, trend, lookup, terms, rules, n_directions, read_state, write_state, state_input_, state_output_, carried, state_coef, last_date, failed) default(none)
+  {
+
+  // per-thread baseline table, blocks are aligned with the schedule's chunks
+  baseline_t baseline;
+  bool ready = !lookup || try_init_baseline(date, n_images, trend, &baseline) == SUCCESS;
+
+  if (!ready){
+    #pragma omp atomic write
+    failed = true;
+  }
+
+  #pragma omp for schedule(static, _BASELINE_BLOCK_)
+  for (int p=0; p<disturbance_[_PRIMARY_].nc; p++){
+
+    if (!ready) continue;
+
+    for (int d=0; d<n_directions; d++){
+      for (int b=0; b<disturbance_[d].nb; b++) disturbance_[d].data[b][p] = 0;
+    }
+
+    if (write_state){
+      for (int b=0; b<state_output_.nb; b++) state_output_.data[b][p] = state_output_.nodata;
+    }
+
+    if (mask_.data[0][p] == mask_.nodata || mask_.data[0][p] == 0) continue;
+
+    if (variability_.data[1][p] == variability_.nodata) continue;
+    if (coefficients_.data[1][p] == coefficients_.nodata) continue;
+
+    // independent alerting state per direction
+    detection_t detection[_DIRECTIONS_];
+    for (int d=0; d<n_directions; d++) init_detection(&detection[d]);
+
+    // resume from previous state, keep the coefficients of active alerts
+    image_t *coef = &coefficients_;
+    int last = INT_MIN;
+    bool active = false;
+
+    if (read_state && state_input_.data[0][p] != state_input_.nodata){
+      last = state_input_.data[0][p];
+      for (int d=0; d<n_directions; d++){
+        short state[_STATE_LENGTH_];
+        for (int s=0; s<_STATE_LENGTH_; s++) state[s] = state_input_.data[1 + d*_STATE_LENGTH_ + s][p];
+        state_to_detection(state, &detection[d]);
+        active |= detection_is_active(&detection[d]);
+      }
+      if (active && carried.data[0][p] != carried.nodata) coef = &carried;
+    }
+
+    bool use_baseline = lookup && coef == &coefficients_;
+    if (use_baseline) predict_baseline(terms, &coefficients_, n_coef, p, &baseline);
+
+    for (int i=0; i<n_images; i++){
+
+      // already processed in a previous run
+      if (date[i].ce - 1970*365 <= last) continue;
+
+      if (input_[i].data[0][p] == input_[i].nodata) continue;
+
+      float residual;
+      if (use_baseline){
+        residual = input_[i].data[0][p] - baseline.value[baseline.row[i]][p - baseline.p0];
+      } else {
+        float y_pred = predict_harmonic_value(terms[i], coef, p, n_coef, modes, trend);
+        residual = input_[i].data[0][p] - y_pred;
+      }
+
+      for (int d=0; d<n_directions; d++){
+        update_detection(&detection[d], &rules[d], residual, variability_.data[1][p], date[i].ce);
+      }
+
+    }
+
+    if (write_state){
+      active = false;
+      state_output_.data[0][p] = (short)((last > last_date) ? last : last_date);
+      for (int d=0; d<n_directions; d++){
+        short state[_STATE_LENGTH_];
+        detection_to_state(&detection[d], state);
+        for (int s=0; s<_STATE_LENGTH_; s++) state_output_.data[1 + d*_STATE_LENGTH_ + s][p] = state[s];
+        active |= detection_is_active(&detection[d]);
+      }
+      if (active){
+        for (int b=0; b<n_coef; b++) state_output_.data[state_coef + b][p] = coef->data[b][p];
+      }
+    }
+
+    for (int d=0; d<n_directions; d++){
+
+      if (!detection[d].confirmed) continue;
+
+      int year, doy;
+      ce2doy(detection[d].candidate, &doy, &year);
+
+      disturbance_[d].data[0][p] = detection[d].candidate - 1970*365;
+      disturbance_[d].data[1][p] = year;
+      disturbance_[d].data[2][p] = doy;
+
+    }
+
+  }
+
+  if (lookup && ready) free_baseline(&baseline);
+
+  } // end omp parallel region
+
+  if (failed) status = HB_ERROR_MEMORY;
+
+  done:
+  free_stack(input_);
+  free_raster(&mask_);
+  free_raster(&variability_);
+  free_raster(&coefficients_);
+  free_raster(&disturbance_[_PRIMARY_]);
+  free_raster(&disturbance_[_OPPOSITE_]);
+  free_raster(&state_input_);
+  free_raster(&state_output_);
+  if (terms != NULL) free_2D((void**)terms, n_images);
+  free((void*)date);
+
+  return status;
+}
+
+
+/** Mask update, see update_mask
++++ This function removes the disturbed pixels from the mask.
+--- disturbance: disturbances, the date is band 1
+--- mask:        mask, 1 band
+--- output:      mask of the next year, 1 band (returned), may be the mask
++++ Return:      HB_SUCCESS or error
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int hb_update_mask(const hb_raster_t *disturbance, const hb_raster_t *mask, hb_raster_t *output){
+image_t disturbance_ = { .data = NULL };
+image_t mask_ = { .data = NULL };
+image_t output_ = { .data = NULL };
+int status;
+
+
+  if ((status = check_raster(disturbance, mask, 0)) != HB_SUCCESS ||
+      (status = check_raster(mask, mask, 1)) != HB_SUCCESS ||
+      (status = check_raster(output, mask, 1)) != HB_SUCCESS) return status;
+
+  if (wrap_raster(disturbance, &disturbance_) != HB_SUCCESS ||
+      wrap_raster(mask, &mask_) != HB_SUCCESS ||
+      wrap_raster(output, &output_) != HB_SUCCESS){
+    status = HB_ERROR_MEMORY;
+    goto done;
+  }
+
+  for (int p=0; p<output_.nc; p++){
+
+    output_.data[0][p] = mask_.data[0][p];
+
+    if (mask_.data[0][p] == mask_.nodata || mask_.data[0][p] == 0 ||
+        disturbance_.data[0][p] == disturbance_.nodata) continue;
+
+    if (disturbance_.data[0][p] > 0) output_.data[0][p] = 0;
+
+  }
+
+  done:
+  free_raster(&disturbance_);
+  free_raster(&mask_);
+  free_raster(&output_);
+
+  return status;
+}
+
+
+/** Combined disturbances, see combine_disturbances
++++ This function merges the disturbances of several years, the latest
++++ valid disturbance wins. Where there is none, band 1 is nodata and the
++++ other bands are 0.
+--- disturbances:   disturbances, ordered by year
+--- n_disturbances: number of disturbances
+--- output:         combined disturbances, same bands (returned)
++++ Return:         HB_SUCCESS or error
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int hb_combine_disturbances(const hb_raster_t *disturbances, int n_disturbances, hb_raster_t *output){
+image_t input;
+image_t output_ = { .data = NULL };
+int status;
+
+
+  if (disturbances == NULL || n_disturbances < 1) return HB_ERROR_ARGUMENT;
+
+  if ((status = check_raster(output, &disturbances[0], 0)) != HB_SUCCESS) return status;
+
+  for (int i=0; i<n_disturbances; i++){
+    if ((status = check_raster(&disturbances[i], output, output->nb)) != HB_SUCCESS) return status;
+  }
+
+  if (wrap_raster(output, &output_) != HB_SUCCESS) return HB_ERROR_MEMORY;
+
+  for (int b=0; b<output_.nb; b++){
+    short value = (b == 0) ? output_.nodata : 0;
+    for (int p=0; p<output_.nc; p++) output_.data[b][p] = value;
+  }
+
+  for (int i=0; i<n_disturbances; i++){
+
+    if (wrap_raster(&disturbances[i], &input) != HB_SUCCESS){
+      status = HB_ERROR_MEMORY;
+      break;
+    }
+
+    for (int b=0; b<input.nb; b++){
+      short *in = input.data[b];
+      short *out = output_.data[b];
+      #pragma omp simd
+      for (int p=0; p<output_.nc; p++){
+        if (in[p] != input.nodata && in[p] > 0) out[p] = in[p];
+      }
+    }
+
+    free_raster(&input);
+
+  }
+
+  free_raster(&output_);
+
+  return status;
+}
+
+
+/** Check a raster
++++ The raster must be given and have the size of another raster, and the
++++ given number of bands.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int check_raster(const hb_raster_t *raster, const hb_raster_t *like, int nb){
+
+  if (raster == NULL || like == NULL) return HB_ERROR_ARGUMENT;
+  if (raster->data == NULL && raster->bands == NULL) return HB_ERROR_ARGUMENT;
+  if (raster->nx < 1 || raster->ny < 1 || raster->nb < 1) return HB_ERROR_SHAPE;
+
+  if (raster->bands != NULL){
+    for (int b=0; b<raster->nb; b++){
+      if (raster->bands[b] == NULL) return HB_ERROR_ARGUMENT;
+    }
+  }
+
+  if (raster->nx != like->nx || raster->ny != like->ny) return HB_ERROR_SHAPE;
+  if (nb > 0 && raster->nb != nb) return HB_ERROR_SHAPE;
+
+  return HB_SUCCESS;
+}
+
+
+/** View on a raster as image
++++ Only the band pointers are allocated, free with free_raster.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int wrap_raster(const hb_raster_t *raster, image_t *image){
+ptrdiff_t stride = (raster->band_stride != 0) ? raster->band_stride : (ptrdiff_t)raster->nx * raster->ny;
+
+
+  memset(image, 0, sizeof(image_t));
+  image->nx = raster->nx;
+  image->ny = raster->ny;
+  image->nc = raster->nx * raster->ny;
+  image->nb = raster->nb;
+  image->nodata = raster->nodata;
+
+  if (try_alloc((void**)&image->data, raster->nb, sizeof(short*)) != SUCCESS) return HB_ERROR_MEMORY;
+
+  for (int b=0; b<raster->nb; b++){
+    image->data[b] = (raster->bands != NULL) ? raster->bands[b] : raster->data + b * stride;
+  }
+
+  return HB_SUCCESS;
+}
+
+
+/** View on a stack of rasters as images, one per band
++++ free with free_stack.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int wrap_stack(const hb_raster_t *raster, image_t **images){
+image_t stack;
+
+
+  *images = NULL;
+
+  if (wrap_raster(raster, &stack) != HB_SUCCESS) return HB_ERROR_MEMORY;
+
+  if (try_alloc((void**)images, raster->nb, sizeof(image_t)) != SUCCESS){
+    free_raster(&stack);
+    return HB_ERROR_MEMORY;
+  }
+
+  // the band pointers are owned by the first image
+  for (int i=0; i<raster->nb; i++){
+    (*images)[i] = stack;
+    (*images)[i].nb = 1;
+    (*images)[i].data = stack.data + i;
+  }
+
+  return HB_SUCCESS;
+}
+
+
+/** Free a view on a raster
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_raster(image_t *image){
+
+  free((void*)image->data);
+  image->data = NULL;
+
+  return;
+}
+
+
+/** Free a view on a stack of rasters
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_stack(image_t *images){
+
+  if (images == NULL) return;
+
+  free((void*)images[0].data);
+  free((void*)images);
+
+  return;
+}
+
+
+/** Dates from days since 1970
++++ The dates must be ordered, and within the years of the executables.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int wrap_dates(const int *dates, int n, date_t **date){
+
+
+  *date = NULL;
+
+  if (dates == NULL || n < 1) return HB_ERROR_ARGUMENT;
+
+  for (int i=0; i<n; i++){
+    if (dates[i] + 1970*365 < 1900*365 || dates[i] + 1970*365 >= _HB_YEARS_*365) return HB_ERROR_DATE;
+    if (i > 0 && dates[i] < dates[i-1]) return HB_ERROR_DATE;
+  }
+
+  if (try_alloc((void**)date, n, sizeof(date_t)) != SUCCESS) return HB_ERROR_MEMORY;
+
+  for (int i=0; i<n; i++){
+    init_date(&(*date)[i]);
+    set_date_ce(&(*date)[i], dates[i] + 1970*365);
+  }
+
+  return HB_SUCCESS;
+}
+
+
+/** First and last+1 image of each year, see reference_period
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int year_ranges(date_t *dates, int n, int ***range){
+
+
+  if (try_alloc_2D((void***)range, _HB_YEARS_, 2, sizeof(int)) != SUCCESS) return HB_ERROR_MEMORY;
+
+  // dates are ordered, the end is 0 until the first image of the year
+  for (int i=0; i<n; i++){
+    if ((*range)[dates[i].year][1] == 0) (*range)[dates[i].year][0] = i;
+    (*range)[dates[i].year][1] = i+1;
+  }
+
+  return HB_SUCCESS;
+}
+
+
+/** Number of threads, 0 = all
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int number_of_threads(int n_threads){
+
+  return (n_threads > 0) ? n_threads : omp_get_max_threads();
+}
+
@@ -0,0 +1,88 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+hungrybeetle library header
+
+The processing stages on caller-provided buffers, i.e. without files. The
+functions return a status and never exit, such that the library can be
+called in-process, e.g. from Python with ctypes or cffi on NumPy arrays.
+This header is self-contained, it does not need GDAL or GSL.
+Side effects on the calling process: loading the library turns the GSL
+error handler off, process-wide and once, since the default handler would
+abort the caller. The shared utils still print warnings and progress to
+stdout and stderr, e.g. on fits that do not converge.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef HUNGRYBEETLE_H
+#define HUNGRYBEETLE_H
+
+#include <stddef.h>   // standard type definitions
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// version of the API, incremented when a signature or struct changes
+#define HB_API_VERSION 1
+
+#if defined(__GNUC__)
+#define HB_API __attribute__((visibility("default")))
+#else
+#define HB_API
+#endif
+
+// status codes
+enum { HB_SUCCESS = 0,      // done
+       HB_ERROR_ARGUMENT,   // missing or invalid argument
+       HB_ERROR_SHAPE,      // rasters do not match, or wrong number of bands
+       HB_ERROR_DATE,       // dates are not ordered, or out of range
+       HB_ERROR_MEMORY,     // out of memory
+       HB_ERRORS };
+
+// robust estimators of the standard deviation
+enum { HB_ROBUST_MAD = 0, HB_ROBUST_IQR = 1, HB_ROBUST_TRIMMED = 2 };
+
+// view on a int16 raster owned by the caller, nothing is copied
+// the pixels of one band are row-major and contiguous, i.e. a C-contiguous
+// (ny, nx) array per band. The bands are either given by one pointer per
+// band (e.g. image_t.data), or by the first band and the distance between
+// bands, e.g. a (nb, ny, nx) array, or a stack of images in time.
+typedef struct {
+  short *data;           // first pixel of the first band, if bands is NULL
+  short **bands;         // first pixel of each band, or NULL
+  ptrdiff_t band_stride; // pixels between the bands in data, 0 = nx * ny
+  int nx, ny, nb;        // columns, rows and bands
+  short nodata;          // nodata value
+} hb_raster_t;
+
+HB_API int hb_version(void);
+HB_API const char *hb_error_string(int status);
+HB_API int hb_date(int year, int month, int day);
+
+HB_API int hb_spectral_index(const hb_raster_t *reflectance, const hb_raster_t *quality, const hb_raster_t *mask,
+  const char *indices, const char *qai_rules, hb_raster_t *index, int n_threads);
+
+HB_API int hb_reference_period(const hb_raster_t *input, const int *dates, const hb_raster_t *mask,
+  const hb_raster_t *previous_reference, const hb_raster_t *previous_coefficients,
+  int year, int modes, int trend, int threshold, int confirmation_number, int lookup,
+  hb_raster_t *reference, hb_raster_t *coefficients, hb_raster_t *variability, int robust, int n_threads);
+
+HB_API int hb_temporal_variability(const hb_raster_t *input, const int *dates, const hb_raster_t *mask,
+  const hb_raster_t *reference, hb_raster_t *variability, int n_threads);
+
+HB_API int hb_disturbance_detection(const hb_raster_t *input, const int *dates, const hb_raster_t *mask,
+  const hb_raster_t *variability, const hb_raster_t *coefficients, int modes, int trend,
+  float threshold_variability, float threshold_residual, int confirmation_number, int lookup,
+  const hb_raster_t *state_input, hb_raster_t *state_output,
+  hb_raster_t *disturbance, hb_raster_t *opposite, int n_threads);
+
+HB_API int hb_update_mask(const hb_raster_t *disturbance, const hb_raster_t *mask, hb_raster_t *output);
+
+HB_API int hb_combine_disturbances(const hb_raster_t *disturbances, int n_disturbances, hb_raster_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
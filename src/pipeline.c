@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/** Geospatial Data Abstraction Library (GDAL) **/
+#include "gdal.h"       // public (C callable) GDAL entry points
+#include "cpl_conv.h"   // various convenience functions for CPL
+#include "cpl_string.h" // various convenience functions for strings
+
+/** GNU Scientific Library (GSL) **/
+#include <gsl/gsl_multifit.h> // Linear Least Squares Fitting
+
+/** OpenMP **/
+#include <omp.h> // multi-platform shared memory multiprocessing
+
+#include "utils/alloc.h"
+#include "utils/chain.h"
+#include "utils/checkpoint.h"
+#include "utils/const.h"
+#include "utils/detection.h"
+#include "utils/image_io.h"
+#include "utils/indices.h"
+#include "utils/plan.h"
+#include "utils/quality.h"
+#include "utils/spectral.h"
+#include "utils/string.h"
+#include "args/args_pipeline.h"
+
+
+int main ( int argc, char *argv[] ){
+args_t args;
+chain_t chain;
+qai_rules_t qai_rules;
+image_t info;
+image_t mask;
+image_t *input = NULL;
+image_t **output = NULL;
+GDALDatasetH *fp_index = NULL;
+checkpoint_t checkpoint;
+bool resumed = false;
+
+
+  parse_args(argc, argv, &args);
+
+  if (compile_qai_rules(args.qai_rules, &qai_rules) != SUCCESS){
+    fprintf(stderr, "Could not compile QAI screening rules.\n");
+    exit(FAILURE);
+  }
+
+  GDALAllRegister();
+
+  // check the images, but do not read them yet
+  read_image_info(args.path_mask, &info);
+
+  for (int i=0; i<args.n_scenes; i++){
+    image_t scene_info;
+    read_image_info(args.path_reflectance[i], &scene_info);
+    compare_images(&info, &scene_info);
+    read_image_info(args.path_quality[i], &scene_info);
+    compare_images(&info, &scene_info);
+  }
+
+  detection_rule_t rule = {
+    .threshold_residual = args.threshold_residual,
+    .threshold_variability = args.threshold_variability,
+    .confirmation_number = args.confirmation_number };
+
+  init_chain(args.path_reflectance, args.n_scenes, args.year, args.modes, args.trend,
+    args.threshold_reference, args.confirmation_reference, &rule, &chain);
+
+  int block_rows = args.block_rows;
+  int n_threads = args.n_cpus;
+  int n_readers = args.n_cpus;
+
+  // plan the block size and concurrency, before any pixel is read
+  if (args.memory > 0){
+
+    footprint_t footprint;
+    plan_t plan;
+
+    chain_footprint(&chain, &info, args.intermediates, &footprint);
+
+    // reflectance bands of the index and quality band of each scene being read
+    int n_read = 1;
+    for (int r=0; r<_BAND_ROLES_; r++){
+      if (args.indices.bands & (1 << r)) n_read++;
+    }
+    footprint.reader_bands = n_read;
+    footprint.tile_bands = n_read;
+
+    if (args.intermediates){
+      footprint.cache_bands += args.n_scenes;
+      footprint.n_outputs += args.n_scenes;
+    }
+
+    if (plan_memory(&footprint, (size_t)args.memory * 1024 * 1024, args.block_rows, args.n_cpus, &plan) != SUCCESS){
+      fprintf(stderr, "Job does not fit into the memory limit of %d MB, at least %.1f MB are needed.\n",
+        args.memory, plan.bytes / 1024.0 / 1024.0);
+      print_plan(&plan);
+      exit(FAILURE);
+    }
+
+    print_plan(&plan);
+    block_rows = plan.block_rows;
+    n_threads = plan.n_threads;
+    n_readers = plan.n_readers;
+    GDALSetCacheMax64(plan.cache);
+
+  }
+
+  // completed blocks of an interrupted run with the same arguments
+  if (args.checkpoint){
+    char dir_checkpoint[STRLEN];
+    concat_string_2(dir_checkpoint, STRLEN, args.dir_output, "checkpoint", "/");
+    open_checkpoint(&checkpoint, dir_checkpoint, fingerprint_args(argc, argv, NULL),
+      info.nx, info.ny, block_rows, written_chain_bands(&chain, false), 2 * chain.n_years);
+    resumed = checkpoint.resumed;
+    if (resumed) printf("Resuming from checkpoint %s, %d of %d blocks are done.\n",
+      dir_checkpoint, checkpoint.n_done, checkpoint.n_blocks);
+  }
+
+  // only the archived products, unless the intermediates are requested
+  create_chain_outputs(&chain, &info, args.dir_output, args.intermediates, resumed);
+
+  if (args.intermediates){
+    alloc((void**)&fp_index, args.n_scenes, sizeof(GDALDatasetH));
+    for (int i=0; i<args.n_scenes; i++){
+      image_t meta = info;
+      meta.nb = 1;
+      meta.nodata = SHRT_MIN;
+      copy_string(meta.path, STRLEN, args.path_index[i]);
+      fp_index[i] = create_image(&meta);
+    }
+  }
+
+  int *n_fit = NULL, *n_detected = NULL, *stats = NULL;
+  alloc((void**)&n_fit, chain.n_years, sizeof(int));
+  alloc((void**)&n_detected, chain.n_years, sizeof(int));
+  alloc((void**)&stats, 2 * chain.n_years, sizeof(int));
+
+  if (args.checkpoint){
+    for (int k=0; k<chain.n_years; k++){
+      n_fit[k] = checkpoint.stats[k];
+      n_detected[k] = checkpoint.stats[chain.n_years + k];
+    }
+  }
+
+  alloc((void**)&input, args.n_scenes, sizeof(image_t));
+
+  int n_blocks = (info.ny + block_rows - 1) / block_rows;
+  int next_scene = 0;
+
+  omp_set_num_threads(n_threads);
+
+  // one thread pool for all blocks and stages, the stages hand over in memory
+  #pragma omp parallel shared(args, chain, qai_rules, info, mask, input, output, fp_index, n_blocks, block_rows, n_readers, next_scene, checkpoint, stats) reduction(+: n_fit[:chain.n_years], n_detected[:chain.n_years]) default(none)
+  {
+
+    gsl_vector *coef = gsl_vector_alloc(chain.n_coef);
+    gsl_matrix *cov = gsl_matrix_alloc(chain.n_coef, chain.n_coef);
+    gsl_set_error_handler_off();
+
+    // counters of one block and thread
+    int *thread_stats = NULL;
+    alloc((void**)&thread_stats, 2 * chain.n_years, sizeof(int));
+
+    for (int block=0; block<n_blocks; block++){
+
+      int row = block * block_rows;
+      int n_rows = (row + block_rows > info.ny) ? info.ny - row : block_rows;
+
+      if (args.checkpoint && checkpoint.done[block]) continue;
+
+      #pragma omp single
+      {
+        read_image_rows(args.path_mask, NULL, row, n_rows, &mask);
+        alloc_chain_outputs(&chain, &mask, &output);
+        next_scene = 0;
+        for (int s=0; s<2*chain.n_years; s++) stats[s] = 0;
+      }
+
+      // index of the whole history, the mask of the first year is applied
+      // at most n_readers scenes are read at the same time
+      #pragma omp for schedule(static,1)
+      for (int r=0; r<n_readers; r++){
+
+        int i;
+
+        while (true){
+
+          #pragma omp atomic capture
+          i = next_scene++;
+
+          if (i >= args.n_scenes) break;
+
+          compute_index_rows(args.path_reflectance[i], args.path_quality[i], row, n_rows,
+            &mask, &qai_rules, &args.indices, &input[i]);
+
+          if (args.intermediates){
+            #pragma omp critical
+            {
+              write_image_rows(fp_index[i], &input[i], row);
+            }
+          }
+
+        }
+
+      }
+
+      for (int s=0; s<2*chain.n_years; s++) thread_stats[s] = 0;
+
+      // every pixel replays all years, no barrier between the years
+      #pragma omp for schedule(static)
+      for (int p=0; p<mask.nc; p++){
+        replay_pixel(&chain, output, &mask, input, p, coef, cov, thread_stats, thread_stats + chain.n_years);
+      }
+
+      for (int k=0; k<chain.n_years; k++){
+        n_fit[k] += thread_stats[k];
+        n_detected[k] += thread_stats[chain.n_years + k];
+      }
+
+      for (int s=0; s<2*chain.n_years; s++){
+        #pragma omp atomic
+        stats[s] += thread_stats[s];
+      }
+
+      #pragma omp barrier
+
+      #pragma omp single
+      {
+        if (args.checkpoint){
+          save_chain_outputs(&chain, &checkpoint, block, output, stats);
+        } else {
+          write_chain_outputs(&chain, output, row);
+        }
+        for (int i=0; i<args.n_scenes; i++) free_image(&input[i]);
+        free_image(&mask);
+      }
+
+    }
+
+    free((void*)thread_stats);
+    gsl_vector_free(coef);
+    gsl_matrix_free(cov);
+    gsl_set_error_handler(NULL);
+
+  } // end omp parallel region
+
+  if (args.checkpoint){
+    restore_chain_outputs(&chain, &checkpoint, &info);
+    close_chain_outputs(&chain);
+    close_checkpoint(&checkpoint, true);
+  } else {
+    close_chain_outputs(&chain);
+  }
+
+  if (args.intermediates){
+    for (int i=0; i<args.n_scenes; i++) GDALClose(fp_index[i]);
+    free((void*)fp_index);
+  }
+
+  for (int k=0; k<chain.n_years; k++){
+    printf("Year %d: fitted new models for %d pixels, detected disturbances for %d pixels.\n",
+      chain.year + k, n_fit[k], n_detected[k]);
+  }
+
+
+  free((void*)input);
+  free((void*)n_fit);
+  free((void*)n_detected);
+  free((void*)stats);
+  free_chain(&chain);
+  free_2D((void**)args.path_reflectance, args.n_scenes);
+  free_2D((void**)args.path_quality, args.n_scenes);
+  free_2D((void**)args.path_index, args.n_scenes);
+
+  GDALDestroy();
+
+  exit(SUCCESS);
+}
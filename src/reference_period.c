@@ -19,6 +19,8 @@
 #include "utils/dir.h"
 #include "utils/harmonic.h"
 #include "utils/image_io.h"
+#include "utils/manifest.h"
+#include "utils/reference.h"
 #include "utils/string.h"
 #include "utils/stats.h"
 #include "args/args_reference_period.h"
@@ -33,10 +35,33 @@ image_t input_reference_period;
 image_t output_reference_period;
 image_t input_coefficients;
 image_t output_coefficients;
+image_t output_variability;
+manifest_t manifest;
 
 
   parse_args(argc, argv, &args);
 
+  init_manifest(&manifest, "reference_period");
+  add_manifest_parameter(&manifest, "year", "%d", args.year);
+  add_manifest_parameter(&manifest, "modes", "%d", args.modes);
+  add_manifest_parameter(&manifest, "trend", "%d", args.trend);
+  add_manifest_parameter(&manifest, "threshold", "%d", args.threshold);
+  add_manifest_parameter(&manifest, "confirmation", "%d", args.confirmation_number);
+  add_manifest_parameter(&manifest, "lookup", "%d", args.lookup);
+  add_manifest_parameter(&manifest, "robust", "%d", args.robust);
+  add_manifest_input(&manifest, args.path_mask);
+  add_manifest_input(&manifest, args.path_input_reference_period);
+  add_manifest_input(&manifest, args.path_input_coefficient);
+  for (int i=0; i<args.n_images; i++) add_manifest_input(&manifest, args.path_input[i]);
+
+  char *outputs[] = { args.path_output_reference_period, args.path_output_coefficient, args.path_output_variability };
+
+  if (outputs_fresh(&manifest, outputs, 3, args.incremental)){
+    printf("Outputs are up to date, skipping.\n");
+    free_manifest(&manifest);
+    exit(SUCCESS);
+  }
+
   GDALAllRegister();
 
   read_image(args.path_mask, NULL, &mask);
@@ -93,6 +118,26 @@ image_t output_coefficients;
   
   copy_image(&input[0], &output_reference_period, 2, SHRT_MIN, args.path_output_reference_period);
   copy_image(&input[0], &output_coefficients, n_coef, SHRT_MIN, args.path_output_coefficient);
+
+  // variability in the last year of the reference period, fused into the pixel loop
+  bool variability = (args.path_output_variability[0] != '\0');
+  enum { start, end };
+  int n_years = 2100;
+  int **range = NULL;
+
+  if (variability){
+    copy_image(&input[0], &output_variability, 2, SHRT_MIN, args.path_output_variability);
+    alloc_2D((void***)&range, n_years, 2, sizeof(int));
+    // images are ordered by date, end is 0 until the first image of the year
+    for (int i=0; i<args.n_images; i++){
+      if (range[dates[i].year][end] == 0) range[dates[i].year][start] = i;
+      range[dates[i].year][end] = i+1;
+    }
+  }
+  
+  reference_rule_t rule = {
+    .year = args.year, .threshold = args.threshold, .confirmation_number = args.confirmation_number,
+    .modes = args.modes, .trend = args.trend };
   
   // pre-compute terms for harmonic fitting
   float **terms;
@@ -104,16 +149,24 @@ image_t output_coefficients;
   
   int n_fit = 0, n_current_anomaly = 0, n_previous_anomaly = 0, n_pixels = 0;
 
-  #pragma omp parallel shared(args, initial, dates, i_break, input, mask, terms, output_reference_period, output_coefficients, input_reference_period, input_coefficients, n_coef) reduction(+: n_fit, n_current_anomaly, n_previous_anomaly, n_pixels) default(none)
+  #pragma omp parallel shared(args, rule, initial, dates, i_break, input, mask, terms, output_reference_period, output_coefficients, input_reference_period, input_coefficients, n_coef, variability, range, output_variability) reduction(+: n_fit, n_current_anomaly, n_previous_anomaly, n_pixels) default(none)
   {
     
     gsl_vector *coef = gsl_vector_alloc(n_coef);
     gsl_matrix *cov = gsl_matrix_alloc(n_coef, n_coef);
-    gsl_vector *x_pred = gsl_vector_alloc(n_coef);
     gsl_set_error_handler_off();
 
+    // per-thread baseline table of the current year's images, blocks are aligned with the schedule's chunks
+    baseline_t baseline;
+    bool lookup = args.lookup && !initial;
+    if (lookup) init_baseline(dates + i_break, args.n_images - i_break, args.trend, &baseline);
 
-  #pragma omp for
+    // per-thread scratch buffer for the robust variability, no allocation per pixel
+    double *buffer = NULL;
+    if (variability) alloc((void**)&buffer, args.n_images, sizeof(double));
+
+
+  #pragma omp for schedule(static, _BASELINE_BLOCK_)
   for (int p=0; p<output_reference_period.nc; p++){
 //if (p != 1837*output_reference_period.ny + 1385) continue;
     
@@ -124,127 +177,35 @@ image_t output_coefficients;
     // initialize images
     for (int b=0; b<output_coefficients.nb; b++) output_coefficients.data[b][p] = output_coefficients.nodata;
     for (int b=0; b<output_reference_period.nb; b++) output_reference_period.data[b][p] = output_reference_period.nodata;
+    if (variability){
+      for (int b=0; b<output_variability.nb; b++) output_variability.data[b][p] = output_variability.nodata;
+    }
 
     // check mask
     if (mask.data[0][p] == mask.nodata || mask.data[0][p] == 0) continue;
 
     n_pixels++;
 
-    // we already ended the reference period in a previous iteration -> no need to fit again
-    // if we are working in 2018, and the reference period already ended in 2016 or earlier, just copy previous results
-    if (!initial && input_reference_period.data[0][p] < (args.year - 1)){
-      // safety check (should not happen)
-      if (input_reference_period.data[0][p] < 1900){
-        printf("Warning: pixel %d has invalid reference period year - should not happen - %d.\n", p, input_reference_period.data[0][p]);
-        continue;
-      } 
-      //printf("Pixel %d: reference period already ended in year %d, copy previous results.\n", p, input_reference_period.data[0][p]);
-      for (int b=0; b<output_coefficients.nb; b++) output_coefficients.data[b][p] = input_coefficients.data[b][p];
-      for (int b=0; b<output_reference_period.nb; b++) output_reference_period.data[b][p] = input_reference_period.data[b][p];
-      n_previous_anomaly++;
-      continue;
-    }
-
+    int status = extend_reference_period(&rule, input, terms, args.n_images, i_break, initial, 
+      &input_reference_period, &input_coefficients, lookup ? &baseline : NULL, p, coef, cov, 
+      &output_reference_period, &output_coefficients);
 
-    bool stable = true;
+    // safety check failed, pixel is left empty
+    if (status == _REFERENCE_INVALID_) continue;
 
-    // check for anomalies in the period after the previous reference period until the current year
-    if (!initial){
-
-      for (int i=i_break, anomaly_counter=0; i<args.n_images; i++){
-
-        if (input[i].data[0][p] == input[i].nodata) continue;
-
-        float y_pred = predict_harmonic_value(terms[i], &input_coefficients, p, n_coef, args.modes, args.trend);
-        float residual = input[i].data[0][p] - y_pred;
-
-        //printf("  Predicting date %d-%d-%d (index %d): observed = %d, predicted = %.2f, residual = %.2f\n",
-        //  dates[i].year, dates[i].month, dates[i].day, i, input[i].data[0][p], y_pred, residual);
-
-        if (args.threshold > 0 && residual > args.threshold){
-          anomaly_counter++;
-        } else if (args.threshold < 0 && residual < args.threshold){
-          anomaly_counter++;
-        } else {
-          anomaly_counter = 0;
-        }
-
-        //printf("    anomaly counter = %d\n", anomaly_counter);
-
-        // detected anomaly, stop extending reference period
-        if (anomaly_counter >= args.confirmation_number){
-          //printf("    -> detected anomaly. Stop the fitting period extension.\n");
-          stable = false;
-          for (int b=0; b<output_coefficients.nb; b++) output_coefficients.data[b][p] = input_coefficients.data[b][p];
-          for (int b=0; b<output_reference_period.nb; b++) output_reference_period.data[b][p] = input_reference_period.data[b][p];
-          n_current_anomaly++;
-          break;
-        }
-
-      }
-
-    }
+    if (status == _REFERENCE_PREVIOUS_) n_previous_anomaly++;
+    if (status == _REFERENCE_ANOMALY_)  n_current_anomaly++;
+    if (status == _REFERENCE_FITTED_)   n_fit++;
 
-    // if still stable or initial run, extend fitting period to the whole time frame
-    if (stable || initial){
-
-      int n_valid = 0;
-      for (int i=0; i<args.n_images; i++){
-        if (input[i].data[0][p] != input[i].nodata) n_valid++;
-      }
-
-      // not enough valid observations to fit the harmonic model
-      if (n_valid > n_coef){
-
-        // printf("  Fit a new model until year %d (index %d) with %d valid observations.\n", 
-        //  periods[fit_period][0], periods[fit_period][1], n_valid);
-
-        gsl_matrix *x = gsl_matrix_alloc(n_valid, n_coef);
-        gsl_vector *y = gsl_vector_alloc(n_valid);
-
-        for (int i=0, k=0; i<args.n_images; i++){
-
-          if (input[i].data[0][p] == input[i].nodata) continue;
-
-          // explanatory variables
-          for (int coef=0; coef<n_coef; coef++){
-            gsl_matrix_set(x, k, coef, terms[i][coef]);
-          }
-
-          // response variable
-          gsl_vector_set(y, k, input[i].data[0][p]);
-          k++;
-
-        }
-
-        // Iteratively Reweighted Least Squares (IRLS)
-        double sd = irls_fit(x, y, coef, cov);
-
-        // update coefficients image
-        for (int b=0; b<n_coef; b++){
-          //printf("Pixel %d, Coefficient %d: %.2f\n", p, b, gsl_vector_get(coef, b));
-          output_coefficients.data[b][p] = (short)(gsl_vector_get(coef, b) * _COEF_SCALE_);
-        }
-
-        output_reference_period.data[0][p] = args.year; // extended until current year
-        output_reference_period.data[1][p] = (short)sd; // extended until current year
-
-        gsl_matrix_free(x);
-        gsl_vector_free(y);
-
-        n_fit++;
-
-      }
-
-
-    }
+    if (variability) reference_variability(input, range, output_reference_period.data[0][p], p, args.robust, buffer, &output_variability);
 
   }
 
   gsl_vector_free(coef);
   gsl_matrix_free(cov);
-  gsl_vector_free(x_pred);
   gsl_set_error_handler(NULL);
+  if (lookup) free_baseline(&baseline);
+  if (variability) free((void*)buffer);
   
   } // end omp parallel region
 
@@ -254,6 +215,8 @@ image_t output_coefficients;
 
   write_image(&output_reference_period);
   write_image(&output_coefficients);
+  if (variability) write_image(&output_variability);
+  write_manifests(&manifest, outputs, 3, args.incremental);
 
 
   free_2D((void**)terms, args.n_images);
@@ -266,8 +229,13 @@ image_t output_coefficients;
   free_image(&output_reference_period);
   free_image(&input_coefficients);
   free_image(&output_coefficients);
+  if (variability){
+    free_image(&output_variability);
+    free_2D((void**)range, n_years);
+  }
   free((void*)dates);
   free_2D((void**)args.path_input, args.n_images);
+  free_manifest(&manifest);
   
   GDALDestroy();
 
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/** Geospatial Data Abstraction Library (GDAL) **/
+#include "gdal.h"       // public (C callable) GDAL entry points
+#include "cpl_conv.h"   // various convenience functions for CPL
+#include "cpl_string.h" // various convenience functions for strings
+
+/** GNU Scientific Library (GSL) **/
+#include <gsl/gsl_multifit.h> // Linear Least Squares Fitting
+
+/** OpenMP **/
+#include <omp.h> // multi-platform shared memory multiprocessing
+
+#include "utils/alloc.h"
+#include "utils/chain.h"
+#include "utils/checkpoint.h"
+#include "utils/const.h"
+#include "utils/detection.h"
+#include "utils/image_io.h"
+#include "utils/plan.h"
+#include "utils/string.h"
+#include "args/args_replay.h"
+
+
+int main ( int argc, char *argv[] ){
+args_t args;
+chain_t chain;
+image_t info;
+image_t mask;
+image_t *input = NULL;
+image_t **output = NULL;
+checkpoint_t checkpoint;
+bool resumed = false;
+
+
+  parse_args(argc, argv, &args);
+
+  GDALAllRegister();
+
+  // check the images, but do not read them yet
+  read_image_info(args.path_mask, &info);
+
+  for (int i=0; i<args.n_images; i++){
+    image_t input_info;
+    read_image_info(args.path_input[i], &input_info);
+    compare_images(&info, &input_info);
+  }
+
+  detection_rule_t rule = {
+    .threshold_residual = args.threshold_residual,
+    .threshold_variability = args.threshold_variability,
+    .confirmation_number = args.confirmation_number };
+
+  init_chain(args.path_input, args.n_images, args.year, args.modes, args.trend, 
+    args.threshold_reference, args.confirmation_reference, &rule, &chain);
+
+  int block_rows = args.block_rows;
+  int n_threads = args.n_cpus;
+  int n_readers = args.n_cpus;
+
+  // plan the block size and concurrency, before any pixel is read
+  if (args.memory > 0){
+
+    footprint_t footprint;
+    plan_t plan;
+
+    chain_footprint(&chain, &info, true, &footprint);
+    footprint.tile_bands = 1;
+
+    if (plan_memory(&footprint, (size_t)args.memory * 1024 * 1024, args.block_rows, args.n_cpus, &plan) != SUCCESS){
+      fprintf(stderr, "Job does not fit into the memory limit of %d MB, at least %.1f MB are needed.\n",
+        args.memory, plan.bytes / 1024.0 / 1024.0);
+      print_plan(&plan);
+      exit(FAILURE);
+    }
+
+    print_plan(&plan);
+    block_rows = plan.block_rows;
+    n_threads = plan.n_threads;
+    n_readers = plan.n_readers;
+    GDALSetCacheMax64(plan.cache);
+
+  }
+
+  // completed blocks of an interrupted run with the same arguments
+  if (args.checkpoint){
+    char dir_checkpoint[STRLEN];
+    concat_string_2(dir_checkpoint, STRLEN, args.dir_output, "checkpoint", "/");
+    open_checkpoint(&checkpoint, dir_checkpoint, fingerprint_args(argc, argv, NULL),
+      info.nx, info.ny, block_rows, written_chain_bands(&chain, true), 2 * chain.n_years);
+    resumed = checkpoint.resumed;
+    if (resumed) printf("Resuming from checkpoint %s, %d of %d blocks are done.\n",
+      dir_checkpoint, checkpoint.n_done, checkpoint.n_blocks);
+  }
+
+  // all yearly outputs are written
+  create_chain_outputs(&chain, &info, args.dir_output, true, resumed);
+
+  int *n_fit = NULL, *n_detected = NULL, *stats = NULL;
+  alloc((void**)&n_fit, chain.n_years, sizeof(int));
+  alloc((void**)&n_detected, chain.n_years, sizeof(int));
+  alloc((void**)&stats, 2 * chain.n_years, sizeof(int));
+
+  if (args.checkpoint){
+    for (int k=0; k<chain.n_years; k++){
+      n_fit[k] = checkpoint.stats[k];
+      n_detected[k] = checkpoint.stats[chain.n_years + k];
+    }
+  }
+
+  alloc((void**)&input, args.n_images, sizeof(image_t));
+
+  int n_blocks = (info.ny + block_rows - 1) / block_rows;
+
+  omp_set_num_threads(n_threads);
+
+  for (int block=0; block<n_blocks; block++){
+
+    int row = block * block_rows;
+    int n_rows = (row + block_rows > info.ny) ? info.ny - row : block_rows;
+
+    if (args.checkpoint && checkpoint.done[block]) continue;
+
+    // the whole history of the block is read once
+    read_image_rows(args.path_mask, NULL, row, n_rows, &mask);
+
+    #pragma omp parallel for num_threads(n_readers) shared(args, row, n_rows, input) schedule(dynamic) default(none)
+    for (int i=0; i<args.n_images; i++){
+      read_image_rows(args.path_input[i], NULL, row, n_rows, &input[i]);
+    }
+
+    alloc_chain_outputs(&chain, &mask, &output);
+
+    for (int k=0; k<chain.n_years; k++){
+      stats[k] = -n_fit[k];
+      stats[chain.n_years + k] = -n_detected[k];
+    }
+
+    #pragma omp parallel shared(chain, output, mask, input) reduction(+: n_fit[:chain.n_years], n_detected[:chain.n_years]) default(none)
+    {
+
+      gsl_vector *coef = gsl_vector_alloc(chain.n_coef);
+      gsl_matrix *cov = gsl_matrix_alloc(chain.n_coef, chain.n_coef);
+      gsl_set_error_handler_off();
+
+      // every pixel replays all years, no barrier between the years
+      #pragma omp for schedule(static)
+      for (int p=0; p<mask.nc; p++){
+        replay_pixel(&chain, output, &mask, input, p, coef, cov, n_fit, n_detected);
+      }
+
+      gsl_vector_free(coef);
+      gsl_matrix_free(cov);
+      gsl_set_error_handler(NULL);
+
+    } // end omp parallel region
+
+    for (int k=0; k<chain.n_years; k++){
+      stats[k] += n_fit[k];
+      stats[chain.n_years + k] += n_detected[k];
+    }
+
+    if (args.checkpoint){
+      save_chain_outputs(&chain, &checkpoint, block, output, stats);
+    } else {
+      write_chain_outputs(&chain, output, row);
+    }
+
+    for (int i=0; i<args.n_images; i++) free_image(&input[i]);
+    free_image(&mask);
+
+  }
+
+  if (args.checkpoint){
+    restore_chain_outputs(&chain, &checkpoint, &info);
+    close_chain_outputs(&chain);
+    close_checkpoint(&checkpoint, true);
+  } else {
+    close_chain_outputs(&chain);
+  }
+
+  for (int k=0; k<chain.n_years; k++){
+    printf("Year %d: fitted new models for %d pixels, detected disturbances for %d pixels.\n",
+      chain.year + k, n_fit[k], n_detected[k]);
+  }
+
+
+  free((void*)input);
+  free((void*)n_fit);
+  free((void*)n_detected);
+  free((void*)stats);
+  free_chain(&chain);
+  free_2D((void**)args.path_input, args.n_images);
+
+  GDALDestroy();
+
+  exit(SUCCESS);
+}
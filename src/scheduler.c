@@ -0,0 +1,525 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/** Geospatial Data Abstraction Library (GDAL) **/
+#include "gdal.h"       // public (C callable) GDAL entry points
+#include "cpl_conv.h"   // various convenience functions for CPL
+#include "cpl_string.h" // various convenience functions for strings
+
+/** GNU Scientific Library (GSL) **/
+#include <gsl/gsl_multifit.h> // Linear Least Squares Fitting
+
+/** OpenMP **/
+#include <omp.h> // multi-platform shared memory multiprocessing
+
+#include "utils/alloc.h"
+#include "utils/chain.h"
+#include "utils/checkpoint.h"
+#include "utils/const.h"
+#include "utils/date.h"
+#include "utils/detection.h"
+#include "utils/dir.h"
+#include "utils/image_io.h"
+#include "utils/indices.h"
+#include "utils/plan.h"
+#include "utils/quality.h"
+#include "utils/spectral.h"
+#include "utils/string.h"
+#include "args/args_scheduler.h"
+
+
+typedef struct {
+  char name[STRLEN];       // tile name, e.g. X0055_Y0053
+  char path_mask[STRLEN];  // initial mask
+  char dir_output[STRLEN]; // output directory of the tile
+  int n_scenes;            // number of scenes
+  char **path_reflectance; // BOA images, ordered by date
+  char **path_quality;     // QAI images
+  image_t info;            // dimensions and georeference
+  chain_t chain;           // yearly processing chain
+  footprint_t footprint;   // memory use of one task
+  plan_t plan;             // block size and concurrency, if the tile runs alone
+  int block_rows;          // rows per block
+  int n_blocks;            // number of blocks, i.e. tasks
+  int remaining;           // number of unfinished blocks
+  size_t bytes;            // estimated memory while the tile is running
+  int *n_fit;              // number of fitted pixels, per year
+  int *n_detected;         // number of disturbed pixels, per year
+  unsigned long long fingerprint; // fingerprint of the arguments and tile
+  checkpoint_t checkpoint; // completed blocks, if checkpoints are enabled
+} tile_t;
+
+typedef struct {
+  args_t *args;            // arguments
+  qai_rules_t qai_rules;   // compiled QAI screening rules
+  detection_rule_t rule;   // detection rule
+  int n_threads;           // number of threads
+  int n_tiles;             // number of tiles
+  tile_t *tile;            // tiles
+  int next;                // next tile to start
+  int running;             // number of running tiles
+  size_t used;             // estimated memory of the running tiles
+  size_t budget;           // memory budget
+} scheduler_t;
+
+
+void find_tile(scheduler_t *scheduler, char *name, tile_t *tile);
+bool tile_finished(tile_t *tile);
+void free_tile(tile_t *tile);
+void admit_tiles(scheduler_t *scheduler);
+void run_block(scheduler_t *scheduler, tile_t *tile, int block);
+void finish_tile(scheduler_t *scheduler, tile_t *tile);
+
+
+int main ( int argc, char *argv[] ){
+args_t args;
+scheduler_t scheduler;
+
+
+  parse_args(argc, argv, &args);
+
+  scheduler.args = &args;
+  scheduler.n_tiles = 0;
+  scheduler.next = 0;
+  scheduler.running = 0;
+  scheduler.used = 0;
+  scheduler.budget = (size_t)args.memory * 1024 * 1024;
+
+  scheduler.rule.threshold_residual = args.threshold_residual;
+  scheduler.rule.threshold_variability = args.threshold_variability;
+  scheduler.rule.confirmation_number = args.confirmation_number;
+
+  if (compile_qai_rules(args.qai_rules, &scheduler.qai_rules) != SUCCESS){
+    fprintf(stderr, "Could not compile QAI screening rules.\n");
+    exit(FAILURE);
+  }
+
+  GDALAllRegister();
+
+  // check and plan all tiles before any pixel is read, only headers are read
+  alloc((void**)&scheduler.tile, args.n_tiles, sizeof(tile_t));
+  scheduler.n_threads = args.n_cpus;
+
+  for (int t=0; t<args.n_tiles; t++){
+
+    tile_t *tile = &scheduler.tile[scheduler.n_tiles];
+
+    find_tile(&scheduler, args.tiles[t], tile);
+    tile->fingerprint = fingerprint_args(argc, argv, tile->name);
+
+    // tiles of an interrupted run that were already written
+    if (args.checkpoint && tile_finished(tile)){
+      printf("Tile %s is already finished, skipping.\n", tile->name);
+      free_tile(tile);
+      continue;
+    }
+
+    if (tile->plan.n_threads < scheduler.n_threads) scheduler.n_threads = tile->plan.n_threads;
+    scheduler.n_tiles++;
+
+  }
+
+  // the threads are shared by all tiles, the smallest plan decides
+  size_t cache = 0;
+
+  for (int t=0; t<scheduler.n_tiles; t++){
+
+    tile_t *tile = &scheduler.tile[t];
+    size_t tile_cache;
+    int n_tasks = (tile->n_blocks < scheduler.n_threads) ? tile->n_blocks : scheduler.n_threads;
+
+    tile->bytes = estimate_memory(&tile->footprint, tile->block_rows, n_tasks, n_tasks, &tile_cache);
+    if (tile_cache > cache) cache = tile_cache;
+
+    printf("Tile %s: %d scenes, %d tasks of %d rows, estimated memory %.1f MB.\n", tile->name,
+      tile->n_scenes, tile->n_blocks, tile->block_rows, tile->bytes / 1024.0 / 1024.0);
+
+  }
+
+  printf("Using %d threads, %.1f MB block cache.\n", scheduler.n_threads, cache / 1024.0 / 1024.0);
+  GDALSetCacheMax64(cache);
+
+  gsl_set_error_handler_off();
+
+  omp_set_num_threads(scheduler.n_threads);
+
+  // block tasks of all running tiles share one thread pool, finished
+  // tiles start new tiles, all tasks are done at the end of the region
+  #pragma omp parallel shared(scheduler) default(none)
+  {
+    #pragma omp single
+    admit_tiles(&scheduler);
+  }
+
+  gsl_set_error_handler(NULL);
+
+  free((void*)scheduler.tile);
+  free_2D((void**)args.tiles, args.n_tiles);
+
+  GDALDestroy();
+
+  exit(SUCCESS);
+}
+
+
+/** Find and plan the inputs of a tile
++++ This function lists the BOA images of a tile up to the last year, and
++++ checks that the images and the mask match. Each task holds one block
++++ of the index of all scenes and of the yearly outputs, and reads one
++++ scene at a time. The block size is planned as if the tile ran alone
++++ within the budget, the job fails if the tile does not fit.
+--- scheduler: scheduler
+--- name:      tile name
+--- tile:      tile (returned)
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void find_tile(scheduler_t *scheduler, char *name, tile_t *tile){
+args_t *args = scheduler->args;
+char dir_tile[STRLEN];
+char fname[STRLEN];
+char dirname[STRLEN];
+char ext[STRLEN];
+dir_t dir;
+
+
+  copy_string(tile->name, STRLEN, name);
+  concat_string_3(tile->path_mask, STRLEN, args->dir_mask, name, args->mask, "/");
+  concat_string_2(tile->dir_output, STRLEN, args->dir_output, name, "/");
+  concat_string_2(dir_tile, STRLEN, args->dir_cube, name, "/");
+
+  if (!fileexist(tile->path_mask)){
+    fprintf(stderr, "Mask file %s does not exist.\n", tile->path_mask);
+    exit(FAILURE);
+  }
+
+  if (read_dir(&dir, dir_tile, "BOA", NULL) != SUCCESS){
+    fprintf(stderr, "Could not list tile directory %s.\n", dir_tile);
+    exit(FAILURE);
+  }
+
+  if (dir.n < 1){
+    fprintf(stderr, "No BOA images found for tile %s.\n", name);
+    exit(FAILURE);
+  }
+
+  alloc_2D((void***)&tile->path_reflectance, dir.n, STRLEN, sizeof(char));
+  alloc_2D((void***)&tile->path_quality, dir.n, STRLEN, sizeof(char));
+  tile->n_scenes = 0;
+
+  for (int i=0; i<dir.n; i++){
+
+    date_t date;
+
+    extension2(dir.paths[i], ext, STRLEN);
+    if (strcmp(ext, ".tif") != 0) continue;
+    if (args->pattern[0] != '\0' && strstr(dir.files[i], args->pattern) == NULL) continue;
+    if (date_from_string(&date, dir.files[i]) != SUCCESS) continue;
+    if (date.year > args->last_year) continue;
+
+    char *path_reflectance = tile->path_reflectance[tile->n_scenes];
+    char *path_quality = tile->path_quality[tile->n_scenes];
+
+    copy_string(path_reflectance, STRLEN, dir.paths[i]);
+
+    // quality image: replace BOA with QAI in the file name
+    directoryname(path_reflectance, dirname, STRLEN);
+    copy_string(fname, STRLEN, dir.files[i]);
+    replace_string(fname, "BOA", "QAI", STRLEN);
+    concat_string_2(path_quality, STRLEN, dirname, fname, "/");
+
+    if (!fileexist(path_quality)){
+      fprintf(stderr, "Quality file %s does not exist.\n", path_quality);
+      exit(FAILURE);
+    }
+
+    tile->n_scenes++;
+
+  }
+
+  free_dir(&dir);
+
+  if (tile->n_scenes < 1){
+    fprintf(stderr, "No BOA images found for tile %s.\n", name);
+    exit(FAILURE);
+  }
+
+  read_image_info(tile->path_mask, &tile->info);
+
+  for (int i=0; i<tile->n_scenes; i++){
+    image_t scene_info;
+    read_image_info(tile->path_reflectance[i], &scene_info);
+    compare_images(&tile->info, &scene_info);
+    read_image_info(tile->path_quality[i], &scene_info);
+    compare_images(&tile->info, &scene_info);
+  }
+
+  init_chain(tile->path_reflectance, tile->n_scenes, args->year, args->modes, args->trend,
+    args->threshold_reference, args->confirmation_reference, &scheduler->rule, &tile->chain);
+
+  chain_footprint(&tile->chain, &tile->info, false, &tile->footprint);
+
+  // reflectance bands of the index and quality band of the scene being read
+  int n_read = 1;
+  for (int r=0; r<_BAND_ROLES_; r++){
+    if (args->indices.bands & (1 << r)) n_read++;
+  }
+
+  tile->footprint.thread_bands = tile->footprint.block_bands + n_read;
+  tile->footprint.block_bands = 0;
+  tile->footprint.tile_bands = n_read;
+  tile->footprint.own_reader = true;
+
+  if (plan_memory(&tile->footprint, scheduler->budget, args->block_rows, args->n_cpus, &tile->plan) != SUCCESS){
+    fprintf(stderr, "Tile %s does not fit into the memory budget of %d MB, at least %.1f MB are needed.\n",
+      name, args->memory, tile->plan.bytes / 1024.0 / 1024.0);
+    print_plan(&tile->plan);
+    exit(FAILURE);
+  }
+
+  tile->block_rows = tile->plan.block_rows;
+  tile->n_blocks = (tile->info.ny + tile->block_rows - 1) / tile->block_rows;
+  tile->remaining = tile->n_blocks;
+
+  return;
+}
+
+
+/** Is a tile finished?
++++ A tile is finished if the combined disturbances of the last year were
++++ written, and no checkpoint is left, i.e. the outputs were closed.
+--- tile:   tile
++++ Return: true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool tile_finished(tile_t *tile){
+char path[STRLEN];
+int nchar;
+
+
+  nchar = snprintf(path, STRLEN, "%s/checkpoint", tile->dir_output);
+  if (nchar < 0 || nchar >= STRLEN){
+    fprintf(stderr, "Buffer Overflow in assembling filename\n");
+    exit(FAILURE);
+  }
+
+  if (fileexist(path)) return false;
+
+  nchar = snprintf(path, STRLEN, "%s/disturbances_%04d.tif", tile->dir_output,
+    tile->chain.year + tile->chain.n_years - 1);
+  if (nchar < 0 || nchar >= STRLEN){
+    fprintf(stderr, "Buffer Overflow in assembling filename\n");
+    exit(FAILURE);
+  }
+
+  return fileexist(path);
+}
+
+
+/** Free the inputs of a tile
+--- tile:   tile
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_tile(tile_t *tile){
+
+  free_chain(&tile->chain);
+  free_2D((void**)tile->path_reflectance, tile->n_scenes);
+  free_2D((void**)tile->path_quality, tile->n_scenes);
+
+  return;
+}
+
+
+/** Start tiles
++++ This function starts the next tiles while their estimated memory fits
++++ into the budget, and creates one task per block. At least one tile is
++++ always running. The tasks are spread over the threads by the OpenMP
++++ task scheduler, idle threads pick up the tasks of any tile.
+--- scheduler: scheduler (modified)
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void admit_tiles(scheduler_t *scheduler){
+args_t *args = scheduler->args;
+int first, last;
+
+
+  #pragma omp critical(admission)
+  {
+    first = scheduler->next;
+    while (scheduler->next < scheduler->n_tiles &&
+          (scheduler->running == 0 ||
+           scheduler->used + scheduler->tile[scheduler->next].bytes <= scheduler->budget)){
+      scheduler->used += scheduler->tile[scheduler->next].bytes;
+      scheduler->running++;
+      scheduler->next++;
+    }
+    last = scheduler->next;
+  }
+
+  // tasks are created outside of the critical section, they may run right away
+  for (int t=first; t<last; t++){
+
+    tile_t *tile = &scheduler->tile[t];
+
+    printf("Starting tile %s.\n", tile->name);
+
+    bool resumed = false;
+
+    alloc((void**)&tile->n_fit, tile->chain.n_years, sizeof(int));
+    alloc((void**)&tile->n_detected, tile->chain.n_years, sizeof(int));
+
+    #pragma omp critical
+    {
+      createdir(tile->dir_output);
+
+      // completed blocks of an interrupted run with the same arguments
+      if (args->checkpoint){
+        char dir_checkpoint[STRLEN];
+        concat_string_2(dir_checkpoint, STRLEN, tile->dir_output, "checkpoint", "/");
+        open_checkpoint(&tile->checkpoint, dir_checkpoint, tile->fingerprint,
+          tile->info.nx, tile->info.ny, tile->block_rows, written_chain_bands(&tile->chain, false), 2 * tile->chain.n_years);
+        resumed = tile->checkpoint.resumed;
+        if (resumed) printf("Resuming tile %s from checkpoint, %d of %d blocks are done.\n",
+          tile->name, tile->checkpoint.n_done, tile->checkpoint.n_blocks);
+        for (int k=0; k<tile->chain.n_years; k++){
+          tile->n_fit[k] = tile->checkpoint.stats[k];
+          tile->n_detected[k] = tile->checkpoint.stats[tile->chain.n_years + k];
+        }
+        tile->remaining -= tile->checkpoint.n_done;
+      }
+
+      create_chain_outputs(&tile->chain, &tile->info, tile->dir_output, false, resumed);
+    }
+
+    if (tile->remaining == 0){
+      finish_tile(scheduler, tile);
+      continue;
+    }
+
+    for (int block=0; block<tile->n_blocks; block++){
+      if (args->checkpoint && tile->checkpoint.done[block]) continue;
+      #pragma omp task firstprivate(tile, block) shared(scheduler) default(none)
+      run_block(scheduler, tile, block);
+    }
+
+  }
+
+  return;
+}
+
+
+/** Run one block of a tile
++++ This function computes the index of all scenes for one block of rows,
++++ replays the yearly chain of all pixels, and writes the outputs. The
++++ task that finishes the last block of a tile finishes the tile.
+--- scheduler: scheduler
+--- tile:      tile
+--- block:     block
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void run_block(scheduler_t *scheduler, tile_t *tile, int block){
+args_t *args = scheduler->args;
+chain_t *chain = &tile->chain;
+image_t mask;
+image_t *input = NULL;
+image_t **output = NULL;
+int *stats = NULL;
+int remaining;
+
+
+  int row = block * tile->block_rows;
+  int n_rows = (row + tile->block_rows > tile->info.ny) ? tile->info.ny - row : tile->block_rows;
+
+  read_image_rows(tile->path_mask, NULL, row, n_rows, &mask);
+  alloc_chain_outputs(chain, &mask, &output);
+
+  // index of the whole history, the mask of the first year is applied
+  alloc((void**)&input, tile->n_scenes, sizeof(image_t));
+  for (int i=0; i<tile->n_scenes; i++){
+    compute_index_rows(tile->path_reflectance[i], tile->path_quality[i], row, n_rows,
+      &mask, &scheduler->qai_rules, &args->indices, &input[i]);
+  }
+
+  // counters of the block, fitted and disturbed pixels per year
+  alloc((void**)&stats, 2 * chain->n_years, sizeof(int));
+  int *n_fit = stats, *n_detected = stats + chain->n_years;
+
+  gsl_vector *coef = gsl_vector_alloc(chain->n_coef);
+  gsl_matrix *cov = gsl_matrix_alloc(chain->n_coef, chain->n_coef);
+
+  for (int p=0; p<mask.nc; p++){
+    replay_pixel(chain, output, &mask, input, p, coef, cov, n_fit, n_detected);
+  }
+
+  gsl_vector_free(coef);
+  gsl_matrix_free(cov);
+
+  if (args->checkpoint){
+    save_chain_outputs(chain, &tile->checkpoint, block, output, stats);
+  } else {
+    #pragma omp critical
+    {
+      write_chain_outputs(chain, output, row);
+    }
+  }
+
+  for (int k=0; k<chain->n_years; k++){
+    #pragma omp atomic
+    tile->n_fit[k] += n_fit[k];
+    #pragma omp atomic
+    tile->n_detected[k] += n_detected[k];
+  }
+
+  for (int i=0; i<tile->n_scenes; i++) free_image(&input[i]);
+  free((void*)input);
+  free_image(&mask);
+  free((void*)stats);
+
+  #pragma omp atomic capture
+  remaining = --tile->remaining;
+
+  if (remaining == 0) finish_tile(scheduler, tile);
+
+  return;
+}
+
+
+/** Finish a tile
++++ This function closes the outputs of a tile, releases its memory from
++++ the budget, and starts the next tiles.
+--- scheduler: scheduler (modified)
+--- tile:      tile
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void finish_tile(scheduler_t *scheduler, tile_t *tile){
+
+
+  #pragma omp critical
+  {
+    if (scheduler->args->checkpoint){
+      restore_chain_outputs(&tile->chain, &tile->checkpoint, &tile->info);
+      close_chain_outputs(&tile->chain);
+      close_checkpoint(&tile->checkpoint, true);
+    } else {
+      close_chain_outputs(&tile->chain);
+    }
+    for (int k=0; k<tile->chain.n_years; k++){
+      printf("Tile %s, year %d: fitted new models for %d pixels, detected disturbances for %d pixels.\n",
+        tile->name, tile->chain.year + k, tile->n_fit[k], tile->n_detected[k]);
+    }
+  }
+
+  free((void*)tile->n_fit);
+  free((void*)tile->n_detected);
+  free_tile(tile);
+
+  #pragma omp critical(admission)
+  {
+    scheduler->used -= tile->bytes;
+    scheduler->running--;
+  }
+
+  admit_tiles(scheduler);
+
+  return;
+}
+
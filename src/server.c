@@ -0,0 +1,634 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/** Geospatial Data Abstraction Library (GDAL) **/
+#include "gdal.h"       // public (C callable) GDAL entry points
+#include "cpl_conv.h"   // various convenience functions for CPL
+#include "cpl_string.h" // various convenience functions for strings
+
+#include "utils/alloc.h"
+#include "utils/const.h"
+#include "utils/image_io.h"
+#include "utils/request.h"
+#include "utils/string.h"
+#include "args/args_server.h"
+
+
+// entry points of the stages, i.e. their main functions, see Makefile
+int spectral_index_main(int argc, char *argv[]);
+int reference_period_main(int argc, char *argv[]);
+int disturbance_detection_main(int argc, char *argv[]);
+int temporal_variability_main(int argc, char *argv[]);
+int update_mask_main(int argc, char *argv[]);
+int combine_disturbances_main(int argc, char *argv[]);
+
+typedef struct {
+  const char *name;
+  int (*main)(int argc, char *argv[]);
+} stage_t;
+
+static const stage_t STAGES[] = {
+  { "spectral_index",        spectral_index_main },
+  { "reference_period",      reference_period_main },
+  { "disturbance_detection", disturbance_detection_main },
+  { "temporal_variability",  temporal_variability_main },
+  { "update_mask",           update_mask_main },
+  { "combine_disturbances",  combine_disturbances_main }
+};
+
+// number of paths remembered for the admission to the cache
+#define _SEEN_MAX_ 1024
+
+// a running job
+typedef struct {
+  int id;                  // job number
+  pid_t pid;               // process running the stage
+  int fd_client;           // connection to the client
+  int fd_access;           // image accesses reported by the job, see report_image_access
+  char *accesses;          // reported accesses
+  size_t n_access;         // length of the reported accesses
+  size_t size_access;      // allocated length
+  char stage[STRLEN];      // stage name
+  struct timespec start;   // start time
+  bool hangup;             // did the client go away?
+} task_t;
+
+// an image that is read into the cache by a forked process
+typedef struct {
+  pid_t pid;               // process reading the image
+  image_load_t load;       // image received so far
+} loader_t;
+
+typedef struct {
+  args_t *args;            // arguments
+  int fd_listen;           // listening socket
+  int n_jobs;              // number of jobs started
+  int n_running;           // number of running jobs
+  task_t *running;         // running jobs
+  int n_loads;             // number of images being read into the cache
+  loader_t *loads;         // images being read into the cache, at most one per job slot
+  int n_seen;              // number of remembered paths
+  char **seen;             // paths read by one finished job, ring buffer
+} server_t;
+
+
+static volatile sig_atomic_t stop = 0;
+
+
+void handle_signal(int signum);
+void start_job(server_t *server, int fd_client);
+void run_stage(server_t *server, request_t *request, int fd_access);
+void read_accesses(task_t *job);
+void reap_job(server_t *server, int j);
+void update_cache(server_t *server, task_t *job);
+void start_load(server_t *server, char *path);
+void finish_load(server_t *server, int l);
+void close_server_fds(server_t *server);
+
+
+int main ( int argc, char *argv[] ){
+args_t args;
+server_t server;
+struct pollfd *fds = NULL;
+struct sigaction action;
+
+
+  parse_args(argc, argv, &args);
+
+  server.args = &args;
+  server.n_jobs = 0;
+  server.n_running = 0;
+  server.n_loads = 0;
+  server.n_seen = 0;
+  alloc((void**)&server.running, args.n_jobs, sizeof(task_t));
+  alloc((void**)&server.loads, args.n_jobs, sizeof(loader_t));
+  alloc_2D((void***)&server.seen, _SEEN_MAX_, STRLEN, sizeof(char));
+  alloc((void**)&fds, 1 + 3 * args.n_jobs, sizeof(struct pollfd));
+
+  // signals interrupt poll, the server stops once the running jobs finished
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handle_signal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  // what every stage would do on startup, done once
+  GDALAllRegister();
+  init_image_cache((size_t)args.cache * 1024 * 1024);
+
+  server.fd_listen = listen_socket(args.socket);
+
+  printf("Listening on %s, %d jobs at a time, %d MB image cache.\n", args.socket, args.n_jobs, args.cache);
+  fflush(stdout);
+
+  while (!stop || server.n_running > 0){
+
+    int n_fds = 0;
+
+    // new jobs are only accepted if one can be started
+    fds[n_fds].fd = (!stop && server.n_running < args.n_jobs) ? server.fd_listen : -1;
+    fds[n_fds++].events = POLLIN;
+
+    for (int j=0; j<server.n_running; j++){
+      fds[n_fds].fd = server.running[j].fd_access;
+      fds[n_fds++].events = POLLIN;
+      fds[n_fds].fd = server.running[j].hangup ? -1 : server.running[j].fd_client;
+      fds[n_fds++].events = POLLIN;
+    }
+
+    for (int l=0; l<server.n_loads; l++){
+      fds[n_fds].fd = server.loads[l].load.fd;
+      fds[n_fds++].events = POLLIN;
+    }
+
+    if (poll(fds, n_fds, -1) < 0){
+      if (errno == EINTR) continue;
+      fprintf(stderr, "Unable to poll: %s.\n", strerror(errno));
+      exit(FAILURE);
+    }
+
+    // loads and jobs are finished from the end, i.e. the indices of fds stay
+    // valid; loads first, as finished jobs may start new loads
+    for (int l=server.n_loads-1; l>=0; l--){
+      if (fds[1 + 2*server.n_running + l].revents & (POLLIN | POLLHUP | POLLERR)){
+        if (!receive_image(&server.loads[l].load)) finish_load(&server, l);
+      }
+    }
+
+    for (int j=server.n_running-1; j>=0; j--){
+
+      task_t *job = &server.running[j];
+      struct pollfd *fd_access = &fds[1 + 2*j];
+      struct pollfd *fd_client = &fds[2 + 2*j];
+
+      // the client sends nothing after the request, i.e. it went away
+      if (fd_client->revents & (POLLIN | POLLHUP | POLLERR)){
+        char byte;
+        ssize_t n_read = recv(job->fd_client, &byte, 1, MSG_DONTWAIT);
+        if (n_read == 0 || (n_read < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)){
+          printf("Job %d: client went away, stopping %s.\n", job->id, job->stage);
+          kill(-job->pid, SIGTERM);
+          job->hangup = true;
+        }
+      }
+
+      if (fd_access->revents & (POLLIN | POLLHUP | POLLERR)){
+        read_accesses(job);
+        if (job->fd_access < 0) reap_job(&server, j);
+      }
+
+    }
+
+    if (fds[0].revents & POLLIN){
+
+      int fd_client = accept(server.fd_listen, NULL, NULL);
+
+      if (fd_client >= 0){
+        start_job(&server, fd_client);
+      } else if (errno != EINTR && errno != EAGAIN){
+        fprintf(stderr, "Unable to accept a connection: %s.\n", strerror(errno));
+      }
+
+    }
+
+    fflush(stdout);
+
+  }
+
+  close(server.fd_listen);
+  unlink(args.socket);
+
+  // images that are still being read are not needed anymore
+  for (int l=server.n_loads-1; l>=0; l--) finish_load(&server, l);
+
+  printf("Server stopped after %d jobs.\n", server.n_jobs);
+
+  free_image_cache();
+  free((void*)server.running);
+  free((void*)server.loads);
+  free_2D((void**)server.seen, _SEEN_MAX_);
+  free((void*)fds);
+
+  GDALDestroy();
+
+  exit(SUCCESS);
+}
+
+
+/** Signal handler, stop the server
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void handle_signal(int signum){
+
+  stop = 1;
+
+  return;
+}
+
+
+/** Start a job
++++ This function receives a request, and forks a process that runs the
++++ stage. The process inherits the registered GDAL drivers and the image
++++ cache, and reports the images it reads and writes through a pipe.
+--- server:    server (modified)
+--- fd_client: connection to the client
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void start_job(server_t *server, int fd_client){
+request_t request;
+struct timeval timeout = { 10, 0 };
+int fd_pipe[2];
+pid_t pid;
+
+
+  // the stages run with the rights of the server
+  if (!peer_is_owner(fd_client)){
+    fprintf(stderr, "Connection from another user, closing it.\n");
+    close(fd_client);
+    return;
+  }
+
+  // a client that does not send its request does not block the server
+  setsockopt(fd_client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  if (receive_request(fd_client, &request) != SUCCESS){
+    fprintf(stderr, "Invalid request, closing the connection.\n");
+    close(fd_client);
+    return;
+  }
+
+  if (pipe(fd_pipe) != 0){
+    fprintf(stderr, "Unable to create a pipe: %s.\n", strerror(errno));
+    send_status(fd_client, FAILURE);
+    free_request(&request);
+    close(fd_client);
+    return;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+
+  if ((pid = fork()) < 0){
+    fprintf(stderr, "Unable to fork: %s.\n", strerror(errno));
+    send_status(fd_client, FAILURE);
+    free_request(&request);
+    close(fd_pipe[0]);
+    close(fd_pipe[1]);
+    close(fd_client);
+    return;
+  }
+
+  if (pid == 0){
+    close(fd_pipe[0]);
+    close(fd_client);
+    run_stage(server, &request, fd_pipe[1]);
+  }
+
+  close(fd_pipe[1]);
+
+  task_t *job = &server->running[server->n_running++];
+
+  job->id = ++server->n_jobs;
+  job->pid = pid;
+  job->fd_client = fd_client;
+  job->fd_access = fd_pipe[0];
+  job->accesses = NULL;
+  job->n_access = 0;
+  job->size_access = 0;
+  job->hangup = false;
+  copy_string(job->stage, STRLEN, request.argv[0]);
+  clock_gettime(CLOCK_MONOTONIC, &job->start);
+
+  printf("Job %d: %s in %s.\n", job->id, job->stage, request.cwd);
+
+  free_request(&request);
+
+  return;
+}
+
+
+/** Run a stage, in the forked process
++++ The stage writes to the output and error of the client, in the working
++++ directory of the client. This function does not return.
+--- server:    server
+--- request:   request
+--- fd_access: pipe that image accesses are reported to
++++ Return:    never
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void run_stage(server_t *server, request_t *request, int fd_access){
+int fd_null;
+
+
+  // the stage is stopped with its process group if the client goes away
+  setpgid(0, 0);
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  signal(SIGPIPE, SIG_DFL);
+
+  close_server_fds(server);
+
+  if ((fd_null = open("/dev/null", O_RDONLY)) >= 0){
+    dup2(fd_null, STDIN_FILENO);
+    close(fd_null);
+  }
+  dup2(request->fd_output, STDOUT_FILENO);
+  dup2(request->fd_error, STDERR_FILENO);
+
+  if (chdir(request->cwd) != 0){
+    fprintf(stderr, "Unable to change to directory %s.\n", request->cwd);
+    exit(FAILURE);
+  }
+
+  report_image_access(fd_access);
+
+  // the stage parses its arguments with getopt, like the server did
+  optind = 1;
+
+  for (size_t s=0; s<sizeof(STAGES)/sizeof(stage_t); s++){
+    if (strcmp(request->argv[0], STAGES[s].name) == 0){
+      exit(STAGES[s].main(request->argc, request->argv));
+    }
+  }
+
+  fprintf(stderr, "Unknown stage %s, the stages are:", request->argv[0]);
+  for (size_t s=0; s<sizeof(STAGES)/sizeof(stage_t); s++) fprintf(stderr, " %s", STAGES[s].name);
+  fprintf(stderr, "\n");
+
+  exit(FAILURE);
+}
+
+
+/** Read the image accesses reported by a job
++++ The pipe is closed when the job exited, i.e. fd_access is set to -1.
+--- job:    job (modified)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void read_accesses(task_t *job){
+ssize_t n_read;
+
+
+  if (job->size_access - job->n_access < STRLEN){
+    size_t size = (job->size_access > 0) ? job->size_access * 2 : 16 * STRLEN;
+    if (job->accesses == NULL){
+      alloc((void**)&job->accesses, size, sizeof(char));
+    } else {
+      re_alloc((void**)&job->accesses, job->size_access, size, sizeof(char));
+    }
+    job->size_access = size;
+  }
+
+  // leave room for the terminating zero
+  n_read = read(job->fd_access, job->accesses + job->n_access, job->size_access - job->n_access - 1);
+
+  if (n_read < 0 && errno == EINTR) return;
+
+  if (n_read <= 0){
+    close(job->fd_access);
+    job->fd_access = -1;
+    return;
+  }
+
+  job->n_access += n_read;
+
+  return;
+}
+
+
+/** Reap a job
++++ This function waits for the process of a job, sends the exit status to
++++ the client, and updates the image cache.
+--- server: server (modified)
+--- j:      running job
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void reap_job(server_t *server, int j){
+task_t *job = &server->running[j];
+struct timespec end;
+int wstatus, status = FAILURE;
+
+
+  while (waitpid(job->pid, &wstatus, 0) < 0){
+    if (errno != EINTR) break;
+  }
+
+  if (WIFEXITED(wstatus)){
+    status = WEXITSTATUS(wstatus);
+  } else if (WIFSIGNALED(wstatus)){
+    status = 128 + WTERMSIG(wstatus);
+  }
+
+  if (!job->hangup) send_status(job->fd_client, status);
+  close(job->fd_client);
+
+  update_cache(server, job);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  int n_cached;
+  size_t bytes = image_cache_bytes(&n_cached);
+
+  printf("Job %d: %s exited with %d after %.2f s, %d images cached (%.1f MB).\n",
+    job->id, job->stage, status,
+    (end.tv_sec - job->start.tv_sec) + (end.tv_nsec - job->start.tv_nsec) / 1e9,
+    n_cached, bytes / 1024.0 / 1024.0);
+
+  if (job->accesses != NULL) free((void*)job->accesses);
+
+  server->running[j] = server->running[--server->n_running];
+
+  return;
+}
+
+
+/** Update the image cache with the images a job read
++++ Images that a job read but did not write are cached when they are read
++++ by a second job, i.e. masks and coefficients are cached, but not the
++++ index of a new scene that is read once. Cached images that were read
++++ again are marked as used, or are read again if their file changed.
++++ Images are read in the background, see start_load. Images the job
++++ wrote are dropped from the cache.
+--- server: server (modified)
+--- job:    finished job
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void update_cache(server_t *server, task_t *job){
+char **lines = NULL;
+char *line = NULL, *position = NULL;
+int n_lines = 0;
+
+
+  if (job->n_access == 0) return;
+
+  job->accesses[job->n_access] = '\0';
+
+  for (size_t i=0; i<job->n_access; i++){
+    if (job->accesses[i] == '\n') n_lines++;
+  }
+
+  alloc((void**)&lines, n_lines + 1, sizeof(char*));
+
+  n_lines = 0;
+  for (line = strtok_r(job->accesses, "\n", &position); line != NULL; line = strtok_r(NULL, "\n", &position)){
+    if ((line[0] == 'r' || line[0] == 'w') && line[1] == ' ') lines[n_lines++] = line;
+  }
+
+  for (int i=0; i<n_lines; i++){
+
+    // the cached copy of an image the job wrote is outdated
+    if (lines[i][0] == 'w') uncache_image(lines[i] + 2);
+
+    if (lines[i][0] != 'r') continue;
+
+    char *path = lines[i] + 2;
+    bool skip = false;
+
+    // images the job wrote, and images it read before
+    for (int k=0; k<n_lines && !skip; k++){
+      if (k == i || strcmp(lines[k] + 2, path) != 0) continue;
+      if (lines[k][0] == 'w' || k < i) skip = true;
+    }
+
+    if (skip) continue;
+
+    bool seen = image_cached(path);
+
+    for (int k=0; k<server->n_seen && k<_SEEN_MAX_ && !seen; k++){
+      if (strcmp(server->seen[k], path) == 0) seen = true;
+    }
+
+    if (seen){
+      start_load(server, path);
+    } else {
+      copy_string(server->seen[server->n_seen % _SEEN_MAX_], STRLEN, path);
+      server->n_seen++;
+    }
+
+  }
+
+  free((void*)lines);
+
+  return;
+}
+
+
+
+/** Start reading an image into the cache
++++ The image is read by a forked process, such that the server keeps
++++ accepting and serving jobs meanwhile. The process inherits the
++++ registered GDAL drivers, and sends the image through a pipe, which is
++++ received in the poll loop. If all load slots are busy, the image is
++++ not cached now, but when it is read again.
+--- server: server (modified)
+--- path:   image file
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void start_load(server_t *server, char *path){
+loader_t *loader = NULL;
+int fd_pipe[2];
+pid_t pid;
+
+
+  if (server->n_loads == server->args->n_jobs) return;
+
+  loader = &server->loads[server->n_loads];
+
+  if (!start_image_load(path, &loader->load)) return;
+
+  for (int l=0; l<server->n_loads; l++){
+    if (strcmp(server->loads[l].load.path, loader->load.path) == 0) return;
+  }
+
+  if (pipe(fd_pipe) != 0){
+    fprintf(stderr, "Unable to create a pipe: %s.\n", strerror(errno));
+    return;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+
+  if ((pid = fork()) < 0){
+    fprintf(stderr, "Unable to fork: %s.\n", strerror(errno));
+    close(fd_pipe[0]);
+    close(fd_pipe[1]);
+    return;
+  }
+
+  if (pid == 0){
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    close(fd_pipe[0]);
+    close_server_fds(server);
+    exit(send_image(&loader->load, fd_pipe[1]));
+  }
+
+  close(fd_pipe[1]);
+  fcntl(fd_pipe[0], F_SETFL, fcntl(fd_pipe[0], F_GETFL) | O_NONBLOCK);
+
+  loader->pid = pid;
+  loader->load.fd = fd_pipe[0];
+  server->n_loads++;
+
+  return;
+}
+
+
+/** Finish reading an image into the cache
++++ This function waits for the process that read the image. Usually, the
++++ image was received or dropped already, see receive_image. Otherwise,
++++ e.g. when the server stops, the process is stopped, and the partial
++++ image is dropped.
+--- server: server (modified)
+--- l:      load
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void finish_load(server_t *server, int l){
+loader_t *loader = &server->loads[l];
+
+
+  if (loader->load.fd >= 0) kill(loader->pid, SIGTERM);
+
+  while (waitpid(loader->pid, NULL, 0) < 0){
+    if (errno != EINTR) break;
+  }
+
+  // the pipe is closed now, i.e. this does not block
+  if (loader->load.fd >= 0) receive_image(&loader->load);
+
+  server->loads[l] = server->loads[--server->n_loads];
+
+  return;
+}
+
+
+/** Close the files of the server, in a forked process
+--- server: server
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void close_server_fds(server_t *server){
+
+
+  close(server->fd_listen);
+
+  for (int j=0; j<server->n_running; j++){
+    close(server->running[j].fd_client);
+    if (server->running[j].fd_access >= 0) close(server->running[j].fd_access);
+  }
+
+  for (int l=0; l<server->n_loads; l++){
+    close(server->loads[l].load.fd);
+  }
+
+  return;
+}
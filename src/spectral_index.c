@@ -7,78 +7,167 @@
 #include "cpl_conv.h"   // various convenience functions for CPL
 #include "cpl_string.h" // various convenience functions for strings
 
+/** OpenMP **/
+#include <omp.h> // multi-platform shared memory multiprocessing
 
 #include "utils/alloc.h"
 #include "utils/const.h"
 #include "utils/dir.h"
 #include "utils/quality.h"
 #include "utils/image_io.h"
+#include "utils/indices.h"
+#include "utils/manifest.h"
+#include "utils/spectral.h"
 #include "utils/string.h"
 #include "args/args_spectral_index.h"
 
 
-// bands to read
-static const int BAND_NUMBERS[] = { 8, 9, 10 };
-static const float WAVELENGTHS[] = { 0.864, 1.609, 2.202 };
-#define N_BANDS (sizeof(BAND_NUMBERS)/sizeof(BAND_NUMBERS[0]))
-
+void process_scene(char *path_reflectance, char *path_quality, char **path_output, image_t *mask, qai_rules_t *qai_rules, indexlist_t *indices, int n_threads);
 
 
 int main ( int argc, char *argv[] ){
 args_t args;
-image_t reflectance;
-image_t quality;
 image_t mask;
-image_t index;
-bandlist_t bands;
+qai_rules_t qai_rules;
+int n_workers, n_threads, n_bands = 0;
+size_t scene_bytes;
+manifest_t *manifest = NULL;
+int *todo = NULL, n_todo = 0;
 
   parse_args(argc, argv, &args);
 
-  GDALAllRegister();
+  // scenes whose outputs are up to date are skipped
+  alloc((void**)&manifest, args.n_scenes, sizeof(manifest_t));
+  alloc((void**)&todo, args.n_scenes, sizeof(int));
 
-  bands.n = N_BANDS;
-  bands.number = (int*)BAND_NUMBERS;
-  bands.wavelengths = (float*)WAVELENGTHS;
+  for (int i=0; i<args.n_scenes; i++){
 
-  read_image(args.path_reflectance, &bands, &reflectance);
-  read_image(args.path_quality, NULL, &quality);
-  read_image(args.path_mask, NULL, &mask);
+    init_manifest(&manifest[i], "spectral_index");
+    add_manifest_parameter(&manifest[i], "index", "%s", args.index);
+    add_manifest_parameter(&manifest[i], "qai", "%s", args.qai_rules);
+    add_manifest_input(&manifest[i], args.path_reflectance[i]);
+    add_manifest_input(&manifest[i], args.path_quality[i]);
+    add_manifest_input(&manifest[i], args.path_mask);
+    if (fileexist(args.qai_rules)) add_manifest_input(&manifest[i], args.qai_rules);
+
+    if (outputs_fresh(&manifest[i], args.path_output + (size_t)i * args.indices.n,
+          args.indices.n, args.incremental)) continue;
+
+    todo[n_todo++] = i;
 
-  compare_images(&reflectance, &quality);
-  compare_images(&reflectance, &mask);
-
-  copy_image(&reflectance, &index, 1, SHRT_MIN, args.path_output);
-
-  for (int p=0; p<index.nc; p++){
-
-    if (quality.data[0][p] == quality.nodata ||
-        reflectance.data[0][p] == reflectance.nodata ||
-        reflectance.data[1][p] == reflectance.nodata ||
-        reflectance.data[2][p] == reflectance.nodata ||
-        mask.data[0][p] == mask.nodata ||
-        mask.data[0][p] == 0 ||
-        !use_this_pixel(quality.data[0][p])){
-      index.data[0][p] = index.nodata;
-      continue;
-    }
-
-    float interpolated = 
-      (reflectance.data[0][p] * (bands.wavelengths[2] - bands.wavelengths[1]) + 
-       reflectance.data[2][p] * (bands.wavelengths[1] - bands.wavelengths[0])) / 
-      (bands.wavelengths[2] - bands.wavelengths[0]);
-
-    index.data[0][p] = (short)(reflectance.data[1][p] - interpolated);
-  
   }
 
-  write_image(&index);
+  if (n_todo < args.n_scenes){
+    printf("%d of %d scenes are up to date, skipping them.\n", args.n_scenes - n_todo, args.n_scenes);
+  }
+
+  if (n_todo == 0){
+    for (int i=0; i<args.n_scenes; i++) free_manifest(&manifest[i]);
+    free((void*)manifest);
+    free((void*)todo);
+    exit(SUCCESS);
+  }
+
+  if (compile_qai_rules(args.qai_rules, &qai_rules) != SUCCESS){
+    fprintf(stderr, "Could not compile QAI screening rules.\n");
+    exit(FAILURE);
+  }
+
+  GDALAllRegister();
+
+  // the mask is shared by all scenes
+  read_image(args.path_mask, NULL, &mask);
+
+  // scenes in flight: bounded by CPUs, and by the memory limit
+  // one scene holds the reflectance bands, the quality and the outputs
+  for (int r=0; r<_BAND_ROLES_; r++){
+    if (args.indices.bands & (1 << r)) n_bands++;
+  }
+  scene_bytes = (size_t)mask.nc * (n_bands + 1 + args.indices.n) * sizeof(short);
+  n_workers = (args.n_cpus < n_todo) ? args.n_cpus : n_todo;
+  if (args.memory > 0){
+    size_t n_fit = (size_t)args.memory * 1024 * 1024 / scene_bytes;
+    if (n_fit < 1) n_fit = 1;
+    if (n_fit < (size_t)n_workers) n_workers = (int)n_fit;
+  }
+  n_threads = args.n_cpus / n_workers;
+
+  // scenes run in parallel, the remaining CPUs are used within scenes
+  omp_set_max_active_levels(2);
+
+  #pragma omp parallel for num_threads(n_workers) schedule(dynamic) shared(args, mask, qai_rules, n_threads, manifest, todo, n_todo) default(none)
+  for (int t=0; t<n_todo; t++){
+    int i = todo[t];
+    process_scene(args.path_reflectance[i], args.path_quality[i], 
+      args.path_output + (size_t)i * args.indices.n, 
+      &mask, &qai_rules, &args.indices, n_threads);
+    write_manifests(&manifest[i], args.path_output + (size_t)i * args.indices.n,
+      args.indices.n, args.incremental);
+  }
 
-  free_image(&reflectance);
-  free_image(&quality);
   free_image(&mask);
-  free_image(&index);
+  for (int i=0; i<args.n_scenes; i++) free_manifest(&manifest[i]);
+  free((void*)manifest);
+  free((void*)todo);
+  free_2D((void**)args.path_reflectance, args.n_scenes);
+  free_2D((void**)args.path_quality, args.n_scenes);
+  free_2D((void**)args.path_output, args.n_scenes * args.indices.n);
 
   GDALDestroy();
 
   exit(SUCCESS);
 }
+
+
+/** Compute the indices of one scene
++++ This function reads the reflectance bands that are needed by the se-
++++ lected indices and the quality image of one scene once, computes all
++++ indices and writes one output image per index.
+--- path_reflectance: reflectance image
+--- path_quality:     quality image
+--- path_output:      output images, one per index
+--- mask:             mask image, shared by all scenes
+--- qai_rules:        compiled QAI screening rules
+--- indices:          selected indices
+--- n_threads:        number of threads for this scene
++++ Return:           void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void process_scene(char *path_reflectance, char *path_quality, char **path_output, image_t *mask, qai_rules_t *qai_rules, indexlist_t *indices, int n_threads){
+image_t reflectance;
+image_t quality;
+image_t index[_INDEX_MAX_];
+bandlist_t bands;
+int number[_BAND_ROLES_];
+float wavelengths[_BAND_ROLES_];
+int slot[_BAND_ROLES_];
+
+  // read the union of the bands of all indices
+  bands.number = number;
+  bands.wavelengths = wavelengths;
+  select_index_bands(indices, &bands, slot);
+
+  read_image(path_reflectance, &bands, &reflectance);
+  read_image(path_quality, NULL, &quality);
+
+  compare_images(&reflectance, &quality);
+  compare_images(&reflectance, mask);
+
+  for (int k=0; k<indices->n; k++){
+    copy_image(&reflectance, &index[k], 1, SHRT_MIN, path_output[k]);
+  }
+
+  if (compute_indices(&reflectance, slot, &quality, mask, qai_rules, indices, index, n_threads) != SUCCESS){
+    fprintf(stderr, "Unable to allocate memory for the indices.\n");
+    exit(FAILURE);
+  }
+
+  for (int k=0; k<indices->n; k++){
+    write_image(&index[k]);
+    free_image(&index[k]);
+  }
+
+  free_image(&reflectance);
+  free_image(&quality);
+
+  return;
+}
@@ -15,6 +15,7 @@
 #include "utils/date.h"
 #include "utils/dir.h"
 #include "utils/image_io.h"
+#include "utils/manifest.h"
 #include "utils/string.h"
 #include "utils/stats.h"
 #include "args/args_temporal_variability.h"
@@ -25,21 +26,36 @@
 int main ( int argc, char *argv[] ){
 args_t args;
 date_t *dates = NULL;
-image_t *input = NULL;
+image_t input;
 image_t mask;
 image_t variability;
 image_t reference;
+int n_years = 2100; // should be enough, no?
+manifest_t manifest;
 
 
   parse_args(argc, argv, &args);
 
+  init_manifest(&manifest, "temporal_variability");
+  add_manifest_input(&manifest, args.path_mask);
+  add_manifest_input(&manifest, args.path_reference);
+  for (int i=0; i<args.n_images; i++) add_manifest_input(&manifest, args.path_input[i]);
+
+  char *outputs[] = { args.path_output };
+
+  if (outputs_fresh(&manifest, outputs, 1, args.incremental)){
+    printf("Output is up to date, skipping.\n");
+    free_manifest(&manifest);
+    exit(SUCCESS);
+  }
+
   GDALAllRegister();
 
-  read_image(args.path_mask, NULL, &mask);
-  read_image(args.path_reference, NULL, &reference);
+  // check the images, but do not read them yet
+  read_image_info(args.path_mask, &mask);
+  read_image_info(args.path_reference, &reference);
   compare_images(&mask, &reference);
 
-  alloc((void**)&input, args.n_images, sizeof(image_t));
   alloc((void**)&dates, args.n_images, sizeof(date_t));
 
   for (int i=0; i<args.n_images; i++){
@@ -48,8 +64,13 @@ image_t reference;
     basename_with_ext(args.path_input[i], basename, STRLEN);
     date_from_string(&dates[i], basename);
     
-    read_image(args.path_input[i], NULL, &input[i]);
-    compare_images(&mask, &input[i]);
+    read_image_info(args.path_input[i], &input);
+    compare_images(&mask, &input);
+
+    if (dates[i].year < 0 || dates[i].year >= n_years){
+      fprintf(stderr, "Year of input image %s is out of range.\n", args.path_input[i]);
+      exit(FAILURE);
+    }
 
     if (i > 0){
       if (dates[i].ce < dates[i-1].ce){
@@ -60,63 +81,150 @@ image_t reference;
 
   }
 
-
-  enum { start, end };
-  int n_years = 2100; // should be enough, no?
-  int **range = NULL;
-  alloc_2D((void***)&range, n_years, 2, sizeof(int));
-  for (int i=0; i<args.n_images; i++){
-    if (range[dates[i].year][start] == 0) range[dates[i].year][start] = i;
-    if (range[dates[i].year][end] < (i+1)) range[dates[i].year][end] = (i+1);
-  }
-
   copy_image(&reference, &variability, 1, SHRT_MIN, args.path_output);
 
+  int n_blocks = (variability.ny + args.block_rows - 1) / args.block_rows;
   
-  omp_set_num_threads(args.n_cpus);
+  // no more threads than blocks, such that every stripe has a block
+  omp_set_num_threads((args.n_cpus < n_blocks) ? args.n_cpus : n_blocks);
 
-  #pragma omp parallel shared(input, mask, range, variability, reference) default(none)
+  #pragma omp parallel shared(args, dates, n_years, n_blocks, variability) default(none)
   {
 
-  #pragma omp for
-  for (int p=0; p<variability.nc; p++){
+    // each thread streams a stripe of consecutive blocks, such that every
+    // image is opened once per thread, and not once per block
+    int n_threads = omp_get_num_threads();
+    int thread = omp_get_thread_num();
+    int first = (int)((long)n_blocks * thread / n_threads);
+    int last  = (int)((long)n_blocks * (thread+1) / n_threads);
+    int n_stripe = last - first;
+
+    int row0 = first * args.block_rows;
+    int stripe_rows = (last * args.block_rows > variability.ny) ? variability.ny - row0 : n_stripe * args.block_rows;
+    int stripe_nc = stripe_rows * variability.nx;
+
+    // per-thread accumulators of the stripe, the years referenced per block
+    double *count = NULL, *mean = NULL, *var = NULL;
+    short *ref = NULL;
+    bool *inside = NULL, *valid = NULL, *year_used = NULL;
+    bool **block_years = NULL;
+
+    alloc((void**)&count,  stripe_nc, sizeof(double));
+    alloc((void**)&mean,   stripe_nc, sizeof(double));
+    alloc((void**)&var,    stripe_nc, sizeof(double));
+    alloc((void**)&ref,    stripe_nc, sizeof(short));
+    alloc((void**)&inside, stripe_nc, sizeof(bool));
+    alloc((void**)&valid,  stripe_nc, sizeof(bool));
+    alloc((void**)&year_used, n_years, sizeof(bool));
+    alloc_2D((void***)&block_years, n_stripe, n_years, sizeof(bool));
+
+    GDALDatasetH fp_mask = open_image(args.path_mask);
+    GDALDatasetH fp_reference = open_image(args.path_reference);
+
+    for (int b=0; b<n_stripe; b++){
+
+      int row = (first + b) * args.block_rows;
+      int n_rows = (row + args.block_rows > variability.ny) ? variability.ny - row : args.block_rows;
+      int offset = (row - row0) * variability.nx;
+      image_t mask_block, reference_block;
+
+      read_dataset_rows(fp_mask, args.path_mask, NULL, row, n_rows, &mask_block);
+      read_dataset_rows(fp_reference, args.path_reference, NULL, row, n_rows, &reference_block);
+
+      short *msk = mask_block.data[0];
+
+      for (int k=0; k<mask_block.nc; k++){
+        short year = reference_block.data[0][k];
+        inside[offset+k] = msk[k] != mask_block.nodata && msk[k] != 0;
+        valid[offset+k] = inside[offset+k] && 
+                          year != reference_block.nodata && year >= 0 && year < n_years;
+        ref[offset+k] = year;
+        if (valid[offset+k]) block_years[b][year] = year_used[year] = true;
+      }
+
+      free_image(&mask_block);
+      free_image(&reference_block);
+
+    }
+
+    if (fp_mask != NULL) GDALClose(fp_mask);
+    if (fp_reference != NULL) GDALClose(fp_reference);
+
+    // stream the images of these years, compute mean, variance
+    for (int i=0; i<args.n_images; i++){
+
+      if (!year_used[dates[i].year]) continue;
+
+      GDALDatasetH fp_input = open_image(args.path_input[i]);
+      short year = (short)dates[i].year;
 
-    if (mask.data[0][p] == mask.nodata || mask.data[0][p] == 0) continue;
+      for (int b=0; b<n_stripe; b++){
 
-    variability.data[0][p] = variability.nodata;
+        if (!block_years[b][year]) continue;
+
+        int row = (first + b) * args.block_rows;
+        int n_rows = (row + args.block_rows > variability.ny) ? variability.ny - row : args.block_rows;
+        int offset = (row - row0) * variability.nx;
+        image_t input_block;
+
+        read_dataset_rows(fp_input, args.path_input[i], NULL, row, n_rows, &input_block);
+
+        short *x = input_block.data[0];
+        short nodata = input_block.nodata;
+        double *c = count + offset, *m = mean + offset, *v = var + offset;
+        short *r = ref + offset;
+        bool *ok = valid + offset;
+
+        // same update as var_recurrence, for all pixels of this year at once
+        #pragma omp simd
+        for (int k=0; k<input_block.nc; k++){
+          bool use = ok[k] && r[k] == year && x[k] != nodata;
+          double n = c[k] + use;
+          double delta = x[k] - m[k];
+          double mean_new = m[k] + delta / (use ? n : 1.0);
+          double var_new = v[k] + delta * (x[k] - mean_new);
+          c[k] = n;
+          m[k] = use ? mean_new : m[k];
+          v[k] = use ? var_new : v[k];
+        }
+
+        free_image(&input_block);
+
+      }
+
+      if (fp_input != NULL) GDALClose(fp_input);
 
-    if (reference.data[0][p] == reference.nodata){
-      continue;
     }
-    
-    double mean = 0, var = 0, n = 0;
-  
-    for (int i=range[reference.data[0][p]][start]; i<range[reference.data[0][p]][end]; i++){
 
-      if (input[i].data[0][p] == input[i].nodata) continue;
+    short *out = variability.data[0] + (size_t)row0 * variability.nx;
+
+    for (int k=0; k<stripe_nc; k++){
+
+      if (!inside[k]) continue;
+
+      out[k] = variability.nodata;
+
+      if (count[k] > 0) out[k] = (short)standdev(var[k], count[k]);
 
-      // compute mean, variance
-      n++;
-      var_recurrence((double)input[i].data[0][p], &mean, &var, (double)n);
     }
 
-    if (n > 0) variability.data[0][p] = (short)standdev(var, n);
-  
-  }
+    free((void*)count);
+    free((void*)mean);
+    free((void*)var);
+    free((void*)ref);
+    free((void*)inside);
+    free((void*)valid);
+    free((void*)year_used);
+    free_2D((void**)block_years, n_stripe);
 
   } // end omp parallel region
 
   write_image(&variability);
+  write_manifests(&manifest, outputs, 1, args.incremental);
+  free_manifest(&manifest);
 
-  for (int i=0; i<args.n_images; i++){
-    free_image(&input[i]);
-  }
-  free((void*)input);
-  free_image(&mask);
   free_image(&variability);
-  free_image(&reference);
   free((void*)dates);
-  free_2D((void**)range, n_years);
   free_2D((void**)args.path_input, args.n_images);
   
   GDALDestroy();
@@ -13,6 +13,7 @@
 #include "utils/dir.h"
 #include "utils/quality.h"
 #include "utils/image_io.h"
+#include "utils/manifest.h"
 #include "utils/string.h"
 #include "args/args_update_mask.h"
 
@@ -26,10 +27,23 @@ args_t args;
 image_t disturbance;
 image_t mask;
 image_t output;
+manifest_t manifest;
 
 
   parse_args(argc, argv, &args);
 
+  init_manifest(&manifest, "update_mask");
+  add_manifest_input(&manifest, args.path_disturbance);
+  add_manifest_input(&manifest, args.path_mask);
+
+  char *outputs[] = { args.path_output };
+
+  if (outputs_fresh(&manifest, outputs, 1, args.incremental)){
+    printf("Output is up to date, skipping.\n");
+    free_manifest(&manifest);
+    exit(SUCCESS);
+  }
+
   GDALAllRegister();
 
   read_image(args.path_disturbance, NULL, &disturbance);
@@ -50,10 +64,12 @@ image_t output;
   }
 
   write_image(&output);
+  write_manifests(&manifest, outputs, 1, args.incremental);
 
   free_image(&disturbance);
   free_image(&mask);
   free_image(&output);
+  free_manifest(&manifest);
 
   GDALDestroy();
 
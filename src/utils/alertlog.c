@@ -0,0 +1,288 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for the append-only alert log
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "alertlog.h"
+
+
+int compare_alerts(const void *a, const void *b);
+void alertlog_index_path(char *path, char index_path[], size_t size);
+void write_alertlog_buffer(int fd, void *buffer, size_t bytes, off_t offset, char *path);
+
+
+/** Initialize alert list
++++ This function initializes an empty alert list. Memory is allocated on
++++ the first insertion.
+--- list:   alert list
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_alertlist(alertlist_t *list){
+
+  list->alert = NULL;
+  list->n = 0;
+  list->size = 0;
+
+  return;
+}
+
+
+/** Add alert to list
++++ This function appends an alert to the list. The list grows by doubling
++++ its size. Lists are not thread-safe, use one list per thread.
+--- list:      alert list
+--- pixel:     pixel id
+--- date:      date (days since 1970)
+--- type:      event type
+--- direction: direction of the anomaly
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void add_alert(alertlist_t *list, int pixel, int date, int type, int direction){
+
+  if (list->n == list->size){
+    int size = (list->size > 0) ? list->size * 2 : 1024;
+    if (list->alert == NULL){
+      alloc((void**)&list->alert, size, sizeof(alert_t));
+    } else {
+      re_alloc((void**)&list->alert, list->size, size, sizeof(alert_t));
+    }
+    list->size = size;
+  }
+
+  list->alert[list->n].pixel = pixel;
+  list->alert[list->n].date = date;
+  list->alert[list->n].type = (short)type;
+  list->alert[list->n].direction = (short)direction;
+  list->n++;
+
+  return;
+}
+
+
+/** Merge alert lists
++++ This function merges several alert lists, e.g. the per-thread lists of
++++ a parallel region, into one list, which is sorted by date, pixel id and
++++ type. The input lists are freed.
+--- lists:   alert lists
+--- n_lists: number of alert lists
+--- merged:  merged alert list (returned)
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void merge_alertlists(alertlist_t *lists, int n_lists, alertlist_t *merged){
+int n = 0;
+
+  init_alertlist(merged);
+
+  for (int l=0; l<n_lists; l++) n += lists[l].n;
+  if (n == 0) return;
+
+  alloc((void**)&merged->alert, n, sizeof(alert_t));
+  merged->size = n;
+
+  for (int l=0; l<n_lists; l++){
+    if (lists[l].n > 0){
+      memcpy(merged->alert + merged->n, lists[l].alert, lists[l].n * sizeof(alert_t));
+    }
+    merged->n += lists[l].n;
+    free_alertlist(&lists[l]);
+  }
+
+  qsort(merged->alert, merged->n, sizeof(alert_t), compare_alerts);
+
+  return;
+}
+
+
+/** Free alert list
+--- list:   alert list
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_alertlist(alertlist_t *list){
+
+  if (list->alert != NULL) free((void*)list->alert);
+  init_alertlist(list);
+
+  return;
+}
+
+
+/** Watermark of the alert log
++++ This function returns the latest date that was committed to the alert
++++ log. Only events after this date are new and will be appended.
+--- path:   alert log
++++ Return: latest committed date (days since 1970), INT_MIN if empty
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int alertlog_watermark(char *path){
+char index_path[STRLEN];
+alert_index_t last;
+FILE *fp = NULL;
+long n;
+
+  alertlog_index_path(path, index_path, STRLEN);
+
+  if ((fp = fopen(index_path, "rb")) == NULL) return INT_MIN;
+
+  fseek(fp, 0, SEEK_END);
+  n = ftell(fp) / (long)sizeof(alert_index_t);
+
+  if (n < 1){
+    fclose(fp);
+    return INT_MIN;
+  }
+
+  fseek(fp, (n-1) * (long)sizeof(alert_index_t), SEEK_SET);
+  if (fread(&last, sizeof(alert_index_t), 1, fp) != 1){
+    fprintf(stderr, "Unable to read alert log index %s.\n", index_path);
+    exit(FAILURE);
+  }
+
+  fclose(fp);
+
+  return last.date;
+}
+
+
+/** Append alerts to the alert log
++++ This function appends all alerts that are newer than the watermark of
++++ the log. The log consists of fixed-size alert_t records, which are or-
++++ dered by date. The index (log path + .idx) holds one alert_index_t re-
++++ cord per date. Records are synced to disk before the index, i.e. the
++++ index is the commit marker: records not covered by the index, e.g. af-
++++ ter a crash, are discarded on the next append. The log is locked ex-
++++ clusively while appending.
+--- path:   alert log
+--- list:   alert list, sorted by date
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void append_alertlog(char *path, alertlist_t *list){
+char index_path[STRLEN];
+int fd_log, fd_index;
+struct stat st;
+alert_index_t last = { INT_MIN, 0, 0 };
+alert_index_t *index = NULL;
+int n_index = 0, first = 0;
+long long committed;
+
+
+  alertlog_index_path(path, index_path, STRLEN);
+
+  if ((fd_log = open(path, O_RDWR | O_CREAT, 0644)) < 0){
+    fprintf(stderr, "Unable to open alert log %s.\n", path);
+    exit(FAILURE);
+  }
+
+  if (flock(fd_log, LOCK_EX) != 0){
+    fprintf(stderr, "Unable to lock alert log %s.\n", path);
+    exit(FAILURE);
+  }
+
+  if ((fd_index = open(index_path, O_RDWR | O_CREAT, 0644)) < 0){
+    fprintf(stderr, "Unable to open alert log index %s.\n", index_path);
+    exit(FAILURE);
+  }
+
+  // last committed index entry, discard partially written entries
+  fstat(fd_index, &st);
+  off_t n_committed = st.st_size / (off_t)sizeof(alert_index_t);
+  if (ftruncate(fd_index, n_committed * sizeof(alert_index_t)) != 0){
+    fprintf(stderr, "Unable to truncate alert log index %s.\n", index_path);
+    exit(FAILURE);
+  }
+  if (n_committed > 0 &&
+      pread(fd_index, &last, sizeof(alert_index_t), (n_committed-1) * sizeof(alert_index_t)) != sizeof(alert_index_t)){
+    fprintf(stderr, "Unable to read alert log index %s.\n", index_path);
+    exit(FAILURE);
+  }
+
+  // discard records that are not covered by the index
+  committed = last.first + last.n;
+  if (ftruncate(fd_log, committed * sizeof(alert_t)) != 0){
+    fprintf(stderr, "Unable to truncate alert log %s.\n", path);
+    exit(FAILURE);
+  }
+
+  // skip alerts that were already committed
+  while (first < list->n && list->alert[first].date <= last.date) first++;
+
+  if (first < list->n){
+
+    alloc((void**)&index, list->n - first, sizeof(alert_index_t));
+
+    for (int a=first; a<list->n; a++){
+      if (n_index == 0 || index[n_index-1].date != list->alert[a].date){
+        index[n_index].date = list->alert[a].date;
+        index[n_index].first = committed + (a - first);
+        index[n_index].n = 0;
+        n_index++;
+      }
+      index[n_index-1].n++;
+    }
+
+    write_alertlog_buffer(fd_log, list->alert + first, (list->n - first) * sizeof(alert_t),
+      committed * sizeof(alert_t), path);
+    fsync(fd_log);
+
+    write_alertlog_buffer(fd_index, index, n_index * sizeof(alert_index_t),
+      n_committed * sizeof(alert_index_t), index_path);
+    fsync(fd_index);
+
+    free((void*)index);
+
+  }
+
+  printf("Appended %d alerts on %d dates to %s.\n", list->n - first, n_index, path);
+
+  close(fd_index);
+  flock(fd_log, LOCK_UN);
+  close(fd_log);
+
+  return;
+}
+
+
+/** Path of the alert log index
+--- path:       alert log
+--- index_path: buffer that will hold the index path
+--- size:       length of the buffer
++++ Return:     void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void alertlog_index_path(char *path, char index_path[], size_t size){
+
+  concat_string_2(index_path, size, path, "idx", ".");
+
+  return;
+}
+
+
+/** Write buffer completely at given offset, abort on failure
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void write_alertlog_buffer(int fd, void *buffer, size_t bytes, off_t offset, char *path){
+char *ptr = (char*)buffer;
+ssize_t written;
+
+  while (bytes > 0){
+    if ((written = pwrite(fd, ptr, bytes, offset)) <= 0){
+      fprintf(stderr, "Unable to write to %s.\n", path);
+      exit(FAILURE);
+    }
+    ptr += written;
+    offset += written;
+    bytes -= written;
+  }
+
+  return;
+}
+
+
+/** Compare alerts by date, pixel id and type (qsort callback)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int compare_alerts(const void *a, const void *b){
+const alert_t *aa = (const alert_t*)a;
+const alert_t *ab = (const alert_t*)b;
+
+  if (aa->date != ab->date) return (aa->date > ab->date) - (aa->date < ab->date);
+  if (aa->pixel != ab->pixel) return (aa->pixel > ab->pixel) - (aa->pixel < ab->pixel);
+
+  return (aa->type > ab->type) - (aa->type < ab->type);
+}
+
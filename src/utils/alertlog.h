@@ -0,0 +1,61 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Append-only alert log header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef ALERTLOG_H
+#define ALERTLOG_H
+
+#include <stdio.h>     // core input and output functions
+#include <stdlib.h>    // standard general utilities library
+#include <string.h>    // string handling functions
+#include <limits.h>    // macro constants of the integer types
+
+#include <fcntl.h>     // file control options
+#include <unistd.h>    // essential POSIX functions and constants
+#include <sys/file.h>  // advisory file locks
+#include <sys/stat.h>  // file information
+
+#include "alloc.h"
+#include "const.h"
+#include "string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// one record of the alert log (12 bytes)
+typedef struct {
+  int pixel;       // pixel id (row-major)
+  int date;        // date of the observation that triggered the event (days since 1970)
+  short type;      // _ALERT_RAISED_, _ALERT_CONFIRMED_ or _ALERT_REVERTED_
+  short direction; // direction of the anomaly (1: positive, -1: negative)
+} alert_t;
+
+// one record of the date index (16 bytes)
+typedef struct {
+  int date;        // date (days since 1970)
+  int n;           // number of records with this date
+  long long first; // record number of the first record with this date
+} alert_index_t;
+
+typedef struct {
+  alert_t *alert; // array of alerts
+  int n;          // number of alerts
+  int size;       // number of allocated alerts
+} alertlist_t;
+
+void init_alertlist(alertlist_t *list);
+void add_alert(alertlist_t *list, int pixel, int date, int type, int direction);
+void merge_alertlists(alertlist_t *lists, int n_lists, alertlist_t *merged);
+void free_alertlist(alertlist_t *list);
+int alertlog_watermark(char *path);
+void append_alertlog(char *path, alertlist_t *list);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -44,6 +44,51 @@ int i;
 }
 
 
+/** Try to allocate array
++++ Like alloc, but the failure is returned instead of exiting, e.g. for
++++ code that is embedded in other processes.
+--- ptr:    Pointer to the memory block, NULL on failure
+--- n:      Number of elements to allocate
+--- size:   Size of each element
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int try_alloc(void **ptr, size_t n, size_t size){
+
+  *ptr = (void*) calloc(n, size);
+
+  return (*ptr == NULL) ? FAILURE : SUCCESS;
+}
+
+
+/** Try to allocate 2D-array
++++ Like alloc_2D, but the failure is returned instead of exiting. Nothing
++++ is left allocated on failure.
+--- ptr:    Pointer to the memory block, NULL on failure
+--- n1:     Number of elements to allocate (1st dimension)
+--- n2:     Number of elements to allocate (2nd dimension)
+--- size:   Size of each element
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int try_alloc_2D(void ***ptr, size_t n1, size_t n2, size_t size){
+void **arr = NULL;
+size_t i;
+
+  *ptr = NULL;
+
+  if (try_alloc((void**)&arr, n1, sizeof(void*)) != SUCCESS) return FAILURE;
+
+  for (i=0; i<n1; i++){
+    if (try_alloc((void**)&arr[i], n2, size) != SUCCESS){
+      free_2D(arr, i);
+      return FAILURE;
+    }
+  }
+
+  *ptr = arr;
+  return SUCCESS;
+}
+
+
 /** Allocate contiguous 2D-array
 +++ This function allocates a block of memory, and initializes it with 0.
 +++ Unlike alloc_2D, one single block of memory is allocated and pointers
@@ -10,6 +10,8 @@ Allocation header
 #include <stdlib.h>  // standard general utilities library
 #include <string.h>  // string handling functions
 
+#include "const.h"
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,6 +19,8 @@ extern "C" {
 
 void alloc(void **ptr, size_t n, size_t size);
 void alloc_2D(void ***ptr, size_t n1, size_t n2, size_t size);
+int try_alloc(void **ptr, size_t n, size_t size);
+int try_alloc_2D(void ***ptr, size_t n1, size_t n2, size_t size);
 void alloc_3D(void ****ptr, size_t n1, size_t n2, size_t n3, size_t size);
 void alloc_2DC(void ***ptr, size_t n1, size_t n2, size_t size);
 void re_alloc(void **ptr, size_t n_now, size_t n, size_t size);
@@ -0,0 +1,509 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains the yearly processing chain of one pixel, i.e. the
+reference period, disturbance detection and mask update of all years
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "chain.h"
+
+
+static const char *CHAIN_OUTPUT_NAMES[_YEAR_OUTPUTS_] = { "reference_period", "coefficients", "disturbance", "mask", "disturbances" };
+
+
+bool is_archived(chain_t *chain, int k, int o);
+
+
+/** Initialize the processing chain
++++ This function parses the dates of the input images, and determines
++++ which images are used in each year. In year k, the reference period
++++ is extended until the previous year with images [0, i_end[k]), and
++++ disturbances are detected with images [i_end[k], i_end[k+1]). The
++++ years range from the given year to the year of the latest image.
+--- path_input:          input images, ordered by date
+--- n_images:            number of input images
+--- year:                first year to detect disturbances in
+--- modes:               number of harmonic modes
+--- trend:               use trend coefficient?
+--- threshold:           reference period threshold
+--- confirmation_number: reference period confirmation number
+--- rule:                detection rule
+--- chain:               processing chain (returned)
++++ Return:              void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_chain(char **path_input, int n_images, int year, int modes, int trend, int threshold, int confirmation_number, detection_rule_t *rule, chain_t *chain){
+
+
+  chain->year = year;
+  chain->n_images = n_images;
+  chain->modes = modes;
+  chain->trend = trend;
+  chain->rule = *rule;
+  chain->path_output = NULL;
+  chain->fp_output = NULL;
+
+  alloc((void**)&chain->dates, n_images, sizeof(date_t));
+
+  for (int i=0; i<n_images; i++){
+
+    char basename[STRLEN];
+    basename_with_ext(path_input[i], basename, STRLEN);
+    date_from_string(&chain->dates[i], basename);
+
+    if (i > 0){
+      if (chain->dates[i].ce < chain->dates[i-1].ce){
+        fprintf(stderr, "Input images must be ordered by date (earliest to latest).\n");
+        exit(FAILURE);
+      }
+    }
+
+  }
+
+  chain->n_years = chain->dates[n_images-1].year - year + 1;
+  if (chain->n_years < 1){
+    fprintf(stderr, "No input image from year %d or later is given.\n", year);
+    exit(FAILURE);
+  }
+
+  alloc((void**)&chain->i_break, chain->n_years, sizeof(int));
+  alloc((void**)&chain->i_end, chain->n_years + 1, sizeof(int));
+  alloc((void**)&chain->rules, chain->n_years, sizeof(reference_rule_t));
+
+  for (int k=0; k<=chain->n_years; k++){
+
+    int previous_year = year + k - 1;
+
+    for (int i=0; i<n_images; i++){
+      if (chain->dates[i].year <= previous_year) chain->i_end[k] = i + 1;
+    }
+
+    if (k == chain->n_years) break;
+
+    chain->i_break[k] = -1;
+    for (int i=0; i<n_images; i++){
+      if (chain->dates[i].year == previous_year){ chain->i_break[k] = i; break; }
+    }
+
+    if (chain->i_break[k] < 0){
+      fprintf(stderr, "No input image from year %d is given.\n", previous_year);
+      exit(FAILURE);
+    }
+
+    chain->rules[k].year = previous_year;
+    chain->rules[k].threshold = threshold;
+    chain->rules[k].confirmation_number = confirmation_number;
+    chain->rules[k].modes = modes;
+    chain->rules[k].trend = trend;
+
+  }
+
+  // pre-compute terms for harmonic fitting
+  chain->n_coef = number_of_coefficients(modes, trend);
+  alloc_2D((void***)&chain->terms, n_images, chain->n_coef, sizeof(float));
+  compute_harmonic_terms(chain->dates, n_images, modes, trend, chain->terms);
+
+  chain->n_bands[_YEAR_REFERENCE_]    = 2;
+  chain->n_bands[_YEAR_COEFFICIENTS_] = chain->n_coef;
+  chain->n_bands[_YEAR_DISTURBANCE_]  = 3;
+  chain->n_bands[_YEAR_MASK_]         = 1;
+  chain->n_bands[_YEAR_COMBINED_]     = 3;
+
+  return;
+}
+
+
+/** Free the processing chain
+--- chain:  processing chain
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_chain(chain_t *chain){
+
+  free((void*)chain->dates);
+  free((void*)chain->i_break);
+  free((void*)chain->i_end);
+  free((void*)chain->rules);
+  free_2D((void**)chain->terms, chain->n_images);
+  if (chain->path_output != NULL) free_2D((void**)chain->path_output, chain->n_years * _YEAR_OUTPUTS_);
+  if (chain->fp_output != NULL) free_2D((void**)chain->fp_output, chain->n_years);
+
+  return;
+}
+
+
+/** Is a yearly output archived?
++++ The archived products are the disturbances of each year, and the
++++ combined disturbances of the last year.
+--- chain:  processing chain
+--- k:      year
+--- o:      output
++++ Return: true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool is_archived(chain_t *chain, int k, int o){
+
+  return (o == _YEAR_DISTURBANCE_) ||
+         (o == _YEAR_COMBINED_ && k == chain->n_years - 1);
+}
+
+
+/** Count the bands of the written outputs
+--- chain:         processing chain
+--- intermediates: are the intermediates written?
++++ Return:        number of bands of all written outputs
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int written_chain_bands(chain_t *chain, bool intermediates){
+int n_bands = 0;
+
+
+  for (int k=0; k<chain->n_years; k++){
+    for (int o=0; o<_YEAR_OUTPUTS_; o++){
+      if (is_archived(chain, k, o) || intermediates) n_bands += chain->n_bands[o];
+    }
+  }
+
+  return n_bands;
+}
+
+
+/** Count the memory of the processing chain
++++ This function counts the memory of one block of the chain, i.e. the
++++ mask, the index of all images and the yearly outputs, of which only
++++ the written ones pass through the block cache. The memory for
++++ reading the images depends on the caller, and is not counted.
+--- chain:         processing chain
+--- info:          image with dimensions of the outputs
+--- intermediates: are the intermediates written?
+--- footprint:     memory use (returned)
++++ Return:        void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void chain_footprint(chain_t *chain, image_t *info, bool intermediates, footprint_t *footprint){
+
+
+  footprint->nx = info->nx;
+  footprint->ny = info->ny;
+  footprint->fixed = (size_t)chain->n_images * (chain->n_coef * sizeof(float) + sizeof(date_t));
+  footprint->block_bands = 1 + chain->n_images;
+  footprint->thread_bands = 0;
+  footprint->reader_bands = 0;
+  footprint->tile_bands = 0;
+  footprint->cache_bands = 0;
+  footprint->n_outputs = 0;
+  footprint->own_reader = false;
+
+  for (int k=0; k<chain->n_years; k++){
+    for (int o=0; o<_YEAR_OUTPUTS_; o++){
+      footprint->block_bands += chain->n_bands[o];
+      if (!is_archived(chain, k, o) && !intermediates) continue;
+      footprint->cache_bands += chain->n_bands[o];
+      footprint->n_outputs++;
+    }
+  }
+
+  return;
+}
+
+
+/** Create the yearly output files
++++ This function creates the output files, which are written block by
++++ block. The archived products are the disturbances of each year, and
++++ the combined disturbances of the last year. The intermediates, i.e.
++++ the reference period, coefficients and mask of each year, and the
++++ combined disturbances of the earlier years, are optional.
+--- chain:         processing chain (modified)
+--- info:          image with dimensions and georeference of the outputs
+--- dir_output:    output directory
+--- intermediates: write the intermediates?
+--- overwrite:     overwrite existing files, e.g. of an interrupted run?
++++ Return:        void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void create_chain_outputs(chain_t *chain, image_t *info, char *dir_output, bool intermediates, bool overwrite){
+
+
+  alloc_2D((void***)&chain->fp_output, chain->n_years, _YEAR_OUTPUTS_, sizeof(GDALDatasetH));
+  alloc_2D((void***)&chain->path_output, chain->n_years * _YEAR_OUTPUTS_, STRLEN, sizeof(char));
+
+  for (int k=0; k<chain->n_years; k++){
+    for (int o=0; o<_YEAR_OUTPUTS_; o++){
+
+      char *path = chain->path_output[k*_YEAR_OUTPUTS_ + o];
+
+      // reference period and coefficients are named after the year they end in
+      int year = (o == _YEAR_REFERENCE_ || o == _YEAR_COEFFICIENTS_) ? chain->year + k - 1 : chain->year + k;
+
+      int nchar = snprintf(path, STRLEN, "%s/%s_%04d.tif", dir_output, CHAIN_OUTPUT_NAMES[o], year);
+      if (nchar < 0 || nchar >= STRLEN){
+        fprintf(stderr, "Buffer Overflow in assembling filename\n");
+        exit(FAILURE);
+      }
+
+      if (!is_archived(chain, k, o) && !intermediates){
+        chain->fp_output[k][o] = NULL;
+        continue;
+      }
+
+      if (!overwrite && fileexist(path)){
+        fprintf(stderr, "Output file %s already exists.\n", path);
+        exit(FAILURE);
+      }
+
+      image_t meta = *info;
+      meta.nb = chain->n_bands[o];
+      meta.nodata = SHRT_MIN;
+      meta.data = NULL;
+      copy_string(meta.path, STRLEN, path);
+
+      chain->fp_output[k][o] = create_image(&meta);
+
+    }
+  }
+
+  return;
+}
+
+
+/** Allocate the yearly outputs of one block
++++ Each block has its own outputs, such that blocks can be processed
++++ concurrently.
+--- chain:  processing chain
+--- mask:   mask of the block, gives the dimensions
+--- output: yearly outputs of the block [year][output] (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void alloc_chain_outputs(chain_t *chain, image_t *mask, image_t ***output){
+
+  alloc_2D((void***)output, chain->n_years, _YEAR_OUTPUTS_, sizeof(image_t));
+
+  for (int k=0; k<chain->n_years; k++){
+    for (int o=0; o<_YEAR_OUTPUTS_; o++){
+      copy_image(mask, &(*output)[k][o], chain->n_bands[o], SHRT_MIN, chain->path_output[k*_YEAR_OUTPUTS_ + o]);
+    }
+  }
+
+  return;
+}
+
+
+/** Write and free the yearly outputs of one block
++++ The output files are not thread-safe, serialize calls from parallel
++++ regions.
+--- chain:  processing chain
+--- output: yearly outputs of the block, freed
+--- row:    first row of the block
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void write_chain_outputs(chain_t *chain, image_t **output, int row){
+
+  for (int k=0; k<chain->n_years; k++){
+    for (int o=0; o<_YEAR_OUTPUTS_; o++){
+      if (chain->fp_output[k][o] != NULL) write_image_rows(chain->fp_output[k][o], &output[k][o], row);
+      free_image(&output[k][o]);
+    }
+  }
+
+  free_2D((void**)output, chain->n_years);
+
+  return;
+}
+
+
+/** Save and free the yearly outputs of one block
++++ This function saves the written outputs of one block to the check-
++++ point instead of the output files, see restore_chain_outputs.
+--- chain:      processing chain
+--- checkpoint: checkpoint
+--- block:      block
+--- output:     yearly outputs of the block, freed
+--- stats:      counters of the block
++++ Return:     void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void save_chain_outputs(chain_t *chain, checkpoint_t *checkpoint, int block, image_t **output, int *stats){
+image_t **images = NULL;
+int n_images = 0;
+
+
+  alloc((void**)&images, chain->n_years * _YEAR_OUTPUTS_, sizeof(image_t*));
+
+  for (int k=0; k<chain->n_years; k++){
+    for (int o=0; o<_YEAR_OUTPUTS_; o++){
+      if (chain->fp_output[k][o] != NULL) images[n_images++] = &output[k][o];
+    }
+  }
+
+  save_block(checkpoint, block, images, n_images, stats);
+
+  for (int k=0; k<chain->n_years; k++){
+    for (int o=0; o<_YEAR_OUTPUTS_; o++) free_image(&output[k][o]);
+  }
+
+  free_2D((void**)output, chain->n_years);
+  free((void*)images);
+
+  return;
+}
+
+
+/** Write the yearly outputs from a checkpoint
++++ This function writes all blocks of the checkpoint to the output files,
++++ in the same order as without checkpoint, i.e. the outputs are identi-
++++ cal to those of an uninterrupted run. Serialize calls from parallel
++++ regions.
+--- chain:      processing chain
+--- checkpoint: checkpoint, all blocks are completed
+--- info:       image with dimensions of the outputs
++++ Return:     void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void restore_chain_outputs(chain_t *chain, checkpoint_t *checkpoint, image_t *info){
+image_t **images = NULL;
+image_t **output = NULL;
+int block_rows = checkpoint->header.block_rows;
+
+
+  alloc((void**)&images, chain->n_years * _YEAR_OUTPUTS_, sizeof(image_t*));
+
+  for (int block=0; block<checkpoint->n_blocks; block++){
+
+    int row = block * block_rows;
+    int n_rows = (row + block_rows > info->ny) ? info->ny - row : block_rows;
+    int n_images = 0;
+
+    image_t dims = *info;
+    dims.ny = n_rows;
+    dims.nc = info->nx * n_rows;
+    dims.data = NULL;
+
+    alloc_chain_outputs(chain, &dims, &output);
+
+    for (int k=0; k<chain->n_years; k++){
+      for (int o=0; o<_YEAR_OUTPUTS_; o++){
+        if (chain->fp_output[k][o] != NULL) images[n_images++] = &output[k][o];
+      }
+    }
+
+    load_block(checkpoint, block, images, n_images);
+    write_chain_outputs(chain, output, row);
+
+  }
+
+  free((void*)images);
+
+  return;
+}
+
+
+/** Close the yearly output files
+--- chain:  processing chain
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void close_chain_outputs(chain_t *chain){
+
+  for (int k=0; k<chain->n_years; k++){
+    for (int o=0; o<_YEAR_OUTPUTS_; o++){
+      if (chain->fp_output[k][o] != NULL) GDALClose(chain->fp_output[k][o]);
+    }
+  }
+
+  return;
+}
+
+
+/** Replay all years of one pixel
++++ This function runs the yearly chain of workflow.sh for one pixel: the
++++ reference period is extended until the previous year, disturbances are
++++ detected in the current year, and the mask and combined disturbances
++++ are updated. The outputs of one year are the inputs of the next year.
++++ The first year starts with an initial fit. The mask of each year is
++++ applied here, such that the input images can be computed with the
++++ initial mask: pixels masked later are never looked at again.
+--- chain:      processing chain
+--- output:     yearly outputs of the block (modified)
+--- mask:       initial mask
+--- input:      input images
+--- p:          pixel
+--- coef:       fitted coefficients (scratch)
+--- cov:        covariance matrix (scratch)
+--- n_fit:      number of fitted pixels, per year (modified)
+--- n_detected: number of disturbed pixels, per year (modified)
++++ Return:     void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void replay_pixel(chain_t *chain, image_t **output, image_t *mask, image_t *input, int p, gsl_vector *coef, gsl_matrix *cov, int *n_fit, int *n_detected){
+
+
+  for (int k=0; k<chain->n_years; k++){
+
+    image_t *reference_period = &output[k][_YEAR_REFERENCE_];
+    image_t *coefficients = &output[k][_YEAR_COEFFICIENTS_];
+    image_t *disturbance = &output[k][_YEAR_DISTURBANCE_];
+    image_t *next_mask = &output[k][_YEAR_MASK_];
+    image_t *combined = &output[k][_YEAR_COMBINED_];
+    image_t *this_mask = (k > 0) ? &output[k-1][_YEAR_MASK_] : mask;
+
+    bool initial = (k == 0);
+    bool valid = this_mask->data[0][p] != this_mask->nodata && this_mask->data[0][p] != 0;
+
+    // reference period until the previous year, see reference_period
+    for (int b=0; b<coefficients->nb; b++) coefficients->data[b][p] = coefficients->nodata;
+    for (int b=0; b<reference_period->nb; b++) reference_period->data[b][p] = reference_period->nodata;
+
+    if (valid){
+      int status = extend_reference_period(&chain->rules[k], input, chain->terms, chain->i_end[k], chain->i_break[k], initial,
+        initial ? NULL : &output[k-1][_YEAR_REFERENCE_], initial ? NULL : &output[k-1][_YEAR_COEFFICIENTS_],
+        NULL, p, coef, cov, reference_period, coefficients);
+      if (status == _REFERENCE_FITTED_) n_fit[k]++;
+    }
+
+    // disturbances in this year, see disturbance_detection
+    if (valid &&
+        reference_period->data[1][p] != reference_period->nodata &&
+        coefficients->data[1][p] != coefficients->nodata){
+
+      detection_t detection;
+      init_detection(&detection);
+
+      for (int i=chain->i_end[k]; i<chain->i_end[k+1]; i++){
+
+        if (input[i].data[0][p] == input[i].nodata) continue;
+
+        float y_pred = predict_harmonic_value(chain->terms[i], coefficients, p, chain->n_coef, chain->modes, chain->trend);
+        float residual = input[i].data[0][p] - y_pred;
+
+        update_detection(&detection, &chain->rule, residual, reference_period->data[1][p], chain->dates[i].ce);
+
+      }
+
+      if (detection.confirmed){
+
+        int year, doy;
+        ce2doy(detection.candidate, &doy, &year);
+
+        disturbance->data[0][p] = detection.candidate - 1970*365;
+        disturbance->data[1][p] = year;
+        disturbance->data[2][p] = doy;
+
+        n_detected[k]++;
+
+      }
+
+    }
+
+    bool disturbed = disturbance->data[0][p] > 0;
+
+    // next year's mask, see update_mask
+    next_mask->data[0][p] = this_mask->data[0][p];
+    if (valid && disturbed) next_mask->data[0][p] = 0;
+
+    // combined disturbances until this year, see combine_disturbances
+    for (int b=0; b<combined->nb; b++){
+      short value;
+      if (k > 0){
+        value = output[k-1][_YEAR_COMBINED_].data[b][p];
+      } else {
+        value = (b == 0) ? combined->nodata : 0;
+      }
+      if (disturbance->data[b][p] != disturbance->nodata &&
+          disturbance->data[b][p] > 0) value = disturbance->data[b][p];
+      combined->data[b][p] = value;
+    }
+
+  }
+
+  return;
+}
+
@@ -0,0 +1,71 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Yearly processing chain header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include <stdio.h>    // core input and output functions
+#include <stdlib.h>   // standard general utilities library
+#include <stdbool.h>  // boolean data type
+
+#include "alloc.h"
+#include "checkpoint.h"
+#include "const.h"
+#include "date.h"
+#include "detection.h"
+#include "dir.h"
+#include "harmonic.h"
+#include "image_io.h"
+#include "plan.h"
+#include "reference.h"
+#include "string.h"
+
+/** GNU Scientific Library (GSL) **/
+#include <gsl/gsl_multifit.h> // Linear Least Squares Fitting
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// yearly outputs, names as in workflow.sh
+enum { _YEAR_REFERENCE_, _YEAR_COEFFICIENTS_, _YEAR_DISTURBANCE_, _YEAR_MASK_, _YEAR_COMBINED_, _YEAR_OUTPUTS_ };
+
+typedef struct {
+  int year;                // first year to detect disturbances in
+  int n_years;             // number of years to replay
+  int n_images;            // number of input images
+  date_t *dates;           // dates of the input images
+  int *i_break;            // first image of the previous year, per year
+  int *i_end;              // end of the images up to the previous year, per year, and end of all images
+  int modes;               // number of harmonic modes
+  int trend;               // use trend coefficient?
+  int n_coef;              // number of coefficients
+  float **terms;           // harmonic terms of the input images
+  reference_rule_t *rules; // reference period rules, per year
+  detection_rule_t rule;   // detection rule
+  int n_bands[_YEAR_OUTPUTS_]; // number of bands of the yearly outputs
+  char **path_output;          // yearly output files [year * _YEAR_OUTPUTS_ + output]
+  GDALDatasetH **fp_output;    // open yearly output files, or NULL if not written
+} chain_t;
+
+void init_chain(char **path_input, int n_images, int year, int modes, int trend, int threshold, int confirmation_number, detection_rule_t *rule, chain_t *chain);
+void free_chain(chain_t *chain);
+void chain_footprint(chain_t *chain, image_t *info, bool intermediates, footprint_t *footprint);
+int written_chain_bands(chain_t *chain, bool intermediates);
+void create_chain_outputs(chain_t *chain, image_t *info, char *dir_output, bool intermediates, bool overwrite);
+void alloc_chain_outputs(chain_t *chain, image_t *mask, image_t ***output);
+void write_chain_outputs(chain_t *chain, image_t **output, int row);
+void save_chain_outputs(chain_t *chain, checkpoint_t *checkpoint, int block, image_t **output, int *stats);
+void restore_chain_outputs(chain_t *chain, checkpoint_t *checkpoint, image_t *info);
+void close_chain_outputs(chain_t *chain);
+void replay_pixel(chain_t *chain, image_t **output, image_t *mask, image_t *input, int p, gsl_vector *coef, gsl_matrix *cov, int *n_fit, int *n_detected);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
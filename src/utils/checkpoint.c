@@ -0,0 +1,314 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for checkpointing block processing, i.e.
+saving completed blocks such that an interrupted run can be resumed
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "checkpoint.h"
+
+
+static const char CHECKPOINT_MAGIC[8] = "HBCKPT1";
+
+
+void write_checkpoint_buffer(int fd, void *buffer, size_t bytes, off_t offset, char *path);
+void read_checkpoint_buffer(int fd, void *buffer, size_t bytes, off_t offset, char *path);
+
+
+/** Fingerprint of the arguments
++++ This function hashes the arguments (64-bit FNV-1a), such that a check-
++++ point is only resumed by a run with the same arguments.
+--- argc:   number of arguments
+--- argv:   arguments
+--- salt:   additional string, e.g. a tile name, or NULL
++++ Return: fingerprint
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+unsigned long long fingerprint_args(int argc, char *argv[], char *salt){
+unsigned long long hash = 14695981039346656037ULL;
+
+
+  // the terminating zeros separate the arguments
+  for (int a=1; a<=argc; a++){
+
+    char *arg = (a < argc) ? argv[a] : salt;
+    if (arg == NULL) continue;
+
+    size_t length = strlen(arg);
+    for (size_t c=0; c<=length; c++){
+      hash ^= (unsigned char)arg[c];
+      hash *= 1099511628211ULL;
+    }
+
+  }
+
+  return hash;
+}
+
+
+/** Open a checkpoint
++++ This function opens the checkpoint in the given directory, or starts a
++++ new one. The block data hold one fixed-size slot per block, the jour-
++++ nal holds a header and one record per completed block, i.e. the block
++++ number and its counters. Block data are synced to disk before the re-
++++ cord, i.e. the journal is the commit marker: a partially written re-
++++ cord, e.g. after a crash, is discarded. The journal is locked exclu-
++++ sively while the checkpoint is open. The job fails if the checkpoint
++++ was written with other arguments or dimensions.
+--- checkpoint:  checkpoint (returned)
+--- dir:         checkpoint directory
+--- fingerprint: fingerprint of the arguments
+--- nx:          number of columns
+--- ny:          number of rows
+--- block_rows:  rows per block
+--- n_bands:     bands saved per block
+--- n_stats:     counters saved per block
++++ Return:      void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void open_checkpoint(checkpoint_t *checkpoint, char *dir, unsigned long long fingerprint, int nx, int ny, int block_rows, int n_bands, int n_stats){
+checkpoint_header_t *header = &checkpoint->header;
+checkpoint_header_t previous;
+struct stat st;
+int *record = NULL;
+
+
+  copy_string(checkpoint->dir, STRLEN, dir);
+  concat_string_2(checkpoint->path_data, STRLEN, dir, "blocks.dat", "/");
+  concat_string_2(checkpoint->path_journal, STRLEN, dir, "journal", "/");
+
+  if (createdir(dir) != SUCCESS){
+    fprintf(stderr, "Unable to create checkpoint directory %s.\n", dir);
+    exit(FAILURE);
+  }
+
+  memset(header, 0, sizeof(checkpoint_header_t));
+  memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  header->fingerprint = fingerprint;
+  header->nx = nx;
+  header->ny = ny;
+  header->block_rows = block_rows;
+  header->n_bands = n_bands;
+  header->n_stats = n_stats;
+
+  checkpoint->n_blocks = (ny + block_rows - 1) / block_rows;
+  checkpoint->slot = (size_t)nx * block_rows * n_bands * sizeof(short);
+  checkpoint->record = (1 + n_stats) * sizeof(int);
+  checkpoint->n_done = 0;
+  checkpoint->resumed = false;
+
+  alloc((void**)&checkpoint->done, checkpoint->n_blocks, sizeof(bool));
+  alloc((void**)&checkpoint->stats, n_stats > 0 ? n_stats : 1, sizeof(int));
+  alloc((void**)&record, 1 + n_stats, sizeof(int));
+
+  // records are appended, concurrent writers do not overlap
+  if ((checkpoint->fd_journal = open(checkpoint->path_journal, O_RDWR | O_CREAT | O_APPEND, 0644)) < 0){
+    fprintf(stderr, "Unable to open checkpoint journal %s.\n", checkpoint->path_journal);
+    exit(FAILURE);
+  }
+
+  if (flock(checkpoint->fd_journal, LOCK_EX | LOCK_NB) != 0){
+    fprintf(stderr, "Checkpoint %s is in use by another process.\n", dir);
+    exit(FAILURE);
+  }
+
+  fstat(checkpoint->fd_journal, &st);
+
+  if (st.st_size < (off_t)sizeof(checkpoint_header_t)){
+
+    // new checkpoint, or the header was not completely written
+    if (ftruncate(checkpoint->fd_journal, 0) != 0 ||
+        write(checkpoint->fd_journal, header, sizeof(checkpoint_header_t)) != sizeof(checkpoint_header_t)){
+      fprintf(stderr, "Unable to write checkpoint journal %s.\n", checkpoint->path_journal);
+      exit(FAILURE);
+    }
+    fsync(checkpoint->fd_journal);
+
+  } else {
+
+    read_checkpoint_buffer(checkpoint->fd_journal, &previous, sizeof(checkpoint_header_t), 0, checkpoint->path_journal);
+
+    if (memcmp(&previous, header, sizeof(checkpoint_header_t)) != 0){
+      fprintf(stderr, "Checkpoint %s was written with other arguments or inputs, "
+        "remove it to start over.\n", dir);
+      exit(FAILURE);
+    }
+
+    checkpoint->resumed = true;
+
+    // completed blocks, discard a partially written record
+    off_t n_records = (st.st_size - sizeof(checkpoint_header_t)) / checkpoint->record;
+    if (ftruncate(checkpoint->fd_journal, sizeof(checkpoint_header_t) + n_records * checkpoint->record) != 0){
+      fprintf(stderr, "Unable to truncate checkpoint journal %s.\n", checkpoint->path_journal);
+      exit(FAILURE);
+    }
+
+    for (off_t r=0; r<n_records; r++){
+
+      read_checkpoint_buffer(checkpoint->fd_journal, record, checkpoint->record,
+        sizeof(checkpoint_header_t) + r * checkpoint->record, checkpoint->path_journal);
+
+      int block = record[0];
+      if (block < 0 || block >= checkpoint->n_blocks || checkpoint->done[block]) continue;
+
+      checkpoint->done[block] = true;
+      checkpoint->n_done++;
+      for (int s=0; s<n_stats; s++) checkpoint->stats[s] += record[1+s];
+
+    }
+
+  }
+
+  if ((checkpoint->fd_data = open(checkpoint->path_data, O_RDWR | O_CREAT, 0644)) < 0){
+    fprintf(stderr, "Unable to open checkpoint data %s.\n", checkpoint->path_data);
+    exit(FAILURE);
+  }
+
+  free((void*)record);
+
+  return;
+}
+
+
+/** Save a completed block
++++ This function saves the bands of the given images into the slot of the
++++ block, and commits the block to the journal. Different blocks can be
++++ saved concurrently.
+--- checkpoint: checkpoint
+--- block:      block
+--- images:     images of the block, in the same order for all blocks
+--- n_images:   number of images
+--- stats:      counters of the block, or NULL
++++ Return:     void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void save_block(checkpoint_t *checkpoint, int block, image_t **images, int n_images, int *stats){
+short *buffer = NULL;
+int *record = NULL;
+size_t n = 0;
+
+
+  alloc((void**)&buffer, checkpoint->slot / sizeof(short), sizeof(short));
+
+  for (int i=0; i<n_images; i++){
+    for (int b=0; b<images[i]->nb; b++){
+      memcpy(buffer + n, images[i]->data[b], images[i]->nc * sizeof(short));
+      n += images[i]->nc;
+    }
+  }
+
+  write_checkpoint_buffer(checkpoint->fd_data, buffer, n * sizeof(short),
+    (off_t)block * checkpoint->slot, checkpoint->path_data);
+  fdatasync(checkpoint->fd_data);
+
+  alloc((void**)&record, 1 + checkpoint->header.n_stats, sizeof(int));
+  record[0] = block;
+  for (int s=0; s<checkpoint->header.n_stats; s++) record[1+s] = (stats != NULL) ? stats[s] : 0;
+
+  if (write(checkpoint->fd_journal, record, checkpoint->record) != (ssize_t)checkpoint->record){
+    fprintf(stderr, "Unable to write checkpoint journal %s.\n", checkpoint->path_journal);
+    exit(FAILURE);
+  }
+  fsync(checkpoint->fd_journal);
+
+  free((void*)buffer);
+  free((void*)record);
+
+  return;
+}
+
+
+/** Load a completed block
+--- checkpoint: checkpoint
+--- block:      block
+--- images:     allocated images of the block, filled
+--- n_images:   number of images
++++ Return:     void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void load_block(checkpoint_t *checkpoint, int block, image_t **images, int n_images){
+short *buffer = NULL;
+size_t n = 0;
+
+
+  for (int i=0; i<n_images; i++) n += (size_t)images[i]->nb * images[i]->nc;
+
+  alloc((void**)&buffer, n, sizeof(short));
+
+  read_checkpoint_buffer(checkpoint->fd_data, buffer, n * sizeof(short),
+    (off_t)block * checkpoint->slot, checkpoint->path_data);
+
+  n = 0;
+  for (int i=0; i<n_images; i++){
+    for (int b=0; b<images[i]->nb; b++){
+      memcpy(images[i]->data[b], buffer + n, images[i]->nc * sizeof(short));
+      n += images[i]->nc;
+    }
+  }
+
+  free((void*)buffer);
+
+  return;
+}
+
+
+/** Close a checkpoint
+--- checkpoint: checkpoint
+--- remove:     remove the checkpoint, e.g. after the outputs were written
++++ Return:     void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void close_checkpoint(checkpoint_t *checkpoint, bool remove){
+
+
+  close(checkpoint->fd_data);
+
+  if (remove){
+    unlink(checkpoint->path_data);
+    unlink(checkpoint->path_journal);
+    rmdir(checkpoint->dir);
+  }
+
+  flock(checkpoint->fd_journal, LOCK_UN);
+  close(checkpoint->fd_journal);
+
+  free((void*)checkpoint->done);
+  free((void*)checkpoint->stats);
+
+  return;
+}
+
+
+/** Write buffer completely at given offset, abort on failure
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void write_checkpoint_buffer(int fd, void *buffer, size_t bytes, off_t offset, char *path){
+char *ptr = (char*)buffer;
+ssize_t written;
+
+  while (bytes > 0){
+    if ((written = pwrite(fd, ptr, bytes, offset)) <= 0){
+      fprintf(stderr, "Unable to write to %s.\n", path);
+      exit(FAILURE);
+    }
+    ptr += written;
+    offset += written;
+    bytes -= written;
+  }
+
+  return;
+}
+
+
+/** Read buffer completely at given offset, abort on failure
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void read_checkpoint_buffer(int fd, void *buffer, size_t bytes, off_t offset, char *path){
+char *ptr = (char*)buffer;
+ssize_t n_read;
+
+  while (bytes > 0){
+    if ((n_read = pread(fd, ptr, bytes, offset)) <= 0){
+      fprintf(stderr, "Unable to read from %s.\n", path);
+      exit(FAILURE);
+    }
+    ptr += n_read;
+    offset += n_read;
+    bytes -= n_read;
+  }
+
+  return;
+}
+
@@ -0,0 +1,69 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Block checkpoint header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>     // core input and output functions
+#include <stdlib.h>    // standard general utilities library
+#include <string.h>    // string handling functions
+#include <stdbool.h>   // boolean data type
+
+#include <fcntl.h>     // file control options
+#include <unistd.h>    // essential POSIX functions and constants
+#include <sys/file.h>  // advisory file locks
+#include <sys/stat.h>  // file information
+
+#include "alloc.h"
+#include "const.h"
+#include "dir.h"
+#include "image_io.h"
+#include "string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// header of the journal (40 bytes)
+typedef struct {
+  char magic[8];                  // "HBCKPT1\0"
+  unsigned long long fingerprint; // hash of the arguments
+  int nx;                         // number of columns
+  int ny;                         // number of rows
+  int block_rows;                 // rows per block
+  int n_bands;                    // bands saved per block
+  int n_stats;                    // counters saved per block
+  int reserved;                   // unused, zero
+} checkpoint_header_t;
+
+typedef struct {
+  char dir[STRLEN];          // checkpoint directory
+  char path_data[STRLEN];    // block data, one fixed-size slot per block
+  char path_journal[STRLEN]; // journal of completed blocks
+  int fd_data;               // block data
+  int fd_journal;            // journal
+  checkpoint_header_t header;
+  int n_blocks;              // number of blocks
+  size_t slot;               // bytes per block slot
+  size_t record;             // bytes per journal record
+  bool *done;                // completed blocks
+  bool resumed;              // was an existing checkpoint opened?
+  int n_done;                // number of completed blocks
+  int *stats;                // counters summed over the completed blocks
+} checkpoint_t;
+
+unsigned long long fingerprint_args(int argc, char *argv[], char *salt);
+void open_checkpoint(checkpoint_t *checkpoint, char *dir, unsigned long long fingerprint, int nx, int ny, int block_rows, int n_bands, int n_stats);
+void save_block(checkpoint_t *checkpoint, int block, image_t **images, int n_images, int *stats);
+void load_block(checkpoint_t *checkpoint, int block, image_t **images, int n_images);
+void close_checkpoint(checkpoint_t *checkpoint, bool remove);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,176 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains the per-pixel alerting logic of disturbance detection
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "detection.h"
+
+
+/** Initialize detection state
+--- detection: per-pixel detection state
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_detection(detection_t *detection){
+
+  detection->alert_number = 0;
+  detection->revert_number = 0;
+  detection->candidate = 0;
+  detection->confirmation = 0;
+  detection->n_reversed = 0;
+  detection->confirmed = false;
+
+  return;
+}
+
+
+/** Opposite detection rule
++++ This function derives the rule for detecting anomalies in the opposite
++++ direction, i.e. both thresholds change their sign.
+--- rule:     detection rule
+--- opposite: detection rule for the opposite direction (returned)
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void opposite_detection_rule(detection_rule_t *rule, detection_rule_t *opposite){
+
+  opposite->threshold_residual = -rule->threshold_residual;
+  opposite->threshold_variability = -rule->threshold_variability;
+  opposite->confirmation_number = rule->confirmation_number;
+
+  return;
+}
+
+
+/** Direction of detection rule
+--- rule:   detection rule
++++ Return: 1 for positive anomalies, -1 for negative anomalies
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int direction_of_detection_rule(detection_rule_t *rule){
+
+  return (rule->threshold_residual > 0) ? 1 : -1;
+}
+
+
+/** Update detection state with a new observation
++++ This function advances the alerting state machine of one pixel. While
++++ no disturbance is confirmed, consecutive anomalies raise alerts, and
++++ the disturbance is confirmed when the confirmation number is reached.
++++ The first anomaly of the series is the candidate date. Once confirmed,
++++ consecutive observations below half the residual threshold revert the
++++ disturbance.
+--- detection:   per-pixel detection state (modified)
+--- rule:        detection rule
+--- residual:    residual between observed and predicted value
+--- variability: variability of the pixel
+--- ce:          date of the observation (days since CE)
++++ Return:      events (_ALERT_RAISED_, _ALERT_CONFIRMED_, _ALERT_REVERTED_)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int update_detection(detection_t *detection, detection_rule_t *rule, float residual, short variability, int ce){
+int event = _ALERT_NONE_;
+
+  if (!detection->confirmed){
+
+    // not yet confirmed, check and potentially raise alert
+    if (rule->threshold_residual > 0 &&
+        residual > rule->threshold_residual &&
+        residual > (rule->threshold_variability * variability)){
+      detection->alert_number++;
+    } else if (
+        rule->threshold_residual < 0 &&
+        residual < rule->threshold_residual &&
+        residual < (rule->threshold_variability * variability)){
+      detection->alert_number++;
+    } else {
+      detection->alert_number = 0;
+    }
+
+    if (detection->alert_number == 1){
+      detection->candidate = ce;
+      event |= _ALERT_RAISED_;
+    }
+
+    if (detection->alert_number == rule->confirmation_number){
+      detection->confirmed = true;
+      detection->confirmation = ce;
+      event |= _ALERT_CONFIRMED_;
+    }
+
+  } else {
+
+    // already confirmed, check for reversion
+    if (rule->threshold_residual > 0 &&
+        residual < (rule->threshold_residual / 2)){
+      detection->revert_number++;
+    } else if (
+        rule->threshold_residual < 0 &&
+        residual > (rule->threshold_residual / 2)){
+      detection->revert_number++;
+    } else {
+      detection->revert_number = 0;
+    }
+
+    if (detection->revert_number == rule->confirmation_number){
+      // disturbance reverted
+      detection->confirmed = false;
+      detection->n_reversed++;
+      detection->alert_number = 0;
+      detection->revert_number = 0;
+      event |= _ALERT_REVERTED_;
+    }
+
+  }
+
+  return event;
+}
+
+
+/** Is there an active alert?
++++ An alert is active if anomalies are pending confirmation, or if the
++++ disturbance is confirmed.
+--- detection: per-pixel detection state
++++ Return:    true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool detection_is_active(detection_t *detection){
+
+  return detection->confirmed || detection->alert_number > 0;
+}
+
+
+/** Serialize detection state
++++ This function converts the detection state to a state vector of length
++++ _STATE_LENGTH_, e.g. to carry the state over to the next run.
+--- detection: per-pixel detection state
+--- state:     state vector (returned)
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void detection_to_state(detection_t *detection, short *state){
+
+  state[_STATE_ALERT_]        = (short)detection->alert_number;
+  state[_STATE_REVERT_]       = (short)detection->revert_number;
+  state[_STATE_CANDIDATE_]    = (short)(detection->candidate > 0 ? detection->candidate - 1970*365 : 0);
+  state[_STATE_CONFIRMATION_] = (short)(detection->confirmation > 0 ? detection->confirmation - 1970*365 : 0);
+  state[_STATE_REVERSED_]     = (short)detection->n_reversed;
+  state[_STATE_CONFIRMED_]    = (short)detection->confirmed;
+
+  return;
+}
+
+
+/** Deserialize detection state
++++ This function restores the detection state from a state vector of
++++ length _STATE_LENGTH_.
+--- state:     state vector
+--- detection: per-pixel detection state (returned)
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void state_to_detection(short *state, detection_t *detection){
+
+  detection->alert_number  = state[_STATE_ALERT_];
+  detection->revert_number = state[_STATE_REVERT_];
+  detection->candidate     = (state[_STATE_CANDIDATE_] > 0) ? state[_STATE_CANDIDATE_] + 1970*365 : 0;
+  detection->confirmation  = (state[_STATE_CONFIRMATION_] > 0) ? state[_STATE_CONFIRMATION_] + 1970*365 : 0;
+  detection->n_reversed    = state[_STATE_REVERSED_];
+  detection->confirmed     = (state[_STATE_CONFIRMED_] != 0);
+
+  return;
+}
+
@@ -0,0 +1,55 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Disturbance detection header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef DETECTION_H
+#define DETECTION_H
+
+#include <stdio.h>    // core input and output functions
+#include <stdlib.h>   // standard general utilities library
+#include <stdbool.h>  // boolean data type
+
+#include "const.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// events returned by update_detection (bit flags)
+enum { _ALERT_NONE_ = 0, _ALERT_RAISED_ = 1, _ALERT_CONFIRMED_ = 2, _ALERT_REVERTED_ = 4 };
+
+// layout of the detection state vector, dates are stored as days since 1970
+enum { _STATE_ALERT_, _STATE_REVERT_, _STATE_CANDIDATE_, _STATE_CONFIRMATION_, 
+       _STATE_REVERSED_, _STATE_CONFIRMED_, _STATE_LENGTH_ };
+
+typedef struct {
+  float threshold_residual;    // residual threshold, the sign gives the direction
+  float threshold_variability; // variability multiplier, same sign as residual threshold
+  int confirmation_number;     // consecutive observations to confirm or revert
+} detection_rule_t;
+
+typedef struct {
+  int alert_number;  // consecutive anomalies
+  int revert_number; // consecutive normal observations after confirmation
+  int candidate;     // date of the first anomaly (days since CE)
+  int confirmation;  // date of the confirmation (days since CE)
+  int n_reversed;    // number of reversed alerts
+  bool confirmed;    // is the disturbance confirmed?
+} detection_t;
+
+void init_detection(detection_t *detection);
+void opposite_detection_rule(detection_rule_t *rule, detection_rule_t *opposite);
+int direction_of_detection_rule(detection_rule_t *rule);
+int update_detection(detection_t *detection, detection_rule_t *rule, float residual, short variability, int ce);
+bool detection_is_active(detection_t *detection);
+void detection_to_state(detection_t *detection, short *state);
+void state_to_detection(short *state, detection_t *detection);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
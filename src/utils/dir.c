@@ -95,6 +95,76 @@ int k = 0;
 }
 
 
+/** This function lists the files in the given directory, which contain
++++ the given pattern, in alphabetical order. 
+--- dir:      directory (returned), free with free_dir
+--- dir_path: directory
+--- pattern:  pattern
+--- filter:   an additional filter, e.g. for file extensions, 
+              NULL to disable filtering
++++ Return:   SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int read_dir(dir_t *dir, char *dir_path, char *pattern, char *filter){
+int nchar;
+
+
+  copy_string(dir->name, STRLEN, dir_path);
+  dir->files = NULL;
+  dir->paths = NULL;
+  dir->n = 0;
+
+  if ((dir->N = scandir(dir_path, &dir->LIST, 0, alphasort)) < 0){
+    perror("Couldn't open the directory");
+    dir->LIST = NULL;
+    dir->N = 0;
+    return FAILURE;
+  }
+
+  if (dir->N == 0) return SUCCESS;
+
+  alloc_2D((void***)&dir->files, dir->N, STRLEN, sizeof(char));
+  alloc_2D((void***)&dir->paths, dir->N, STRLEN, sizeof(char));
+
+  for (int i=0; i<dir->N; i++){
+
+    if (!strstr(dir->LIST[i]->d_name, pattern)) continue;
+    if (filter != NULL && !strstr(dir->LIST[i]->d_name, filter)) continue;
+
+    copy_string(dir->files[dir->n], STRLEN, dir->LIST[i]->d_name);
+
+    nchar = snprintf(dir->paths[dir->n], STRLEN, "%s/%s", dir_path, dir->LIST[i]->d_name);
+    if (nchar < 0 || nchar >= STRLEN){ 
+      printf("Buffer Overflow in assembling filename\n"); return FAILURE;}
+
+    dir->n++;
+
+  }
+
+  return SUCCESS;
+}
+
+
+/** This function frees a directory listing.
+--- dir:    directory
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_dir(dir_t *dir){
+
+  for (int i=0; i<dir->N; i++) free((void*)dir->LIST[i]);
+  if (dir->LIST != NULL) free((void*)dir->LIST);
+  if (dir->files != NULL) free_2D((void**)dir->files, dir->N);
+  if (dir->paths != NULL) free_2D((void**)dir->paths, dir->N);
+
+  dir->LIST = NULL;
+  dir->files = NULL;
+  dir->paths = NULL;
+  dir->N = 0;
+  dir->n = 0;
+
+  return;
+}
+
+
 /** This function creates a directory. The function will return SUCCESS if
 +++ the directory was successfully created or if it was already existent.
 --- dir_path: directory
@@ -16,6 +16,7 @@ Directory/file support header
 #include <unistd.h>   // essential POSIX functions and constants
 #include <errno.h>    // error numbers
 
+#include "alloc.h"
 #include "const.h"
 #include "string.h"
 
@@ -36,6 +37,8 @@ typedef struct {
 bool fileexist(char *fname);
 int findfile(char *dir_path, char *pattern, char *filter, char fname[], int size);
 int countfile(char *dir_path, char *pattern);
+int read_dir(dir_t *dir, char *dir_path, char *pattern, char *filter);
+void free_dir(dir_t *dir);
 int createdir(char *dir_path);
 void extension(char* path, char extension[], int size);
 void extension2(char* path, char extension[], int size);
@@ -0,0 +1,157 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for handling sparse disturbance event lists
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "event.h"
+
+
+int compare_events(const void *a, const void *b);
+
+
+/** Initialize event list
++++ This function initializes an empty event list. Memory is allocated on
++++ the first insertion.
+--- list:   event list
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_eventlist(eventlist_t *list){
+
+  list->event = NULL;
+  list->n = 0;
+  list->size = 0;
+
+  return;
+}
+
+
+/** Add event to list
++++ This function appends an event to the list. The list grows by doubling
++++ its size, such that insertion is amortized constant time. Lists are
++++ not thread-safe, use one list per thread.
+--- list:   event list
+--- event:  event to append
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void add_event(eventlist_t *list, event_t *event){
+
+  if (list->n == list->size){
+    int size = (list->size > 0) ? list->size * 2 : 1024;
+    if (list->event == NULL){
+      alloc((void**)&list->event, size, sizeof(event_t));
+    } else {
+      re_alloc((void**)&list->event, list->size, size, sizeof(event_t));
+    }
+    list->size = size;
+  }
+
+  list->event[list->n++] = *event;
+
+  return;
+}
+
+
+/** Merge event lists
++++ This function merges several event lists, e.g. the per-thread lists of
++++ a parallel region, into one list, which is sorted by pixel id and di-
++++ rection. The input lists are freed.
+--- lists:   event lists
+--- n_lists: number of event lists
+--- merged:  merged event list (returned)
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void merge_eventlists(eventlist_t *lists, int n_lists, eventlist_t *merged){
+int n = 0;
+
+  init_eventlist(merged);
+
+  for (int l=0; l<n_lists; l++) n += lists[l].n;
+  if (n == 0) return;
+
+  alloc((void**)&merged->event, n, sizeof(event_t));
+  merged->size = n;
+
+  for (int l=0; l<n_lists; l++){
+    if (lists[l].n > 0){
+      memcpy(merged->event + merged->n, lists[l].event, lists[l].n * sizeof(event_t));
+    }
+    merged->n += lists[l].n;
+    free_eventlist(&lists[l]);
+  }
+
+  qsort(merged->event, merged->n, sizeof(event_t), compare_events);
+
+  return;
+}
+
+
+/** Write event list
++++ This function writes the event list to disk. If the file extension is
++++ .csv, a CSV table with header is written. Otherwise, the events are
++++ written as binary records of 9 native 32bit integers in the order of
++++ the event_t struct (pixel, x, y, direction, candidate, year, doy, con-
++++ firmation, n_reversed), without header.
+--- list:   event list
+--- path:   output file
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void write_eventlist(eventlist_t *list, char *path){
+FILE *fp = NULL;
+char ext[STRLEN];
+
+  if ((fp = fopen(path, "wb")) == NULL){
+    fprintf(stderr, "Unable to open event file %s.\n", path);
+    exit(FAILURE);
+  }
+
+  extension2(path, ext, STRLEN);
+
+  if (strcmp(ext, ".csv") == 0 || strcmp(ext, ".CSV") == 0){
+
+    fprintf(fp, "pixel,x,y,direction,candidate,year,doy,confirmation,n_reversed\n");
+    for (int e=0; e<list->n; e++){
+      fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+        list->event[e].pixel, list->event[e].x, list->event[e].y, list->event[e].direction,
+        list->event[e].candidate, list->event[e].year, list->event[e].doy,
+        list->event[e].confirmation, list->event[e].n_reversed);
+    }
+
+  } else if (list->n > 0){
+
+    if (fwrite(list->event, sizeof(event_t), list->n, fp) != (size_t)list->n){
+      fprintf(stderr, "Unable to write events to %s.\n", path);
+      exit(FAILURE);
+    }
+
+  }
+
+  fclose(fp);
+
+  return;
+}
+
+
+/** Free event list
+--- list:   event list
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_eventlist(eventlist_t *list){
+
+  if (list->event != NULL) free((void*)list->event);
+  init_eventlist(list);
+
+  return;
+}
+
+
+/** Compare events by pixel id, then direction (qsort callback)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int compare_events(const void *a, const void *b){
+const event_t *ea = (const event_t*)a;
+const event_t *eb = (const event_t*)b;
+
+  if (ea->pixel != eb->pixel) return (ea->pixel > eb->pixel) - (ea->pixel < eb->pixel);
+
+  return (ea->direction < eb->direction) - (ea->direction > eb->direction);
+}
+
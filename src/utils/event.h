@@ -0,0 +1,51 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Disturbance event list header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdio.h>    // core input and output functions
+#include <stdlib.h>   // standard general utilities library
+#include <string.h>   // string handling functions
+
+#include "alloc.h"
+#include "const.h"
+#include "dir.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// one record of the event list, written as is to binary files
+typedef struct {
+  int pixel;        // pixel id (row-major)
+  int x, y;         // pixel coordinates
+  int direction;    // direction of the anomaly (1: positive, -1: negative)
+  int candidate;    // candidate date (days since 1970)
+  int year;         // candidate year
+  int doy;          // candidate day-of-year
+  int confirmation; // confirmation date (days since 1970)
+  int n_reversed;   // number of reversed alerts before the final confirmation
+} event_t;
+
+typedef struct {
+  event_t *event; // array of events
+  int n;          // number of events
+  int size;       // number of allocated events
+} eventlist_t;
+
+void init_eventlist(eventlist_t *list);
+void add_event(eventlist_t *list, event_t *event);
+void merge_eventlists(eventlist_t *lists, int n_lists, eventlist_t *merged);
+void write_eventlist(eventlist_t *list, char *path);
+void free_eventlist(eventlist_t *list);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
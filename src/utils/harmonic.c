@@ -92,6 +92,145 @@ float predict_harmonic_value(float *x, image_t *coefficients, int pixel, int n_c
 }
 
 
+/** Initialize baseline table
++++ The harmonic model only depends on the date. Without trend, it is even
++++ periodic with the year, such that all images acquired on the same DOY
++++ share the same predicted value. This function sets up a table with one
++++ row per distinct DOY (or per distinct date if a trend is used). Use one
++++ table per thread.
+--- dates:    dates of the images
+--- n_dates:  number of images
+--- trend:    is a trend used?
+--- baseline: baseline table (returned)
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_baseline(date_t *dates, int n_dates, int trend, baseline_t *baseline){
+
+  if (try_init_baseline(dates, n_dates, trend, baseline) != SUCCESS){
+    printf("unable to allocate memory!\n"); exit(1);
+  }
+
+  return;
+}
+
+
+/** Try to initialize baseline table
++++ Like init_baseline, but the failure is returned instead of exiting.
+--- dates:    dates of the images
+--- n_dates:  number of images
+--- trend:    is a trend used?
+--- baseline: baseline table (returned)
++++ Return:   SUCCESS, or FAILURE if out of memory
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int try_init_baseline(date_t *dates, int n_dates, int trend, baseline_t *baseline){
+
+  baseline->n = 0;
+  baseline->sum = NULL;
+  baseline->value = NULL;
+
+  if (try_alloc((void**)&baseline->row, n_dates, sizeof(int)) != SUCCESS ||
+      try_alloc((void**)&baseline->image, n_dates, sizeof(int)) != SUCCESS){
+    free((void*)baseline->row);
+    return FAILURE;
+  }
+
+  for (int i=0; i<n_dates; i++){
+
+    int r;
+    for (r=0; r<baseline->n; r++){
+      int k = baseline->image[r];
+      if (!trend && dates[k].doy == dates[i].doy) break;
+      if ( trend && dates[k].ce  == dates[i].ce)  break;
+    }
+
+    if (r == baseline->n) baseline->image[baseline->n++] = i;
+    baseline->row[i] = r;
+
+  }
+
+  baseline->p0 = -1;
+  baseline->np = 0;
+
+  if (try_alloc((void**)&baseline->sum, _BASELINE_BLOCK_, sizeof(float)) != SUCCESS ||
+      try_alloc_2D((void***)&baseline->value, baseline->n, _BASELINE_BLOCK_, sizeof(short)) != SUCCESS){
+    free((void*)baseline->row);
+    free((void*)baseline->image);
+    free((void*)baseline->sum);
+    return FAILURE;
+  }
+
+  return SUCCESS;
+}
+
+
+/** Predict baseline table for the block of a pixel
++++ This function predicts the values of all table rows for the block of 
++++ _BASELINE_BLOCK_ pixels that contains the given pixel. Nothing is done
++++ if the block was already predicted. The prediction is vectorized over 
++++ the pixels of the block and rounded to int16, such that the residual
++++ of an observation reduces to a subtraction.
+--- terms:        pre-computed harmonic terms of the images
+--- coefficients: coefficient image
+--- n_coef:       number of coefficients
+--- p:            pixel
+--- baseline:     baseline table (modified)
++++ Return:       void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void predict_baseline(float **terms, image_t *coefficients, int n_coef, int p, baseline_t *baseline){
+int p0 = p - (p % _BASELINE_BLOCK_);
+int np = coefficients->nc - p0;
+float *sum = baseline->sum;
+
+  if (p0 == baseline->p0) return;
+  if (np > _BASELINE_BLOCK_) np = _BASELINE_BLOCK_;
+
+  for (int r=0; r<baseline->n; r++){
+
+    float *x = terms[baseline->image[r]];
+
+    #pragma omp simd
+    for (int k=0; k<np; k++) sum[k] = 0;
+
+    for (int c=0; c<n_coef; c++){
+      float x_scaled = x[c] / _COEF_SCALE_;
+      short *coef = coefficients->data[c] + p0;
+      #pragma omp simd
+      for (int k=0; k<np; k++) sum[k] += x_scaled * coef[k];
+    }
+
+    short *value = baseline->value[r];
+    #pragma omp simd
+    for (int k=0; k<np; k++){
+      float v = sum[k] + (sum[k] >= 0 ? 0.5f : -0.5f);
+      v = (v > SHRT_MAX) ? SHRT_MAX : v;
+      v = (v < SHRT_MIN) ? SHRT_MIN : v;
+      value[k] = (short)v;
+    }
+
+  }
+
+  baseline->p0 = p0;
+  baseline->np = np;
+
+  return;
+}
+
+
+/** Free baseline table
+--- baseline: baseline table
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_baseline(baseline_t *baseline){
+
+  free((void*)baseline->row);
+  free((void*)baseline->image);
+  free((void*)baseline->sum);
+  free_2D((void**)baseline->value, baseline->n);
+
+  return;
+}
+
+
 double irls_fit(const gsl_matrix *X, const gsl_vector *y, gsl_vector *c, gsl_matrix *cov){
 
   gsl_multifit_robust_workspace *work = 
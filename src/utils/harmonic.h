@@ -24,9 +24,26 @@ extern "C" {
 
 #define _COEF_SCALE_ 10.0f
 
+// number of pixels per baseline table block
+#define _BASELINE_BLOCK_ 4096
+
+// precomputed baseline (predicted values) for a block of pixels
+typedef struct {
+  int n;          // number of table rows, i.e. distinct DOYs (distinct dates with trend)
+  int *row;       // table row of each image
+  int *image;     // representative image of each table row
+  int p0, np;     // first pixel and number of pixels of the current block
+  float *sum;     // scratch buffer for prediction
+  short **value;  // predicted values [row][pixel in block]
+} baseline_t;
+
 int number_of_coefficients(int modes, int trend);
 void compute_harmonic_terms(date_t *dates, int n_dates, int modes, int trend, float **terms);
 float predict_harmonic_value(float *x, image_t *coefficients, int pixel, int n_coef, int modes, int trend);
+void init_baseline(date_t *dates, int n_dates, int trend, baseline_t *baseline);
+int try_init_baseline(date_t *dates, int n_dates, int trend, baseline_t *baseline);
+void predict_baseline(float **terms, image_t *coefficients, int n_coef, int p, baseline_t *baseline);
+void free_baseline(baseline_t *baseline);
 double irls_fit(const gsl_matrix *X, const gsl_vector *y, gsl_vector *c, gsl_matrix *cov);
 
 #ifdef __cplusplus
@@ -6,8 +6,155 @@ This file contains functions for I/O-ing images
 #include "image_io.h"
 
 
+// whole image kept in memory, see init_image_cache
+typedef struct {
+  char path[STRLEN];    // absolute path
+  image_t image;        // all bands, all rows
+  short *nodata;        // nodata value per band
+  long long size;       // file size when the image was read
+  long long mtime;      // modification time when the image was read
+  long mtime_nsec;
+  size_t bytes;         // memory of the pixels
+  unsigned long used;   // last use
+} cached_image_t;
+
+typedef struct {
+  int n;                // number of cached images
+  int size;             // allocated entries
+  cached_image_t *entry;
+  size_t bytes;         // memory of all cached images
+  size_t budget;        // memory budget, 0 if the cache is disabled
+  unsigned long clock;  // use counter
+} image_cache_t;
+
+// the cache is filled by a resident process, and inherited by the
+// processes it forks, which look images up but never modify the cache
+static image_cache_t cache = { 0, 0, NULL, 0, 0, 0 };
+
+// file descriptor that image accesses are reported to, or -1
+static int fd_access = -1;
+
+
+int read_rows(char *path, bandlist_t *bands, int row, int n_rows, image_t *image, short **nodata);
+int add_cached_image(cached_image_t *cached);
+int write_pipe(int fd, const void *buffer, size_t size);
+int read_open_rows(GDALDatasetH fp_dataset, char *path, bandlist_t *bands, int row, int n_rows, image_t *image, short **nodata);
+int copy_cached_rows(cached_image_t *cached, bandlist_t *bands, int row, int n_rows, image_t *image);
+cached_image_t *find_cached_image(char *path);
+void remove_cached_image(int i);
+int stat_image(char *path, long long *size, long long *mtime, long *mtime_nsec);
+void absolute_path(char *path, char absolute[], size_t size);
+void report_access(char type, char *path);
+
+
 void read_image(char *path, bandlist_t *bands, image_t *image){
 
+  read_image_rows(path, bands, 0, -1, image);
+
+  return;
+}
+
+
+/** Read a window of rows
++++ This function reads rows row ... row+n_rows-1 of an image. The image 
++++ holds the window only, i.e. ny is the number of rows, and the geo-
++++ transform refers to the first row of the window.
+--- path:   image file
+--- bands:  bands to read, or NULL for all bands
+--- row:    first row of the window
+--- n_rows: number of rows, or -1 for all remaining rows
+--- image:  image (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void read_image_rows(char *path, bandlist_t *bands, int row, int n_rows, image_t *image){
+cached_image_t *cached = NULL;
+
+
+  // reflectance is read band by band, only whole images are worth caching
+  if (bands == NULL) report_access('r', path);
+
+  if ((cached = find_cached_image(path)) != NULL){
+    copy_string(image->path, STRLEN, path);
+    if (copy_cached_rows(cached, bands, row, n_rows, image) != SUCCESS) exit(FAILURE);
+    return;
+  }
+
+  if (read_rows(path, bands, row, n_rows, image, NULL) != SUCCESS) exit(FAILURE);
+
+  return;
+}
+
+
+/** Open an image for reading
++++ This function opens an image once for many reads of rows, see
++++ read_dataset_rows. Images in the image cache are not opened, the
++++ reads are served from the cache instead.
+--- path:   image file
++++ Return: open dataset, close with GDALClose, or NULL if cached
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+GDALDatasetH open_image(char *path){
+GDALDatasetH fp_dataset = NULL;
+
+
+  report_access('r', path);
+
+  if (find_cached_image(path) != NULL) return NULL;
+
+  if ((fp_dataset = GDALOpen(path, GA_ReadOnly)) == NULL){ 
+    fprintf(stderr, "could not open %s\n", path); exit(FAILURE);}
+
+  return fp_dataset;
+}
+
+
+/** Read a window of rows from an open image
++++ This function is read_image_rows on an image opened with open_image.
++++ The dataset is not thread-safe, use one per thread.
+--- fp_dataset: open dataset, or NULL if cached, see open_image
+--- path:       image file
+--- bands:      bands to read, or NULL for all bands
+--- row:        first row of the window
+--- n_rows:     number of rows, or -1 for all remaining rows
+--- image:      image (returned)
++++ Return:     void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void read_dataset_rows(GDALDatasetH fp_dataset, char *path, bandlist_t *bands, int row, int n_rows, image_t *image){
+cached_image_t *cached = NULL;
+
+
+  if (fp_dataset == NULL){
+    if ((cached = find_cached_image(path)) == NULL){
+      fprintf(stderr, "%s is neither open nor cached\n", path); exit(FAILURE);}
+    copy_string(image->path, STRLEN, path);
+    if (copy_cached_rows(cached, bands, row, n_rows, image) != SUCCESS) exit(FAILURE);
+    return;
+  }
+
+  if (read_open_rows(fp_dataset, path, bands, row, n_rows, image, NULL) != SUCCESS) exit(FAILURE);
+
+  return;
+}
+
+
+/** Read image metadata
++++ This function reads dimensions, georeference and nodata value of an
++++ image without reading any pixels, e.g. to check that images match
++++ before reading them block by block. No memory is allocated.
+--- path:   image file
+--- image:  image (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void read_image_info(char *path, image_t *image){
+cached_image_t *cached = NULL;
+
+
+  if ((cached = find_cached_image(path)) != NULL){
+    *image = cached->image;
+    copy_string(image->path, STRLEN, path);
+    image->data = NULL;
+    image->nodata = cached->nodata[0];
+    return;
+  }
 
   GDALDatasetH  fp_dataset;
   
@@ -21,41 +168,14 @@ void read_image(char *path, bandlist_t *bands, image_t *image){
   image->nx = GDALGetRasterXSize(fp_dataset);
   image->ny = GDALGetRasterYSize(fp_dataset);
   image->nc = image->nx*image->ny;
-
   image->nb = GDALGetRasterCount(fp_dataset);
+  image->data = NULL;
 
-  if (bands != NULL){
-    if (bands->n < 1){
-      fprintf(stderr, "no bands specified for %s\n", path); exit(FAILURE);}
-    for (int b=0; b<bands->n; b++){
-      if (bands->number[b] < 1 || bands->number[b] > image->nb){
-        fprintf(stderr, "band number %d out of range for %s\n", bands->number[b], path); exit(FAILURE);}
-    }
-    image->nb = bands->n;
-  } 
-
-  alloc_2D((void***)&image->data, image->nb, image->nc, sizeof(short));
-
-  for (int b=0; b<image->nb; b++){
-
-    GDALRasterBandH band;
-    if (bands != NULL){
-      band = GDALGetRasterBand(fp_dataset, bands->number[b]);
-    } else {
-      band = GDALGetRasterBand(fp_dataset, b+1);
-    }
-
-    int has_nodata;
-    image->nodata = (short)GDALGetRasterNoDataValue(band, &has_nodata);
-    if (!has_nodata){
-      fprintf(stderr, "%s has no nodata value.\n", path); 
-      exit(FAILURE);
-    }
-
-    if (GDALRasterIO(band, GF_Read, 0, 0, 
-      image->nx, image->ny, image->data[b], 
-      image->nx, image->ny, GDT_Int16, 0, 0) == CE_Failure){
-      printf("could not read band %d from %s.\n", b+1, path); exit(FAILURE);}
+  int has_nodata;
+  image->nodata = (short)GDALGetRasterNoDataValue(GDALGetRasterBand(fp_dataset, 1), &has_nodata);
+  if (!has_nodata){
+    fprintf(stderr, "%s has no nodata value.\n", path); 
+    exit(FAILURE);
   }
 
   GDALClose(fp_dataset);
@@ -81,45 +201,84 @@ void copy_image(image_t *from, image_t *to, int nbands, short nodata, char *path
 
 void write_image(image_t *image){
 
+  GDALDatasetH fp_dataset = create_image(image);
+
+  write_image_rows(fp_dataset, image, 0);
+
+  GDALClose(fp_dataset);
+
+  return;
+}
+
+
+/** Create an image file
++++ This function creates a GeoTiff with the dimensions, georeference and
++++ nodata value of the image, but does not write any pixels. The file is
++++ left open for writing, e.g. block by block with write_image_rows.
+--- image:  image, the data are not used
++++ Return: open dataset, close with GDALClose
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+GDALDatasetH create_image(image_t *image){
+
+
+  report_access('w', image->path);
 
   GDALDriverH driver = NULL;
   if ((driver = GDALGetDriverByName("GTiff")) == NULL){
     printf("%s driver not found\n", "GTiff"); exit(FAILURE);}
     
+  char tile_size[STRLEN];
+  snprintf(tile_size, STRLEN, "%d", _TILE_SIZE_);
+
   char **options = NULL;
   options = CSLSetNameValue(options, "COMPRESS", "ZSTD");
   options = CSLSetNameValue(options, "PREDICTOR", "2");
   options = CSLSetNameValue(options, "INTERLEAVE", "BAND");
   options = CSLSetNameValue(options, "BIGTIFF", "YES");
   options = CSLSetNameValue(options, "TILED", "YES");
-  options = CSLSetNameValue(options, "BLOCKXSIZE", "256");
-  options = CSLSetNameValue(options, "BLOCKYSIZE", "256");
+  options = CSLSetNameValue(options, "BLOCKXSIZE", tile_size);
+  options = CSLSetNameValue(options, "BLOCKYSIZE", tile_size);
   
   GDALDatasetH fp_dataset = NULL;
   if ((fp_dataset = GDALCreate(driver, image->path, image->nx, image->ny, image->nb, GDT_Int16, options)) == NULL){
     printf("Error creating file %s.\n", image->path); exit(FAILURE);}
 
+  for (int b=0; b<image->nb; b++){
+    GDALSetRasterNoDataValue(GDALGetRasterBand(fp_dataset, b+1), image->nodata);
+  }
+
+  GDALSetGeoTransform(fp_dataset, image->geotran);
+  GDALSetProjection(fp_dataset,   image->proj);
+
+  if (options != NULL) CSLDestroy(options);   
+
+  return fp_dataset;
+}
+
+
+/** Write a window of rows
++++ This function writes all bands of an image that holds a window of rows
++++ to an open dataset. The dataset is not thread-safe, serialize calls
++++ from parallel regions.
+--- fp_dataset: open dataset, see create_image
+--- image:      image with the rows to write
+--- row:        first row of the window in the dataset
++++ Return:     void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void write_image_rows(GDALDatasetH fp_dataset, image_t *image, int row){
+
   for (int b=0; b<image->nb; b++){
 
     GDALRasterBandH band = GDALGetRasterBand(fp_dataset, b+1);
-    if (GDALRasterIO(band, GF_Write, 0, 0, 
+    if (GDALRasterIO(band, GF_Write, 0, row, 
       image->nx, image->ny, image->data[b], 
       image->nx, image->ny, GDT_Int16, 0, 0) == CE_Failure){
       printf("Unable to write band %d to %s.\n", b+1, image->path); 
       exit(FAILURE);
     }
 
-    GDALSetRasterNoDataValue(band, image->nodata);
-
   }
 
-  GDALSetGeoTransform(fp_dataset, image->geotran);
-  GDALSetProjection(fp_dataset,   image->proj);
-
-  GDALClose(fp_dataset);
-
-  if (options != NULL) CSLDestroy(options);   
-
   return;
 }
 
@@ -168,3 +327,592 @@ bool equal = true;
 }
 
 
+
+/** Enable the image cache
++++ A resident process, e.g. the server, keeps whole images in memory
++++ that are read again and again, e.g. masks and coefficients. The pro-
++++ cesses it forks find them in the cache instead of reading the files.
++++ Cached images are only used while the file has not changed.
+--- budget: memory budget in bytes
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_image_cache(size_t budget){
+
+  cache.budget = budget;
+
+  return;
+}
+
+
+/** Start loading an image into the cache
++++ Reading a whole image takes a while, which a resident process, e.g.
++++ the server, should not wait for. The image is therefore read by a
++++ forked process with send_image, and received piece by piece with
++++ receive_image. This function checks whether the image needs to be
++++ read: a cached image that is up to date is marked as used instead.
+--- path:   image file
+--- load:   load (returned)
++++ Return: true if the image needs to be read, false otherwise
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool start_image_load(char *path, image_load_t *load){
+
+
+  memset(load, 0, sizeof(image_load_t));
+  load->fd = -1;
+  load->size = -1;
+
+  if (cache.budget == 0) return false;
+
+  absolute_path(path, load->path, STRLEN);
+
+  stat_image(load->path, &load->size, &load->mtime, &load->mtime_nsec);
+
+  for (int i=0; i<cache.n; i++){
+    if (strcmp(cache.entry[i].path, load->path) != 0) continue;
+    if (cache.entry[i].size == load->size && cache.entry[i].mtime == load->mtime &&
+        cache.entry[i].mtime_nsec == load->mtime_nsec){
+      cache.entry[i].used = ++cache.clock;
+      return false;
+    }
+    remove_cached_image(i);
+    break;
+  }
+
+  if (load->size < 0) return false;
+
+  return true;
+}
+
+
+/** Send an image for the cache, in the forked process
++++ This function reads the whole image, and writes its header, the
++++ nodata values and the pixels of all bands to a pipe.
+--- load:   load, see start_image_load
+--- fd:     pipe to write to
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int send_image(image_load_t *load, int fd){
+image_t image;
+short *nodata = NULL;
+int status = SUCCESS;
+
+
+  if (read_rows(load->path, NULL, 0, -1, &image, &nodata) != SUCCESS) return FAILURE;
+
+  image_load_header_t header;
+  memset(&header, 0, sizeof(header));
+  copy_string(header.proj, STRLEN, image.proj);
+  for (int i=0; i<6; i++) header.geotran[i] = image.geotran[i];
+  header.nx = image.nx;
+  header.ny = image.ny;
+  header.nb = image.nb;
+
+  if (write_pipe(fd, &header, sizeof(header)) != SUCCESS ||
+      write_pipe(fd, nodata, image.nb * sizeof(short)) != SUCCESS) status = FAILURE;
+
+  for (int b=0; b<image.nb && status == SUCCESS; b++){
+    status = write_pipe(fd, image.data[b], (size_t)image.nc * sizeof(short));
+  }
+
+  free_image(&image);
+  free((void*)nodata);
+
+  return status;
+}
+
+
+/** Receive an image for the cache
++++ This function reads what arrived on the pipe of a load, without
++++ blocking, see start_image_load. Once the pipe is closed, the image
++++ is added to the cache if it arrived completely and the file did not
++++ change meanwhile, and the pipe is closed.
+--- load:   load (modified), load->fd is the non-blocking pipe
++++ Return: true while more is expected, false once the load finished
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool receive_image(image_load_t *load){
+size_t n_header = sizeof(image_load_header_t);
+size_t n_nodata = load->header.nb * sizeof(short);
+size_t n_band = (size_t)load->header.nx * load->header.ny * sizeof(short);
+size_t total = n_header + n_nodata + n_band * load->header.nb;
+
+
+  while (true){
+
+    char *target;
+    size_t wanted;
+
+    // header, nodata values, then the bands one after another
+    if (load->received < n_header){
+      target = (char*)&load->header + load->received;
+      wanted = n_header - load->received;
+    } else if (load->received < n_header + n_nodata){
+      target = (char*)load->nodata + (load->received - n_header);
+      wanted = n_header + n_nodata - load->received;
+    } else if (load->received < total){
+      size_t offset = load->received - n_header - n_nodata;
+      target = (char*)load->image.data[offset / n_band] + offset % n_band;
+      wanted = n_band - offset % n_band;
+    } else {
+      target = NULL;
+      wanted = 0;
+    }
+
+    char byte;
+    ssize_t n_read = read(load->fd, (wanted > 0) ? target : &byte, (wanted > 0) ? wanted : 1);
+
+    if (n_read < 0 && errno == EINTR) continue;
+    if (n_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+
+    // closed, or failed
+    if (n_read <= 0) break;
+
+    // more than the image
+    if (wanted == 0){
+      load->received += n_read;
+      break;
+    }
+
+    load->received += n_read;
+
+    // header complete, allocate the image
+    if (load->received == n_header && load->nodata == NULL){
+      image_load_header_t *h = &load->header;
+      if (h->nx < 1 || h->ny < 1 || h->nb < 1 || 
+          (size_t)h->nx * h->ny * h->nb * sizeof(short) > cache.budget) break;
+      n_nodata = h->nb * sizeof(short);
+      n_band = (size_t)h->nx * h->ny * sizeof(short);
+      total = n_header + n_nodata + n_band * h->nb;
+      alloc((void**)&load->nodata, h->nb, sizeof(short));
+      alloc_2D((void***)&load->image.data, h->nb, h->nx * h->ny, sizeof(short));
+      load->image.nb = h->nb;
+    }
+
+  }
+
+  close(load->fd);
+  load->fd = -1;
+
+  if (load->received == total && load->received > n_header){
+
+    cached_image_t cached;
+    image_load_header_t *h = &load->header;
+
+    copy_string(cached.path, STRLEN, load->path);
+    copy_string(cached.image.path, STRLEN, load->path);
+    copy_string(cached.image.proj, STRLEN, h->proj);
+    for (int i=0; i<6; i++) cached.image.geotran[i] = h->geotran[i];
+    cached.image.nx = h->nx;
+    cached.image.ny = h->ny;
+    cached.image.nc = h->nx * h->ny;
+    cached.image.nb = h->nb;
+    cached.image.data = load->image.data;
+    cached.image.nodata = load->nodata[0];
+    cached.nodata = load->nodata;
+    cached.size = load->size;
+    cached.mtime = load->mtime;
+    cached.mtime_nsec = load->mtime_nsec;
+
+    load->image.data = NULL;
+    load->nodata = NULL;
+
+    add_cached_image(&cached);
+
+  } else {
+    if (load->image.data != NULL) free_image(&load->image);
+    if (load->nodata != NULL) free((void*)load->nodata);
+    load->nodata = NULL;
+  }
+
+  return false;
+}
+
+
+/** Remove an image from the cache
++++ This function drops an image, e.g. after its file was overwritten.
+--- path:   image file
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void uncache_image(char *path){
+char absolute[STRLEN];
+
+
+  absolute_path(path, absolute, STRLEN);
+
+  for (int i=0; i<cache.n; i++){
+    if (strcmp(cache.entry[i].path, absolute) != 0) continue;
+    remove_cached_image(i);
+    break;
+  }
+
+  return;
+}
+
+
+/** Is an image in the cache?
+--- path:   image file
++++ Return: true if an up-to-date copy of the image is cached
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool image_cached(char *path){
+
+  return find_cached_image(path) != NULL;
+}
+
+
+/** Memory of the cached images
+--- n:      number of cached images (returned)
++++ Return: memory in bytes
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+size_t image_cache_bytes(int *n){
+
+  *n = cache.n;
+
+  return cache.bytes;
+}
+
+
+/** Drop all cached images
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_image_cache(){
+
+  while (cache.n > 0) remove_cached_image(cache.n - 1);
+
+  if (cache.entry != NULL) free((void*)cache.entry);
+  cache.entry = NULL;
+  cache.size = 0;
+  cache.budget = 0;
+
+  return;
+}
+
+
+/** Report image accesses
++++ Every image that is read as a whole band by band, or created, is re-
++++ ported as one line, i.e. "r path" or "w path", with absolute paths.
++++ Lines are shorter than PIPE_BUF, i.e. they are not interleaved when
++++ written to a pipe from several threads.
+--- fd:     file descriptor, e.g. a pipe, or -1 to stop reporting
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void report_image_access(int fd){
+
+  fd_access = fd;
+
+  return;
+}
+
+
+/** Read a window of rows, without exiting on errors
++++ This function does the work of read_image_rows. On error, a message
++++ is printed, nothing is allocated, and FAILURE is returned.
+--- nodata: nodata value per band (returned, allocated), or NULL
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int read_rows(char *path, bandlist_t *bands, int row, int n_rows, image_t *image, short **nodata){
+
+
+  GDALDatasetH  fp_dataset;
+  
+  copy_string(image->path, STRLEN, path);
+  if ((fp_dataset = GDALOpen(path, GA_ReadOnly))== NULL){ 
+    fprintf(stderr, "could not open %s\n", path); return FAILURE;}
+
+  int status = read_open_rows(fp_dataset, path, bands, row, n_rows, image, nodata);
+
+  GDALClose(fp_dataset);
+
+  return status;
+}
+
+
+/** Read a window of rows from an open dataset, see read_rows
++++ The dataset is left open, also on error.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int read_open_rows(GDALDatasetH fp_dataset, char *path, bandlist_t *bands, int row, int n_rows, image_t *image, short **nodata){
+
+
+  copy_string(image->path, STRLEN, path);
+
+  copy_string(image->proj, STRLEN, GDALGetProjectionRef(fp_dataset));
+  GDALGetGeoTransform(fp_dataset, image->geotran);
+
+  int ny = GDALGetRasterYSize(fp_dataset);
+  if (n_rows < 0) n_rows = ny - row;
+  if (row < 0 || n_rows < 1 || row + n_rows > ny){
+    fprintf(stderr, "rows %d to %d out of range for %s\n", row, row + n_rows - 1, path); return FAILURE;}
+
+  image->geotran[0] += row * image->geotran[2];
+  image->geotran[3] += row * image->geotran[5];
+
+  image->nx = GDALGetRasterXSize(fp_dataset);
+  image->ny = n_rows;
+  image->nc = image->nx*image->ny;
+
+  image->nb = GDALGetRasterCount(fp_dataset);
+
+  if (bands != NULL){
+    if (bands->n < 1){
+      fprintf(stderr, "no bands specified for %s\n", path); return FAILURE;}
+    for (int b=0; b<bands->n; b++){
+      if (bands->number[b] < 1 || bands->number[b] > image->nb){
+        fprintf(stderr, "band number %d out of range for %s\n", bands->number[b], path); return FAILURE;}
+    }
+    image->nb = bands->n;
+  } 
+
+  alloc_2D((void***)&image->data, image->nb, image->nc, sizeof(short));
+  if (nodata != NULL) alloc((void**)nodata, image->nb, sizeof(short));
+
+  for (int b=0; b<image->nb; b++){
+
+    GDALRasterBandH band;
+    if (bands != NULL){
+      band = GDALGetRasterBand(fp_dataset, bands->number[b]);
+    } else {
+      band = GDALGetRasterBand(fp_dataset, b+1);
+    }
+
+    int has_nodata;
+    image->nodata = (short)GDALGetRasterNoDataValue(band, &has_nodata);
+    if (nodata != NULL) (*nodata)[b] = image->nodata;
+
+    bool ok = true;
+
+    if (!has_nodata){
+      fprintf(stderr, "%s has no nodata value.\n", path); 
+      ok = false;
+    } else if (GDALRasterIO(band, GF_Read, 0, row, 
+      image->nx, image->ny, image->data[b], 
+      image->nx, image->ny, GDT_Int16, 0, 0) == CE_Failure){
+      printf("could not read band %d from %s.\n", b+1, path);
+      ok = false;
+    }
+
+    if (!ok){
+      free_image(image);
+      if (nodata != NULL){ free((void*)*nodata); *nodata = NULL; }
+      return FAILURE;
+    }
+
+  }
+
+  return SUCCESS;
+}
+
+
+/** Copy a window of rows from a cached image
++++ The image gets its own copy of the pixels, the cache is not modified.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int copy_cached_rows(cached_image_t *cached, bandlist_t *bands, int row, int n_rows, image_t *image){
+image_t *whole = &cached->image;
+
+
+  if (n_rows < 0) n_rows = whole->ny - row;
+  if (row < 0 || n_rows < 1 || row + n_rows > whole->ny){
+    fprintf(stderr, "rows %d to %d out of range for %s\n", row, row + n_rows - 1, cached->path); 
+    return FAILURE;
+  }
+
+  if (bands != NULL){
+    if (bands->n < 1){
+      fprintf(stderr, "no bands specified for %s\n", cached->path); return FAILURE;}
+    for (int b=0; b<bands->n; b++){
+      if (bands->number[b] < 1 || bands->number[b] > whole->nb){
+        fprintf(stderr, "band number %d out of range for %s\n", bands->number[b], cached->path); return FAILURE;}
+    }
+  }
+
+  copy_string(image->proj, STRLEN, whole->proj);
+  for (int i=0; i<6; i++) image->geotran[i] = whole->geotran[i];
+  image->geotran[0] += row * image->geotran[2];
+  image->geotran[3] += row * image->geotran[5];
+
+  image->nx = whole->nx;
+  image->ny = n_rows;
+  image->nc = image->nx*image->ny;
+  image->nb = (bands != NULL) ? bands->n : whole->nb;
+
+  alloc_2D((void***)&image->data, image->nb, image->nc, sizeof(short));
+
+  for (int b=0; b<image->nb; b++){
+    int band = (bands != NULL) ? bands->number[b] - 1 : b;
+    memcpy(image->data[b], whole->data[band] + (size_t)row * whole->nx, (size_t)image->nc * sizeof(short));
+    image->nodata = cached->nodata[band];
+  }
+
+  return SUCCESS;
+}
+
+
+/** Find an up-to-date image in the cache
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+cached_image_t *find_cached_image(char *path){
+char absolute[STRLEN];
+long long size, mtime;
+long mtime_nsec;
+
+
+  if (cache.n == 0) return NULL;
+
+  absolute_path(path, absolute, STRLEN);
+
+  for (int i=0; i<cache.n; i++){
+
+    cached_image_t *cached = &cache.entry[i];
+
+    if (strcmp(cached->path, absolute) != 0) continue;
+
+    if (stat_image(absolute, &size, &mtime, &mtime_nsec) != SUCCESS) return NULL;
+
+    if (size != cached->size || mtime != cached->mtime || mtime_nsec != cached->mtime_nsec) return NULL;
+
+    return cached;
+
+  }
+
+  return NULL;
+}
+
+
+/** Add a read image to the cache
++++ The image is dropped if its file changed while it was read, or if it
++++ is larger than the budget. The least recently used images are dropped
++++ to stay within the budget.
+--- cached: read image with the file status before it was read, the
+            cache takes the pixels over
++++ Return: SUCCESS if the image is cached, FAILURE otherwise
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int add_cached_image(cached_image_t *cached){
+long long size = -1, mtime = 0;
+long mtime_nsec = 0;
+
+
+  cached->bytes = (size_t)cached->image.nb * cached->image.nc * sizeof(short);
+  cached->used = ++cache.clock;
+
+  // changed while it was read, or too large
+  if (stat_image(cached->path, &size, &mtime, &mtime_nsec) != SUCCESS ||
+      size != cached->size || mtime != cached->mtime || mtime_nsec != cached->mtime_nsec ||
+      cached->bytes > cache.budget){
+    free_image(&cached->image);
+    free((void*)cached->nodata);
+    return FAILURE;
+  }
+
+  // read meanwhile, e.g. by two loads of the same image
+  for (int i=0; i<cache.n; i++){
+    if (strcmp(cache.entry[i].path, cached->path) == 0){
+      remove_cached_image(i);
+      break;
+    }
+  }
+
+  while (cache.bytes + cached->bytes > cache.budget){
+    int lru = 0;
+    for (int i=1; i<cache.n; i++){
+      if (cache.entry[i].used < cache.entry[lru].used) lru = i;
+    }
+    remove_cached_image(lru);
+  }
+
+  if (cache.n == cache.size){
+    int n = (cache.size > 0) ? cache.size * 2 : 16;
+    if (cache.entry == NULL){
+      alloc((void**)&cache.entry, n, sizeof(cached_image_t));
+    } else {
+      re_alloc((void**)&cache.entry, cache.size, n, sizeof(cached_image_t));
+    }
+    cache.size = n;
+  }
+
+  cache.entry[cache.n++] = *cached;
+  cache.bytes += cached->bytes;
+
+  return SUCCESS;
+}
+
+
+/** Write a buffer to a pipe, completely
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int write_pipe(int fd, const void *buffer, size_t size){
+const char *position = buffer;
+
+
+  while (size > 0){
+    ssize_t n_written = write(fd, position, size);
+    if (n_written < 0 && errno == EINTR) continue;
+    if (n_written <= 0) return FAILURE;
+    position += n_written;
+    size -= n_written;
+  }
+
+  return SUCCESS;
+}
+
+
+/** Remove an image from the cache
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void remove_cached_image(int i){
+
+  cache.bytes -= cache.entry[i].bytes;
+  free_image(&cache.entry[i].image);
+  free((void*)cache.entry[i].nodata);
+
+  cache.entry[i] = cache.entry[--cache.n];
+
+  return;
+}
+
+
+/** Size and modification time of an image file
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int stat_image(char *path, long long *size, long long *mtime, long *mtime_nsec){
+struct stat st;
+
+
+  if (stat(path, &st) != 0) return FAILURE;
+
+  *size = (long long)st.st_size;
+  *mtime = (long long)st.st_mtim.tv_sec;
+  *mtime_nsec = (long)st.st_mtim.tv_nsec;
+
+  return SUCCESS;
+}
+
+
+/** Absolute path of a file, relative to the working directory
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void absolute_path(char *path, char absolute[], size_t size){
+char cwd[STRLEN];
+
+
+  if (path[0] == '/' || getcwd(cwd, STRLEN) == NULL){
+    copy_string(absolute, size, path);
+  } else {
+    concat_string_2(absolute, size, cwd, path, "/");
+  }
+
+  return;
+}
+
+
+/** Report one image access, see report_image_access
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void report_access(char type, char *path){
+char absolute[STRLEN];
+char line[STRLEN + 4];
+
+
+  if (fd_access < 0) return;
+
+  absolute_path(path, absolute, STRLEN);
+
+  int nchar = snprintf(line, sizeof(line), "%c %s\n", type, absolute);
+  if (nchar < 0 || nchar >= (int)sizeof(line)) return;
+
+  if (write(fd_access, line, nchar) != nchar){
+    // the server is gone, the job still completes
+    fd_access = -1;
+  }
+
+  return;
+}
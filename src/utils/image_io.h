@@ -10,6 +10,10 @@ Image I/O header
 #include <stdlib.h>   // standard general utilities library
 #include <string.h>   // string handling functions
 #include <stdbool.h>  // boolean data type
+#include <errno.h>    // error numbers
+
+#include <unistd.h>   // essential POSIX functions and constants
+#include <sys/stat.h> // file information
 
 #include "alloc.h"
 #include "const.h"
@@ -25,6 +29,8 @@ Image I/O header
 extern "C" {
 #endif
 
+// block size of the created images, in pixels
+#define _TILE_SIZE_ 256
 
 typedef struct {
   int *number;    // array of band numbers
@@ -41,11 +47,46 @@ typedef struct {
   short nodata;
 } image_t;
 
+// header of an image sent for the cache, see send_image
+typedef struct {
+  char proj[STRLEN];    // projection
+  double geotran[6];    // geotransform
+  int nx, ny, nb;       // dimensions
+} image_load_header_t;
+
+// whole image that is read into the cache by another process
+typedef struct {
+  char path[STRLEN];    // absolute path
+  int fd;               // pipe the image arrives on
+  long long size;       // file size when the load started
+  long long mtime;      // modification time when the load started
+  long mtime_nsec;
+  image_load_header_t header; // received header
+  short *nodata;        // received nodata value per band
+  image_t image;        // received bands
+  size_t received;      // received bytes
+} image_load_t;
+
 void read_image(char *path, bandlist_t *bands, image_t *image);
+void read_image_rows(char *path, bandlist_t *bands, int row, int n_rows, image_t *image);
+void read_image_info(char *path, image_t *image);
+GDALDatasetH open_image(char *path);
+void read_dataset_rows(GDALDatasetH fp_dataset, char *path, bandlist_t *bands, int row, int n_rows, image_t *image);
 void copy_image(image_t *from, image_t *to, int nbands, short nodata, char *path);
 void write_image(image_t *image);
+GDALDatasetH create_image(image_t *image);
+void write_image_rows(GDALDatasetH fp_dataset, image_t *image, int row);
 void free_image(image_t *image);
 void compare_images(image_t *image_1, image_t *image_2);
+void init_image_cache(size_t budget);
+bool start_image_load(char *path, image_load_t *load);
+int send_image(image_load_t *load, int fd);
+bool receive_image(image_load_t *load);
+void uncache_image(char *path);
+bool image_cached(char *path);
+size_t image_cache_bytes(int *n);
+void free_image_cache();
+void report_image_access(int fd);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,169 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains the registry of spectral index kernels
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "indices.h"
+
+
+const int INDEX_BAND_NUMBERS[_BAND_ROLES_] = { 3, 8, 9, 10 };
+const float INDEX_WAVELENGTHS[_BAND_ROLES_] = { 0.665, 0.864, 1.609, 2.202 };
+
+
+void kernel_crem(const short **band, const bool *valid, short nodata, short *out, short fill, int n);
+void kernel_nbr(const short **band, const bool *valid, short nodata, short *out, short fill, int n);
+void kernel_ndmi(const short **band, const bool *valid, short nodata, short *out, short fill, int n);
+void kernel_ndvi(const short **band, const bool *valid, short nodata, short *out, short fill, int n);
+
+
+// registry of all indices
+static const index_def_t INDICES[] = {
+  { "CREM", (1 << _BAND_NIR_) | (1 << _BAND_SWIR1_) | (1 << _BAND_SWIR2_), kernel_crem },
+  { "NBR",  (1 << _BAND_NIR_) | (1 << _BAND_SWIR2_),                       kernel_nbr  },
+  { "NDMI", (1 << _BAND_NIR_) | (1 << _BAND_SWIR1_),                       kernel_ndmi },
+  { "NDVI", (1 << _BAND_RED_) | (1 << _BAND_NIR_),                         kernel_ndvi }
+};
+#define N_INDICES (sizeof(INDICES)/sizeof(INDICES[0]))
+
+
+/** Select indices
++++ This function looks up a list of index names in the registry.
+--- spec:   list of index names, e.g. CREM,NBR
+--- list:   selected indices (returned)
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int select_indices(char *spec, indexlist_t *list){
+char buffer[STRLEN];
+char *ptr = NULL, *saveptr = NULL;
+const char *separator = " ,;";
+
+
+  copy_string(buffer, STRLEN, spec);
+
+  list->n = 0;
+  list->bands = 0;
+
+  for (ptr = strtok_r(buffer, separator, &saveptr); ptr != NULL; ptr = strtok_r(NULL, separator, &saveptr)){
+
+    size_t i;
+    for (i=0; i<N_INDICES; i++){
+      if (strcmp(ptr, INDICES[i].name) == 0) break;
+    }
+
+    if (i == N_INDICES){
+      fprintf(stderr, "Unknown index %s.\n", ptr);
+      return FAILURE;
+    }
+
+    for (int k=0; k<list->n; k++){
+      if (list->index[k] == &INDICES[i]){
+        fprintf(stderr, "Index %s is selected twice.\n", ptr);
+        return FAILURE;
+      }
+    }
+
+    if (list->n == _INDEX_MAX_){
+      fprintf(stderr, "Too many indices, at most %d are allowed.\n", _INDEX_MAX_);
+      return FAILURE;
+    }
+
+    list->index[list->n++] = &INDICES[i];
+    list->bands |= INDICES[i].bands;
+
+  }
+
+  if (list->n == 0){
+    fprintf(stderr, "No index selected.\n");
+    return FAILURE;
+  }
+
+  return SUCCESS;
+}
+
+
+/** Print the names of all available indices
+--- fp:     output stream
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void print_indices(FILE *fp){
+
+  for (size_t i=0; i<N_INDICES; i++){
+    fprintf(fp, "%s%s", (i > 0) ? "," : "", INDICES[i].name);
+  }
+
+  return;
+}
+
+
+/** Normalized difference of two bands, scaled by 10000
++++ Pixels with nodata in any of the two bands or a zero sum are nodata.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+static inline void normalized_difference(const short *a, const short *b, const bool *valid, short nodata, short *out, short fill, int n){
+
+  #pragma omp simd
+  for (int k=0; k<n; k++){
+    float sum = (float)a[k] + (float)b[k];
+    bool ok = valid[k] && a[k] != nodata && b[k] != nodata && sum != 0;
+    float value = 10000.0f * ((float)a[k] - (float)b[k]) / (ok ? sum : 1.0f);
+    out[k] = ok ? (short)value : fill;
+  }
+
+  return;
+}
+
+
+/** Continuum-removed SWIR1
++++ The continuum at SWIR1 is interpolated between NIR and SWIR2, and sub-
++++ tracted from SWIR1.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void kernel_crem(const short **band, const bool *valid, short nodata, short *out, short fill, int n){
+const short *nir = band[_BAND_NIR_];
+const short *sw1 = band[_BAND_SWIR1_];
+const short *sw2 = band[_BAND_SWIR2_];
+
+  // interpolation weights for the continuum
+  const float d21 = INDEX_WAVELENGTHS[_BAND_SWIR2_] - INDEX_WAVELENGTHS[_BAND_SWIR1_];
+  const float d10 = INDEX_WAVELENGTHS[_BAND_SWIR1_] - INDEX_WAVELENGTHS[_BAND_NIR_];
+  const float d20 = INDEX_WAVELENGTHS[_BAND_SWIR2_] - INDEX_WAVELENGTHS[_BAND_NIR_];
+
+  #pragma omp simd
+  for (int k=0; k<n; k++){
+    bool ok = valid[k] && nir[k] != nodata && sw1[k] != nodata && sw2[k] != nodata;
+    float interpolated = (nir[k] * d21 + sw2[k] * d10) / d20;
+    short value = (short)(sw1[k] - interpolated);
+    out[k] = ok ? value : fill;
+  }
+
+  return;
+}
+
+
+/** Normalized Burn Ratio (NIR, SWIR2)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void kernel_nbr(const short **band, const bool *valid, short nodata, short *out, short fill, int n){
+
+  normalized_difference(band[_BAND_NIR_], band[_BAND_SWIR2_], valid, nodata, out, fill, n);
+
+  return;
+}
+
+
+/** Normalized Difference Moisture Index (NIR, SWIR1)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void kernel_ndmi(const short **band, const bool *valid, short nodata, short *out, short fill, int n){
+
+  normalized_difference(band[_BAND_NIR_], band[_BAND_SWIR1_], valid, nodata, out, fill, n);
+
+  return;
+}
+
+
+/** Normalized Difference Vegetation Index (NIR, RED)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void kernel_ndvi(const short **band, const bool *valid, short nodata, short *out, short fill, int n){
+
+  normalized_difference(band[_BAND_NIR_], band[_BAND_RED_], valid, nodata, out, fill, n);
+
+  return;
+}
+
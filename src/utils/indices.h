@@ -0,0 +1,59 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Spectral index registry header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef INDICES_H
+#define INDICES_H
+
+#include <stdio.h>    // core input and output functions
+#include <stdlib.h>   // standard general utilities library
+#include <stdbool.h>  // boolean data type
+#include <string.h>   // string handling functions
+
+#include "const.h"
+#include "string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// default index
+#define _INDICES_DEFAULT_ "CREM"
+
+// maximum number of indices computed at once
+#define _INDEX_MAX_ 16
+
+// spectral bands that indices are computed from
+enum { _BAND_RED_, _BAND_NIR_, _BAND_SWIR1_, _BAND_SWIR2_, _BAND_ROLES_ };
+
+// FORCE BOA band numbers and wavelengths (micrometers) of the bands above
+extern const int INDEX_BAND_NUMBERS[_BAND_ROLES_];
+extern const float INDEX_WAVELENGTHS[_BAND_ROLES_];
+
+// row kernel: band rows by role, screening result, reflectance nodata,
+// output row, output nodata, number of pixels
+typedef void (*index_kernel_t)(const short **band, const bool *valid, short nodata, short *out, short fill, int n);
+
+typedef struct {
+  const char *name;      // name of the index, used in output file names
+  int bands;             // bit mask of the band roles used (1 << _BAND_*_)
+  index_kernel_t kernel; // row kernel
+} index_def_t;
+
+typedef struct {
+  int n;                                // number of selected indices
+  const index_def_t *index[_INDEX_MAX_]; // selected indices
+  int bands;                            // bit mask of all band roles used
+} indexlist_t;
+
+int select_indices(char *spec, indexlist_t *list);
+void print_indices(FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,384 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for output manifests, i.e. records of the
+inputs and parameters an output was computed from, such that a stage can
+be skipped when its outputs are up to date
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "manifest.h"
+
+
+void manifest_path(char *output, char path[], size_t size);
+void stat_input(manifest_input_t *input);
+unsigned long long hash_file(char *path);
+bool output_fresh(manifest_t *manifest, char *output, int mode);
+void write_manifest(manifest_t *manifest, char *output, int mode);
+
+
+/** Incremental mode from its name
+--- name:   stat or hash
++++ Return: _MANIFEST_STAT_, _MANIFEST_HASH_, or -1 if unknown
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int manifest_mode(char *name){
+
+  if (strcmp(name, "stat") == 0) return _MANIFEST_STAT_;
+  if (strcmp(name, "hash") == 0) return _MANIFEST_HASH_;
+
+  return -1;
+}
+
+
+/** Initialize a manifest
+--- manifest: manifest (returned)
+--- stage:    executable, e.g. reference_period
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_manifest(manifest_t *manifest, const char *stage){
+
+  copy_string(manifest->stage, STRLEN, stage);
+  manifest->parameters[0] = '\0';
+  manifest->n = 0;
+  manifest->size = 0;
+  manifest->input = NULL;
+
+  return;
+}
+
+
+/** Add a parameter to a manifest
++++ Only parameters that change the outputs are added, e.g. not the num-
++++ ber of CPUs.
+--- manifest: manifest (modified)
+--- name:     parameter name
+--- format:   printf format of the value
+--- ...:      value
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void add_manifest_parameter(manifest_t *manifest, const char *name, const char *format, ...){
+char value[STRLEN];
+va_list ap;
+size_t length = strlen(manifest->parameters);
+int nchar;
+
+
+  va_start(ap, format);
+  vsnprintf(value, STRLEN, format, ap);
+  va_end(ap);
+
+  nchar = snprintf(manifest->parameters + length, STRLEN - length, "%s%s=%s",
+    (length > 0) ? " " : "", name, value);
+
+  if (nchar < 0 || (size_t)nchar >= STRLEN - length){
+    fprintf(stderr, "Too many parameters for the manifest.\n");
+    exit(FAILURE);
+  }
+
+  return;
+}
+
+
+/** Add an input to a manifest
++++ The size and modification time of the input are recorded now, i.e.
++++ before it is read. Empty paths, i.e. optional inputs that were not
++++ given, are ignored.
+--- manifest: manifest (modified)
+--- path:     input file
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void add_manifest_input(manifest_t *manifest, char *path){
+
+  if (path == NULL || path[0] == '\0') return;
+
+  if (manifest->n == manifest->size){
+    int size = (manifest->size > 0) ? manifest->size * 2 : 16;
+    if (manifest->input == NULL){
+      alloc((void**)&manifest->input, size, sizeof(manifest_input_t));
+    } else {
+      re_alloc((void**)&manifest->input, manifest->size, size, sizeof(manifest_input_t));
+    }
+    manifest->size = size;
+  }
+
+  manifest_input_t *input = &manifest->input[manifest->n++];
+
+  copy_string(input->path, STRLEN, path);
+  stat_input(input);
+  input->hashed = false;
+  input->hash = 0;
+
+  return;
+}
+
+
+/** Are the outputs up to date?
++++ The outputs are up to date if each output exists, was not changed
++++ since its manifest was written, and its manifest holds the same stage,
++++ parameters and inputs, and none of the inputs changed. An input changed
++++ if its size or modification time differs, unless content hashes are
++++ compared and the content is the same, e.g. an input that was rewritten
++++ upstream with the same values. Empty paths are ignored.
+--- manifest:  manifest of this run
+--- outputs:   output files
+--- n_outputs: number of outputs
+--- mode:      _MANIFEST_STAT_ or _MANIFEST_HASH_
++++ Return:    true if all outputs are up to date
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool outputs_fresh(manifest_t *manifest, char **outputs, int n_outputs, int mode){
+int n = 0;
+
+
+  if (mode == _MANIFEST_OFF_) return false;
+
+  for (int o=0; o<n_outputs; o++){
+    if (outputs[o] == NULL || outputs[o][0] == '\0') continue;
+    if (!output_fresh(manifest, outputs[o], mode)) return false;
+    n++;
+  }
+
+  return n > 0;
+}
+
+
+/** Write the manifests of the outputs
++++ This function writes one manifest next to each output, i.e. output
++++ .manifest. Content hashes are only computed if they are compared.
+--- manifest:  manifest of this run
+--- outputs:   output files, written and closed
+--- n_outputs: number of outputs
+--- mode:      _MANIFEST_OFF_, _MANIFEST_STAT_ or _MANIFEST_HASH_
++++ Return:    void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void write_manifests(manifest_t *manifest, char **outputs, int n_outputs, int mode){
+
+  for (int o=0; o<n_outputs; o++){
+    if (outputs[o] == NULL || outputs[o][0] == '\0') continue;
+    write_manifest(manifest, outputs[o], mode);
+  }
+
+  return;
+}
+
+
+/** Free a manifest
+--- manifest: manifest
++++ Return:   void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_manifest(manifest_t *manifest){
+
+  if (manifest->input != NULL) free((void*)manifest->input);
+  manifest->input = NULL;
+  manifest->n = 0;
+  manifest->size = 0;
+
+  return;
+}
+
+
+/** Is one output up to date?
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool output_fresh(manifest_t *manifest, char *output, int mode){
+char path[STRLEN];
+char line[STRLEN * 2];
+char token[STRLEN];
+manifest_input_t recorded, current;
+bool fresh = false;
+int n_inputs = 0, offset;
+FILE *fp = NULL;
+
+
+  manifest_path(output, path, STRLEN);
+
+  copy_string(current.path, STRLEN, output);
+  stat_input(&current);
+  if (!current.exists) return false;
+
+  if ((fp = fopen(path, "r")) == NULL) return false;
+
+  while (fgets(line, sizeof(line), fp) != NULL){
+
+    line[strcspn(line, "\r\n")] = '\0';
+
+    if (strncmp(line, "stage ", 6) == 0){
+
+      if (strcmp(line + 6, manifest->stage) != 0) goto done;
+
+    } else if (strncmp(line, "parameters", 10) == 0){
+
+      if (strcmp(line + 10 + (line[10] == ' '), manifest->parameters) != 0) goto done;
+
+    } else if (strncmp(line, "input ", 6) == 0){
+
+      // token holds STRLEN-1 characters, a longer field is a damaged line
+      if (sscanf(line, "input %lld %lld.%ld %1023s %n", &recorded.size, &recorded.mtime,
+            &recorded.mtime_nsec, token, &offset) != 4) goto done;
+      if (strlen(token) >= STRLEN-1) goto done;
+
+      if (n_inputs >= manifest->n) goto done;
+      manifest_input_t *input = &manifest->input[n_inputs++];
+
+      if (strcmp(line + offset, input->path) != 0 || !input->exists) goto done;
+
+      if (input->size == recorded.size && input->mtime == recorded.mtime &&
+          input->mtime_nsec == recorded.mtime_nsec) continue;
+
+      // touched, but maybe not changed
+      if (mode != _MANIFEST_HASH_ || strcmp(token, "-") == 0 || input->size != recorded.size) goto done;
+
+      if (!input->hashed){
+        input->hash = hash_file(input->path);
+        input->hashed = true;
+      }
+      if (input->hash != strtoull(token, NULL, 16)) goto done;
+
+    } else if (strncmp(line, "output ", 7) == 0){
+
+      if (sscanf(line, "output %lld %lld.%ld %n", &recorded.size, &recorded.mtime,
+            &recorded.mtime_nsec, &offset) != 3) goto done;
+
+      if (strcmp(line + offset, output) != 0 ||
+          current.size != recorded.size || current.mtime != recorded.mtime ||
+          current.mtime_nsec != recorded.mtime_nsec) goto done;
+
+      fresh = (n_inputs == manifest->n);
+
+    }
+
+  }
+
+  done:
+  fclose(fp);
+
+  return fresh;
+}
+
+
+/** Write the manifest of one output
++++ The manifest is written to a temporary file that replaces the previous
++++ manifest, the output line comes last, i.e. a partially written mani-
++++ fest is never up to date.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void write_manifest(manifest_t *manifest, char *output, int mode){
+char path[STRLEN];
+char path_temp[STRLEN];
+manifest_input_t current;
+FILE *fp = NULL;
+
+
+  manifest_path(output, path, STRLEN);
+  concat_string_2(path_temp, STRLEN, path, "temp", ".");
+
+  copy_string(current.path, STRLEN, output);
+  stat_input(&current);
+
+  if (!current.exists){
+    fprintf(stderr, "Output %s does not exist, no manifest written.\n", output);
+    return;
+  }
+
+  if ((fp = fopen(path_temp, "w")) == NULL){
+    fprintf(stderr, "Unable to write manifest %s.\n", path_temp);
+    exit(FAILURE);
+  }
+
+  fprintf(fp, "stage %s\n", manifest->stage);
+  fprintf(fp, "parameters %s\n", manifest->parameters);
+
+  for (int i=0; i<manifest->n; i++){
+
+    manifest_input_t *input = &manifest->input[i];
+
+    if (mode == _MANIFEST_HASH_ && input->exists && !input->hashed){
+      input->hash = hash_file(input->path);
+      input->hashed = true;
+    }
+
+    if (input->hashed){
+      fprintf(fp, "input %lld %lld.%09ld %016llx %s\n", input->size,
+        input->mtime, input->mtime_nsec, input->hash, input->path);
+    } else {
+      fprintf(fp, "input %lld %lld.%09ld - %s\n", input->size,
+        input->mtime, input->mtime_nsec, input->path);
+    }
+
+  }
+
+  fprintf(fp, "output %lld %lld.%09ld %s\n", current.size,
+    current.mtime, current.mtime_nsec, output);
+
+  if (fclose(fp) != 0 || rename(path_temp, path) != 0){
+    fprintf(stderr, "Unable to write manifest %s.\n", path);
+    exit(FAILURE);
+  }
+
+  return;
+}
+
+
+/** Path of the manifest of an output
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void manifest_path(char *output, char path[], size_t size){
+
+  concat_string_2(path, size, output, "manifest", ".");
+
+  return;
+}
+
+
+/** Size and modification time of a file
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void stat_input(manifest_input_t *input){
+struct stat st;
+
+
+  if (stat(input->path, &st) != 0){
+    input->exists = false;
+    input->size = -1;
+    input->mtime = 0;
+    input->mtime_nsec = 0;
+    return;
+  }
+
+  input->exists = true;
+  input->size = (long long)st.st_size;
+  input->mtime = (long long)st.st_mtim.tv_sec;
+  input->mtime_nsec = (long)st.st_mtim.tv_nsec;
+
+  return;
+}
+
+
+/** Content hash of a file (64-bit FNV-1a)
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+unsigned long long hash_file(char *path){
+unsigned long long hash = 14695981039346656037ULL;
+unsigned char *buffer = NULL;
+size_t bytes = 1024 * 1024;
+ssize_t n_read;
+int fd;
+
+
+  if ((fd = open(path, O_RDONLY)) < 0){
+    fprintf(stderr, "Unable to open %s for hashing.\n", path);
+    exit(FAILURE);
+  }
+
+  alloc((void**)&buffer, bytes, sizeof(unsigned char));
+
+  while ((n_read = read(fd, buffer, bytes)) > 0){
+    for (ssize_t i=0; i<n_read; i++){
+      hash ^= buffer[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  if (n_read < 0){
+    fprintf(stderr, "Unable to read %s for hashing.\n", path);
+    exit(FAILURE);
+  }
+
+  free((void*)buffer);
+  close(fd);
+
+  return hash;
+}
+
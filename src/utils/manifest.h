@@ -0,0 +1,62 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Output manifest header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stdio.h>     // core input and output functions
+#include <stdlib.h>    // standard general utilities library
+#include <string.h>    // string handling functions
+#include <stdbool.h>   // boolean data type
+#include <stdarg.h>    // variable arguments
+
+#include <fcntl.h>     // file control options
+#include <unistd.h>    // essential POSIX functions and constants
+#include <sys/stat.h>  // file information
+
+#include "alloc.h"
+#include "const.h"
+#include "string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// incremental modes, i.e. how unchanged inputs are recognized
+enum { _MANIFEST_OFF_, _MANIFEST_STAT_, _MANIFEST_HASH_ };
+
+typedef struct {
+  char path[STRLEN];          // input file
+  bool exists;                // did the input exist?
+  long long size;             // size in bytes
+  long long mtime;            // modification time, seconds
+  long mtime_nsec;            // modification time, nanoseconds
+  bool hashed;                // was the content hashed?
+  unsigned long long hash;    // content hash (64-bit FNV-1a)
+} manifest_input_t;
+
+typedef struct {
+  char stage[STRLEN];         // executable, e.g. reference_period
+  char parameters[STRLEN];    // parameters that change the outputs
+  int n;                      // number of inputs
+  int size;                   // number of allocated inputs
+  manifest_input_t *input;    // inputs, in the order they were added
+} manifest_t;
+
+int manifest_mode(char *name);
+void init_manifest(manifest_t *manifest, const char *stage);
+void add_manifest_parameter(manifest_t *manifest, const char *name, const char *format, ...);
+void add_manifest_input(manifest_t *manifest, char *path);
+bool outputs_fresh(manifest_t *manifest, char **outputs, int n_outputs, int mode);
+void write_manifests(manifest_t *manifest, char **outputs, int n_outputs, int mode);
+void free_manifest(manifest_t *manifest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
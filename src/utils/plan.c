@@ -0,0 +1,135 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for planning the memory of a job, i.e. the
+block size and concurrency that fit into a memory limit
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "plan.h"
+
+
+int fit_block_rows(footprint_t *footprint, size_t limit, int max_rows, int n_threads, int n_readers);
+
+
+/** Estimate the memory of a job
++++ This function estimates the peak memory for the given block size and
++++ concurrency. The outputs are tiled, thus the block cache holds whole
++++ rows of tiles of the outputs and of the images being read. Blocks are
++++ not aligned with the tiles, such that a block of n rows touches up to
++++ ceil(n / _TILE_SIZE_) + 1 rows of tiles, but not more than the image.
+--- footprint:  memory use of the job
+--- block_rows: rows per block
+--- n_threads:  number of threads
+--- n_readers:  number of images read at the same time
+--- cache:      GDAL block cache (returned)
++++ Return:     estimated memory in bytes
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+size_t estimate_memory(footprint_t *footprint, int block_rows, int n_threads, int n_readers, size_t *cache){
+size_t row_bytes = (size_t)footprint->nx * sizeof(short);
+size_t max_tiles = (size_t)(footprint->ny + _TILE_SIZE_ - 1) / _TILE_SIZE_;
+size_t n_tiles = (size_t)(block_rows + _TILE_SIZE_ - 1) / _TILE_SIZE_ + 1;
+size_t tile_rows = ((n_tiles < max_tiles) ? n_tiles : max_tiles) * _TILE_SIZE_;
+
+
+  *cache = row_bytes * tile_rows *
+    ((size_t)footprint->cache_bands + (size_t)n_readers * footprint->tile_bands);
+
+  return footprint->fixed + *cache + row_bytes * block_rows *
+    ((size_t)footprint->block_bands +
+     (size_t)n_threads * footprint->thread_bands +
+     (size_t)n_readers * footprint->reader_bands);
+}
+
+
+/** Find the largest block that fits into the memory limit
+--- footprint:   memory use of the job
+--- limit:       memory limit in bytes
+--- max_rows:    maximum rows per block
+--- n_threads:   number of threads
+--- n_readers:   number of images read at the same time
++++ Return:      rows per block, 0 if not even one row fits
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int fit_block_rows(footprint_t *footprint, size_t limit, int max_rows, int n_threads, int n_readers){
+int lower = 0, upper = max_rows;
+size_t cache;
+
+
+  // the estimate grows with the block size, bisect
+  while (lower < upper){
+    int rows = (lower + upper + 1) / 2;
+    if (estimate_memory(footprint, rows, n_threads, n_readers, &cache) <= limit){
+      lower = rows;
+    } else {
+      upper = rows - 1;
+    }
+  }
+
+  return lower;
+}
+
+
+/** Plan the block size and concurrency of a job
++++ This function picks the block size and concurrency that fit into the
++++ memory limit, before any pixel is read. Blocks shrink down to
++++ _MIN_BLOCK_ROWS_ first, then fewer images are read at the same time,
++++ unless each thread reads its own images, then fewer threads are used,
++++ and finally the blocks shrink to 1 row.
++++ If the job does not fit, the plan holds the smallest configuration.
+--- footprint:   memory use of the job
+--- limit:       memory limit in bytes
+--- max_rows:    maximum rows per block
+--- max_threads: maximum number of threads
+--- plan:        plan (returned)
++++ Return:      SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int plan_memory(footprint_t *footprint, size_t limit, int max_rows, int max_threads, plan_t *plan){
+int min_rows, rows;
+
+
+  if (max_rows > footprint->ny) max_rows = footprint->ny;
+  min_rows = (max_rows < _MIN_BLOCK_ROWS_) ? max_rows : _MIN_BLOCK_ROWS_;
+
+  plan->block_rows = 1;
+  plan->n_threads = 1;
+  plan->n_readers = 1;
+
+  for (int threads=max_threads; threads>=1; threads--){
+
+    int min_readers = footprint->own_reader ? threads : 1;
+
+    for (int readers=threads; readers>=min_readers; readers--){
+
+      rows = fit_block_rows(footprint, limit, max_rows, threads, readers);
+
+      if (rows >= min_rows || (threads == 1 && readers == 1 && rows >= 1)){
+        plan->block_rows = rows;
+        plan->n_threads = threads;
+        plan->n_readers = readers;
+        plan->n_open = footprint->n_outputs + readers;
+        plan->bytes = estimate_memory(footprint, rows, threads, readers, &plan->cache);
+        return SUCCESS;
+      }
+
+    }
+  }
+
+  plan->n_open = footprint->n_outputs + 1;
+  plan->bytes = estimate_memory(footprint, 1, 1, 1, &plan->cache);
+
+  return FAILURE;
+}
+
+
+/** Print the plan of a job
+--- plan:   plan
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void print_plan(plan_t *plan){
+
+  printf("Plan: %d rows per block, %d threads, %d images read at the same time, "
+    "%d open datasets, %.1f MB block cache, estimated memory %.1f MB.\n",
+    plan->block_rows, plan->n_threads, plan->n_readers, plan->n_open,
+    plan->cache / 1024.0 / 1024.0, plan->bytes / 1024.0 / 1024.0);
+
+  return;
+}
+
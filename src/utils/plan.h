@@ -0,0 +1,56 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Memory planning header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <stdio.h>    // core input and output functions
+#include <stdlib.h>   // standard general utilities library
+#include <stdbool.h>  // boolean data type
+
+#include "const.h"
+#include "image_io.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// blocks are not made smaller than this before the concurrency is reduced
+#define _MIN_BLOCK_ROWS_ 16
+
+// memory use of a job, counted in int16 bands of one block of rows
+typedef struct {
+  int nx;           // number of columns
+  int ny;           // number of rows
+  size_t fixed;     // bytes that do not depend on the plan, e.g. harmonic terms
+  int block_bands;  // bands held once per block, e.g. the index of all images
+  int thread_bands; // bands held by each thread
+  int reader_bands; // bands held by each image being read
+  int tile_bands;   // bands cached by each image being read
+  int cache_bands;  // bands written through the block cache
+  int n_outputs;    // number of open output datasets
+  bool own_reader;  // does each thread read its own images?
+} footprint_t;
+
+typedef struct {
+  int block_rows;   // rows per block
+  int n_threads;    // number of threads
+  int n_readers;    // number of images read at the same time
+  int n_open;       // number of open datasets
+  size_t cache;     // GDAL block cache
+  size_t bytes;     // estimated memory
+} plan_t;
+
+size_t estimate_memory(footprint_t *footprint, int block_rows, int n_threads, int n_readers, size_t *cache);
+int plan_memory(footprint_t *footprint, size_t limit, int max_rows, int max_threads, plan_t *plan);
+void print_plan(plan_t *plan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
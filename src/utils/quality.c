@@ -11,134 +11,147 @@ enum { _QAI_BIT_OFF_ =  0, _QAI_BIT_CLD_ =  1, _QAI_BIT_SHD_ =  3,
        _QAI_BIT_ILL_ = 11, _QAI_BIT_SLP_ = 13, _QAI_BIT_WVP_ = 14};
 
 short get_qai_from_value(short value, int index, int bitfields);
-bool get_off_from_value(short value);
-char get_cloud_from_value(short value);
-bool get_shadow_from_value(short value);
-bool get_snow_from_value(short value);
-bool get_water_from_value(short value);
-char get_aerosol_from_value(short value);
-bool get_subzero_from_value(short value);
-bool get_saturation_from_value(short value);
-bool get_lowsun_from_value(short value);
-char get_illumination_from_value(short value);
-bool get_slope_from_value(short value);
-bool get_vaporfill_from_value(short value);
-
-/** Decide whether to use this pixel
-+++ This function checks the QAI layer against the user-defined QAI crite-
-+++ ria.
---- qai:      Quality Assurance Information
---- p:        pixel
---- qai_rule: ruleset for QAI filtering
-+++ Return:   true/false
+int read_qai_rules(char *path, char *spec, size_t size);
+
+// screening rules: reject pixel if the flag has the given value
+typedef struct {
+  const char *name; // rule name (FORCE naming)
+  int index;        // first bit
+  int bitfields;    // number of bits
+  int value;        // flag value that rejects the pixel
+} qai_flag_t;
+
+static const qai_flag_t QAI_FLAGS[] = {
+  { "NODATA",       _QAI_BIT_OFF_, 1, 1 }, // on/off flag
+  { "CLOUD_BUFFER", _QAI_BIT_CLD_, 2, 1 }, // cloud uncertain
+  { "CLOUD_OPAQUE", _QAI_BIT_CLD_, 2, 2 }, // cloud opaque
+  { "CLOUD_CIRRUS", _QAI_BIT_CLD_, 2, 3 }, // cloud cirrus
+  { "CLOUD_SHADOW", _QAI_BIT_SHD_, 1, 1 }, // cloud shadow
+  { "SNOW",         _QAI_BIT_SNW_, 1, 1 }, // snow
+  { "WATER",        _QAI_BIT_WTR_, 1, 1 }, // water
+  { "AOD_INT",      _QAI_BIT_AOD_, 2, 1 }, // aerosol interpolated
+  { "AOD_HIGH",     _QAI_BIT_AOD_, 2, 2 }, // aerosol high
+  { "AOD_FILL",     _QAI_BIT_AOD_, 2, 3 }, // aerosol fill
+  { "SUBZERO",      _QAI_BIT_SUB_, 1, 1 }, // subzero reflectance
+  { "SATURATION",   _QAI_BIT_SAT_, 1, 1 }, // saturated reflectance
+  { "SUN_LOW",      _QAI_BIT_SUN_, 1, 1 }, // low sun angle
+  { "ILLUMIN_LOW",  _QAI_BIT_ILL_, 2, 1 }, // low illumination
+  { "ILLUMIN_POOR", _QAI_BIT_ILL_, 2, 2 }, // poor illumination
+  { "ILLUMIN_NONE", _QAI_BIT_ILL_, 2, 3 }, // shadow illumination
+  { "SLOPED",       _QAI_BIT_SLP_, 1, 1 }, // high slope
+  { "WVP_NONE",     _QAI_BIT_WVP_, 1, 1 }  // water vapor fill
+};
+#define N_QAI_FLAGS (sizeof(QAI_FLAGS)/sizeof(QAI_FLAGS[0]))
+
+
+/** Compile QAI screening rules
++++ This function compiles a rule specification into a bit table over all
++++ 65536 possible QAI values, such that screening a pixel is one lookup.
++++ The specification is a list of rule names (separated by comma, semi-
++++ colon or whitespace), e.g. "NODATA,CLOUD_OPAQUE,CLOUD_SHADOW". If the
++++ specification is the path of an existing file, the rules are read from
++++ that file (# starts a comment). Valid rule names are NODATA, CLOUD_BUF-
++++ FER, CLOUD_OPAQUE, CLOUD_CIRRUS, CLOUD_SHADOW, SNOW, WATER, AOD_INT, 
++++ AOD_HIGH, AOD_FILL, SUBZERO, SATURATION, SUN_LOW, ILLUMIN_LOW, ILLU-
++++ MIN_POOR, ILLUMIN_NONE, SLOPED and WVP_NONE.
+--- spec:   rule specification or file with rule specification
+--- rules:  compiled QAI rules (returned)
++++ Return: SUCCESS/FAILURE
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-bool use_this_pixel(short qai){
-
-  if (get_off_from_value(qai))               return false; // on/off flag
-  if (get_cloud_from_value(qai) == 1)        return false; // cloud uncertain
-  if (get_cloud_from_value(qai) == 2)        return false; // cloud opaque
-  if (get_cloud_from_value(qai) == 3)        return false;  // cloud cirrus
-  if (get_shadow_from_value(qai))            return false; // cloud shadow
-  if (get_snow_from_value(qai))              return false; // snow
-  //if (get_water_from_value(qai))             return false; // water
-  //if (get_aerosol_from_value(qai) == 1)      return false; // aerosol interpolated
-  //if (get_aerosol_from_value(qai) == 2)      return false; // aerosol high
-  //if (get_aerosol_from_value(qai) == 3)      return false; // aerosol fill
-  if (get_subzero_from_value(qai))           return false; // subzero reflectance
-  if (get_saturation_from_value(qai))        return false; // saturated reflectance
-  //if (get_lowsun_from_value(qai))            return false; // low sun angle
-  //if (get_illumination_from_value(qai) == 1) return false; // low illumination
-  //if (get_illumination_from_value(qai) == 2) return false; // poor illumination
-  if (get_illumination_from_value(qai) == 3) return false; // shadow illumination
-  //if (get_slope_from_value(qai))             return false; // high slope
-  //if (get_vaporfill_from_value(qai))         return false; // water vapor fill
-
-  return true;
-}
+int compile_qai_rules(char *spec, qai_rules_t *rules){
+char buffer[STRLEN*4];
+bool reject[N_QAI_FLAGS];
+char *ptr = NULL, *saveptr = NULL;
+const char *separator = " ,;\t\r\n";
 
 
+  if (fileexist(spec)){
+    if (read_qai_rules(spec, buffer, sizeof(buffer)) != SUCCESS) return FAILURE;
+  } else {
+    copy_string(buffer, sizeof(buffer), spec);
+  }
 
-/** This function reads any quality bit in the QAI layer
-+++ The same as get_qai, but reads the value from a short value directly
-+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
-short get_qai_from_value(short value, int index, int bitfields){
-int i;
-short val = 0;
+  for (size_t f=0; f<N_QAI_FLAGS; f++) reject[f] = false;
 
-  for (i=0; i<bitfields; i++) val |= (short)(1 << i);
+  for (ptr = strtok_r(buffer, separator, &saveptr); ptr != NULL; ptr = strtok_r(NULL, separator, &saveptr)){
 
-  return (short)(value >> index) & val;
-}
+    size_t f;
+    for (f=0; f<N_QAI_FLAGS; f++){
+      if (strcmp(ptr, QAI_FLAGS[f].name) == 0) break;
+    }
 
+    if (f == N_QAI_FLAGS){
+      fprintf(stderr, "Unknown QAI screening rule %s.\n", ptr);
+      return FAILURE;
+    }
 
-/** read off/on flag, directly from value **/
-bool get_off_from_value(short value){
+    reject[f] = true;
 
-  return get_qai_from_value(value, _QAI_BIT_OFF_, 1);
-}
-
-/** read cloud flag, directly from value **/
-char get_cloud_from_value(short value){
+  }
 
-  return get_qai_from_value(value, _QAI_BIT_CLD_, 2);
-}
+  memset(rules->use, 0, sizeof(rules->use));
 
-/** read cloud shadow flag, directly from value **/
-bool get_shadow_from_value(short value){
-
-  return get_qai_from_value(value, _QAI_BIT_SHD_, 1);
-}
+  for (int v=0; v<65536; v++){
 
-/** read snow flag, directly from value **/
-bool get_snow_from_value(short value){
+    bool use = true;
+    for (size_t f=0; f<N_QAI_FLAGS && use; f++){
+      if (reject[f] && get_qai_from_value((short)v, QAI_FLAGS[f].index, QAI_FLAGS[f].bitfields) == QAI_FLAGS[f].value) use = false;
+    }
 
-  return get_qai_from_value(value, _QAI_BIT_SNW_, 1);
-}
-
-/** read water flag, directly from value **/
-bool get_water_from_value(short value){
-
-  return get_qai_from_value(value, _QAI_BIT_WTR_, 1);
-}
+    if (use) rules->use[v >> 3] |= (unsigned char)(1 << (v & 7));
 
-/** read aerosol flag, directly from value **/
-char get_aerosol_from_value(short value){
+  }
 
-  return get_qai_from_value(value, _QAI_BIT_AOD_, 2);
+  return SUCCESS;
 }
 
-/** read subzero reflectance flag, directly from value **/
-bool get_subzero_from_value(short value){
 
-  return get_qai_from_value(value, _QAI_BIT_SUB_, 1);
-}
-
-/** read saturated reflectance flag, directly from value **/
-bool get_saturation_from_value(short value){
-
-  return get_qai_from_value(value, _QAI_BIT_SAT_, 1);
-}
-
-/** read low sun angle flag, directly from value **/
-bool get_lowsun_from_value(short value){
-
-  return get_qai_from_value(value, _QAI_BIT_SUN_, 1);
+/** Read QAI screening rules from file
++++ Comments (#) are removed, all lines are concatenated.
+--- path:   file with rule specification
+--- spec:   buffer that will hold the rule specification
+--- size:   length of the buffer
++++ Return: SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int read_qai_rules(char *path, char *spec, size_t size){
+char line[STRLEN];
+FILE *fp = NULL;
+size_t length = 0;
+
+  if ((fp = fopen(path, "r")) == NULL){
+    fprintf(stderr, "Unable to open QAI rule file %s.\n", path);
+    return FAILURE;
+  }
+
+  spec[0] = '\0';
+
+  while (fgets(line, STRLEN, fp) != NULL){
+    line[strcspn(line, "#\r\n")] = '\0';
+    if (length + strlen(line) + 2 > size){
+      fprintf(stderr, "QAI rule file %s is too long.\n", path);
+      fclose(fp);
+      return FAILURE;
+    }
+    strcat(spec, line);
+    strcat(spec, " ");
+    length = strlen(spec);
+  }
+
+  fclose(fp);
+
+  return SUCCESS;
 }
 
-/** read illumination flag, directly from value **/
-char get_illumination_from_value(short value){
 
-  return get_qai_from_value(value, _QAI_BIT_ILL_, 2);
-}
+/** This function reads any quality bit in the QAI layer
++++ The same as get_qai, but reads the value from a short value directly
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+short get_qai_from_value(short value, int index, int bitfields){
+int i;
+short val = 0;
 
-/** read slope flag, directly from value **/
-bool get_slope_from_value(short value){
+  for (i=0; i<bitfields; i++) val |= (short)(1 << i);
 
-  return get_qai_from_value(value, _QAI_BIT_SLP_, 1);
+  return (short)(value >> index) & val;
 }
 
-/** read water vapor fill flag, directly from value **/
-bool get_vaporfill_from_value(short value){
-
-  return get_qai_from_value(value, _QAI_BIT_WVP_, 1);
-}
@@ -9,13 +9,37 @@ Higher Level quality screening
 #include <stdio.h>   // core input and output functions
 #include <stdlib.h>  // standard general utilities library
 #include <stdbool.h>  // boolean data type
+#include <string.h>   // string handling functions
+
+#include "const.h"
+#include "dir.h"
+#include "string.h"
 
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-bool use_this_pixel(short qai);
+// default screening rules
+#define _QAI_RULES_DEFAULT_ "NODATA,CLOUD_BUFFER,CLOUD_OPAQUE,CLOUD_CIRRUS,CLOUD_SHADOW,SNOW,SUBZERO,SATURATION,ILLUMIN_NONE"
+
+// bit table over all 65536 QAI values, bit set = use pixel
+typedef struct {
+  unsigned char use[65536/8];
+} qai_rules_t;
+
+int compile_qai_rules(char *spec, qai_rules_t *rules);
+
+/** Decide whether to use this pixel
++++ This function looks up the QAI value in the compiled rule table.
+--- rules:  compiled QAI rules
+--- qai:    Quality Assurance Information
++++ Return: true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+static inline bool use_this_pixel(const qai_rules_t *rules, short qai){
+  unsigned short q = (unsigned short)qai;
+  return (rules->use[q >> 3] >> (q & 7)) & 1;
+}
 
 #ifdef __cplusplus
 }
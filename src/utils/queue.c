@@ -0,0 +1,563 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for a job queue on a shared file system,
+i.e. jobs are enqueued by a coordinator and leased by workers on any node
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "queue.h"
+
+
+static const char QUEUE_MAGIC[8] = "HBQUEUE";
+
+
+void lock_queue(char *path, bool create, queue_t *queue);
+void unlock_queue(queue_t *queue);
+bool reclaim_leases(queue_t *queue, long long now);
+void fail_job(queue_t *queue, int id);
+bool holds_lease(queue_t *queue, job_t *job);
+
+
+/** Enqueue jobs
++++ This function adds jobs to the queue, the queue is created if it does
++++ not exist. Jobs that are already queued, i.e. same tile, stage and
++++ year, are not added again, but failed or skipped jobs are retried.
++++ Jobs of the same tile are run in the order they were enqueued.
+--- path:         queue file
+--- jobs:         jobs, only tile, stage and year are used
+--- n_jobs:       number of jobs
+--- max_attempts: attempts before a job fails
++++ Return:       void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void enqueue_jobs(char *path, job_t *jobs, int n_jobs, int max_attempts){
+queue_t queue;
+int n_added = 0, n_retried = 0;
+
+
+  lock_queue(path, true, &queue);
+
+  queue.header.max_attempts = max_attempts;
+  queue.modified = true;
+
+  for (int i=0; i<n_jobs; i++){
+
+    job_t *job = NULL;
+
+    for (int j=0; j<queue.header.n_jobs; j++){
+      if (strcmp(queue.jobs[j].tile, jobs[i].tile) == 0 &&
+          strcmp(queue.jobs[j].stage, jobs[i].stage) == 0 &&
+          queue.jobs[j].year == jobs[i].year){
+        job = &queue.jobs[j];
+        break;
+      }
+    }
+
+    if (job == NULL){
+
+      if (queue.header.n_jobs == 0){
+        alloc((void**)&queue.jobs, 1, sizeof(job_t));
+      } else {
+        re_alloc((void**)&queue.jobs, queue.header.n_jobs, queue.header.n_jobs + 1, sizeof(job_t));
+      }
+
+      job = &queue.jobs[queue.header.n_jobs];
+      memset(job, 0, sizeof(job_t));
+      copy_string(job->tile, _JOB_NAMELEN_, jobs[i].tile);
+      copy_string(job->stage, _JOB_NAMELEN_, jobs[i].stage);
+      job->id = queue.header.n_jobs++;
+      job->year = jobs[i].year;
+      job->state = _JOB_PENDING_;
+      n_added++;
+
+    } else if (job->state == _JOB_FAILED_ || job->state == _JOB_SKIPPED_){
+
+      job->state = _JOB_PENDING_;
+      job->attempts = 0;
+      job->worker[0] = '\0';
+      n_retried++;
+
+    }
+
+  }
+
+  printf("Enqueued %d jobs, retrying %d jobs, %d jobs in queue %s.\n",
+    n_added, n_retried, queue.header.n_jobs, path);
+
+  unlock_queue(&queue);
+
+  return;
+}
+
+
+/** Lease a job
++++ This function leases the next pending job whose tile has no unfinished
++++ earlier job. Expired leases, i.e. workers that died or stopped sending
++++ heartbeats, are reclaimed first: the job is retried, or fails once the
++++ maximum number of attempts is reached. When a job fails, the later jobs
++++ of its tile are skipped.
+--- path:          queue file
+--- worker:        worker name, host:pid
+--- lease_seconds: lease duration
+--- job:           leased job (returned)
++++ Return:        _QUEUE_LEASED_, _QUEUE_BUSY_ if there are unfinished jobs
++++                that cannot be leased now, _QUEUE_DRAINED_ if all jobs
++++                are finished
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int lease_job(char *path, char *worker, int lease_seconds, job_t *job){
+queue_t queue;
+long long now = (long long)time(NULL);
+int n_open = 0;
+
+
+  lock_queue(path, false, &queue);
+
+  if (reclaim_leases(&queue, now)) queue.modified = true;
+
+  for (int j=0; j<queue.header.n_jobs; j++){
+
+    job_t *candidate = &queue.jobs[j];
+
+    if (candidate->state != _JOB_PENDING_ && candidate->state != _JOB_LEASED_) continue;
+    n_open++;
+
+    if (candidate->state != _JOB_PENDING_) continue;
+
+    bool blocked = false;
+    for (int i=0; i<j && !blocked; i++){
+      blocked = queue.jobs[i].state != _JOB_DONE_ &&
+                strcmp(queue.jobs[i].tile, candidate->tile) == 0;
+    }
+    if (blocked) continue;
+
+    candidate->state = _JOB_LEASED_;
+    candidate->attempts++;
+    candidate->status = 0;
+    candidate->lease = now + lease_seconds;
+    copy_string(candidate->worker, _JOB_NAMELEN_, worker);
+    memcpy(job, candidate, sizeof(job_t));
+
+    queue.modified = true;
+    unlock_queue(&queue);
+    return _QUEUE_LEASED_;
+
+  }
+
+  unlock_queue(&queue);
+
+  return (n_open > 0) ? _QUEUE_BUSY_ : _QUEUE_DRAINED_;
+}
+
+
+/** Renew a lease
++++ This function extends the lease of a running job, i.e. the heartbeat
++++ of the worker.
+--- path:          queue file
+--- job:           leased job
+--- lease_seconds: lease duration
++++ Return:        SUCCESS, or FAILURE if the lease was lost, i.e. it expired
++++                and the job was reassigned
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int renew_lease(char *path, job_t *job, int lease_seconds){
+queue_t queue;
+int status = FAILURE;
+
+
+  lock_queue(path, false, &queue);
+
+  if (holds_lease(&queue, job)){
+    queue.jobs[job->id].lease = (long long)time(NULL) + lease_seconds;
+    job->lease = queue.jobs[job->id].lease;
+    queue.modified = true;
+    status = SUCCESS;
+  }
+
+  unlock_queue(&queue);
+
+  return status;
+}
+
+
+/** Report a finished job
++++ This function reports the exit status of a leased job. Failed jobs are
++++ retried until the maximum number of attempts is reached. The report is
++++ discarded if the lease was lost.
+--- path:   queue file
+--- job:    leased job
+--- status: exit status, 0 on success
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void finish_job(char *path, job_t *job, int status){
+queue_t queue;
+
+
+  lock_queue(path, false, &queue);
+
+  if (!holds_lease(&queue, job)){
+    printf("Lease of job %d (%s, %d, %s) was lost, discarding the result.\n",
+      job->id, job->tile, job->year, job->stage);
+    unlock_queue(&queue);
+    return;
+  }
+
+  job_t *entry = &queue.jobs[job->id];
+
+  entry->status = status;
+  entry->lease = 0;
+
+  if (status == 0){
+    entry->state = _JOB_DONE_;
+  } else if (entry->attempts < queue.header.max_attempts){
+    entry->state = _JOB_PENDING_;
+  } else {
+    fail_job(&queue, job->id);
+  }
+
+  queue.modified = true;
+  unlock_queue(&queue);
+
+  return;
+}
+
+
+/** Poll the queue
++++ This function reclaims expired leases and counts the jobs per state.
+--- path:   queue file
+--- counts: number of jobs per state (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void poll_queue(char *path, int counts[_JOB_STATES_]){
+queue_t queue;
+
+
+  lock_queue(path, false, &queue);
+
+  if (reclaim_leases(&queue, (long long)time(NULL))) queue.modified = true;
+
+  for (int s=0; s<_JOB_STATES_; s++) counts[s] = 0;
+  for (int j=0; j<queue.header.n_jobs; j++) counts[queue.jobs[j].state]++;
+
+  unlock_queue(&queue);
+
+  return;
+}
+
+
+/** Print the jobs of the queue
+--- path:   queue file
+--- fp:     output stream
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void print_queue(char *path, FILE *fp){
+queue_t queue;
+
+
+  lock_queue(path, false, &queue);
+
+  fprintf(fp, "%6s %-20s %4s %-24s %-8s %8s %6s %s\n",
+    "job", "tile", "year", "stage", "state", "attempts", "status", "worker");
+
+  for (int j=0; j<queue.header.n_jobs; j++){
+    job_t *job = &queue.jobs[j];
+    fprintf(fp, "%6d %-20s %4d %-24s %-8s %8d %6d %s\n",
+      job->id, job->tile, job->year, job->stage, job_state_name(job->state),
+      job->attempts, job->status, job->worker);
+  }
+
+  unlock_queue(&queue);
+
+  return;
+}
+
+
+/** Expand the command of a job
++++ This function replaces {tile}, {year} and {stage} in the command.
+--- command: command template
+--- job:     job
+--- buffer:  expanded command (returned)
+--- size:    length of the buffer
++++ Return:  SUCCESS/FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int expand_command(char *command, job_t *job, char buffer[], size_t size){
+char year[16];
+size_t n = 0;
+
+
+  snprintf(year, sizeof(year), "%d", job->year);
+
+  for (char *c=command; *c!='\0'; ){
+
+    const char *value = NULL;
+    size_t length = 1;
+
+    if (strncmp(c, "{tile}", 6) == 0){
+      value = job->tile;
+      length = 6;
+    } else if (strncmp(c, "{year}", 6) == 0){
+      value = year;
+      length = 6;
+    } else if (strncmp(c, "{stage}", 7) == 0){
+      value = job->stage;
+      length = 7;
+    }
+
+    size_t value_length = (value != NULL) ? strlen(value) : 1;
+    if (n + value_length >= size) return FAILURE;
+
+    if (value != NULL){
+      memcpy(buffer + n, value, value_length);
+    } else {
+      buffer[n] = *c;
+    }
+
+    n += value_length;
+    c += length;
+
+  }
+
+  buffer[n] = '\0';
+
+  return SUCCESS;
+}
+
+
+/** Check the name of a tile or stage
++++ This function checks that a name is terminated within size and only
++++ contains [A-Za-z0-9_.-], i.e. it can be pasted into a shell command
++++ without quoting.
+--- name:   name
+--- size:   size of the name buffer
++++ Return: true if the name is valid
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool job_name_valid(const char *name, size_t size){
+size_t length;
+
+
+  if ((length = strnlen(name, size)) == 0 || length >= size) return false;
+
+  for (size_t i=0; i<length; i++){
+    if (!isalnum((unsigned char)name[i]) &&
+        name[i] != '_' && name[i] != '.' && name[i] != '-') return false;
+  }
+
+  return true;
+}
+
+
+/** Name of a job state
+--- state:  job state
++++ Return: name
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+const char *job_state_name(int state){
+
+  switch (state){
+    case _JOB_PENDING_: return "pending";
+    case _JOB_LEASED_:  return "leased";
+    case _JOB_DONE_:    return "done";
+    case _JOB_FAILED_:  return "failed";
+    case _JOB_SKIPPED_: return "skipped";
+    default:            return "unknown";
+  }
+
+}
+
+
+/** Open and lock the queue
++++ This function locks the queue exclusively and reads all jobs. The lock
++++ is held on a separate file, because the queue file is replaced when
++++ it is written back.
+--- path:   queue file
+--- create: create the queue if it does not exist?
+--- queue:  queue (returned)
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void lock_queue(char *path, bool create, queue_t *queue){
+FILE *fp = NULL;
+
+
+  copy_string(queue->path, STRLEN, path);
+  concat_string_2(queue->path_lock, STRLEN, path, "lock", ".");
+  queue->jobs = NULL;
+  queue->modified = false;
+
+  if (!create && !fileexist(path)){
+    fprintf(stderr, "Queue %s does not exist.\n", path);
+    exit(FAILURE);
+  }
+
+  if ((queue->fd_lock = open(queue->path_lock, O_RDWR | O_CREAT, 0644)) < 0){
+    fprintf(stderr, "Unable to open queue lock %s.\n", queue->path_lock);
+    exit(FAILURE);
+  }
+
+  if (flock(queue->fd_lock, LOCK_EX) != 0){
+    fprintf(stderr, "Unable to lock queue %s.\n", path);
+    exit(FAILURE);
+  }
+
+  memset(&queue->header, 0, sizeof(queue_header_t));
+
+  if (!fileexist(path)){
+    memcpy(queue->header.magic, QUEUE_MAGIC, sizeof(QUEUE_MAGIC));
+    return;
+  }
+
+  if ((fp = fopen(path, "rb")) == NULL){
+    fprintf(stderr, "Unable to open queue %s.\n", path);
+    exit(FAILURE);
+  }
+
+  if (fread(&queue->header, sizeof(queue_header_t), 1, fp) != 1 ||
+      memcmp(queue->header.magic, QUEUE_MAGIC, sizeof(QUEUE_MAGIC)) != 0 ||
+      queue->header.n_jobs < 0){
+    fprintf(stderr, "%s is not a queue.\n", path);
+    exit(FAILURE);
+  }
+
+  if (queue->header.n_jobs > 0){
+
+    alloc((void**)&queue->jobs, queue->header.n_jobs, sizeof(job_t));
+
+    if (fread(queue->jobs, sizeof(job_t), queue->header.n_jobs, fp) != (size_t)queue->header.n_jobs){
+      fprintf(stderr, "Unable to read queue %s.\n", path);
+      exit(FAILURE);
+    }
+
+    // the names end up in a shell command, the file is shared
+    for (int j=0; j<queue->header.n_jobs; j++){
+      if (!job_name_valid(queue->jobs[j].tile, _JOB_NAMELEN_) ||
+          !job_name_valid(queue->jobs[j].stage, _JOB_NAMELEN_) ||
+          memchr(queue->jobs[j].worker, '\0', _JOB_NAMELEN_) == NULL){
+        fprintf(stderr, "Job %d in queue %s is damaged.\n", j, path);
+        exit(FAILURE);
+      }
+    }
+
+  }
+
+  fclose(fp);
+
+  return;
+}
+
+
+/** Write back and unlock the queue
++++ This function writes the jobs to a temporary file, which replaces the
++++ queue file, i.e. readers never see a partially written queue.
+--- queue:  queue
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void unlock_queue(queue_t *queue){
+char path_temp[STRLEN];
+FILE *fp = NULL;
+
+
+  if (queue->modified){
+
+    concat_string_2(path_temp, STRLEN, queue->path, "temp", ".");
+
+    if ((fp = fopen(path_temp, "wb")) == NULL){
+      fprintf(stderr, "Unable to write queue %s.\n", path_temp);
+      exit(FAILURE);
+    }
+
+    if (fwrite(&queue->header, sizeof(queue_header_t), 1, fp) != 1 ||
+        (queue->header.n_jobs > 0 &&
+         fwrite(queue->jobs, sizeof(job_t), queue->header.n_jobs, fp) != (size_t)queue->header.n_jobs) ||
+        fflush(fp) != 0 || fsync(fileno(fp)) != 0){
+      fprintf(stderr, "Unable to write queue %s.\n", path_temp);
+      exit(FAILURE);
+    }
+
+    fclose(fp);
+
+    if (rename(path_temp, queue->path) != 0){
+      fprintf(stderr, "Unable to replace queue %s.\n", queue->path);
+      exit(FAILURE);
+    }
+
+  }
+
+  flock(queue->fd_lock, LOCK_UN);
+  close(queue->fd_lock);
+
+  if (queue->jobs != NULL) free((void*)queue->jobs);
+  queue->jobs = NULL;
+
+  return;
+}
+
+
+/** Reclaim expired leases
+--- queue:  locked queue
+--- now:    current time (seconds since 1970)
++++ Return: true if a lease was reclaimed
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool reclaim_leases(queue_t *queue, long long now){
+bool reclaimed = false;
+
+
+  for (int j=0; j<queue->header.n_jobs; j++){
+
+    job_t *job = &queue->jobs[j];
+
+    if (job->state != _JOB_LEASED_ || job->lease >= now) continue;
+
+    printf("Lease of job %d (%s, %d, %s) held by %s expired.\n",
+      job->id, job->tile, job->year, job->stage, job->worker);
+
+    job->lease = 0;
+    job->status = -1;
+
+    if (job->attempts < queue->header.max_attempts){
+      job->state = _JOB_PENDING_;
+    } else {
+      fail_job(queue, j);
+    }
+
+    reclaimed = true;
+
+  }
+
+  return reclaimed;
+}
+
+
+/** Fail a job, and skip the later jobs of its tile
+--- queue:  locked queue
+--- id:     job
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void fail_job(queue_t *queue, int id){
+
+  queue->jobs[id].state = _JOB_FAILED_;
+
+  printf("Job %d (%s, %d, %s) failed after %d attempts.\n", id,
+    queue->jobs[id].tile, queue->jobs[id].year, queue->jobs[id].stage,
+    queue->jobs[id].attempts);
+
+  for (int j=id+1; j<queue->header.n_jobs; j++){
+    if (queue->jobs[j].state == _JOB_PENDING_ &&
+        strcmp(queue->jobs[j].tile, queue->jobs[id].tile) == 0){
+      queue->jobs[j].state = _JOB_SKIPPED_;
+    }
+  }
+
+  return;
+}
+
+
+/** Does the worker still hold the lease of the job?
+--- queue:  locked queue
+--- job:    leased job
++++ Return: true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool holds_lease(queue_t *queue, job_t *job){
+
+  if (job->id < 0 || job->id >= queue->header.n_jobs) return false;
+
+  job_t *entry = &queue->jobs[job->id];
+
+  return entry->state == _JOB_LEASED_ &&
+         entry->attempts == job->attempts &&
+         strcmp(entry->worker, job->worker) == 0;
+}
+
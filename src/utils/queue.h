@@ -0,0 +1,85 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Job queue header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stdio.h>     // core input and output functions
+#include <stdlib.h>    // standard general utilities library
+#include <string.h>    // string handling functions
+#include <stdbool.h>   // boolean data type
+#include <time.h>      // date and time handling functions
+
+#include <fcntl.h>     // file control options
+#include <unistd.h>    // essential POSIX functions and constants
+#include <sys/file.h>  // advisory file locks
+#include <sys/stat.h>  // file information
+#include <ctype.h>     // testing and mapping characters
+
+#include "alloc.h"
+#include "const.h"
+#include "dir.h"
+#include "string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// length of the names in a job record
+#define _JOB_NAMELEN_ 64
+
+// job states
+enum { _JOB_PENDING_, _JOB_LEASED_, _JOB_DONE_, _JOB_FAILED_, _JOB_SKIPPED_, _JOB_STATES_ };
+
+// return codes of lease_job
+enum { _QUEUE_LEASED_, _QUEUE_BUSY_, _QUEUE_DRAINED_ };
+
+// header of the queue file (16 bytes)
+typedef struct {
+  char magic[8];                 // "HBQUEUE"
+  int n_jobs;                    // number of jobs
+  int max_attempts;              // attempts before a job fails
+} queue_header_t;
+
+// one record of the queue file (224 bytes)
+typedef struct {
+  char tile[_JOB_NAMELEN_];      // tile name, e.g. X0055_Y0053
+  char stage[_JOB_NAMELEN_];     // stage name, e.g. pipeline
+  char worker[_JOB_NAMELEN_];    // worker holding the lease, host:pid
+  int id;                        // record number
+  int year;                      // year
+  int state;                     // _JOB_PENDING_ ... _JOB_SKIPPED_
+  int attempts;                  // number of leases, identifies the lease
+  int status;                    // exit status of the last attempt
+  int reserved;                  // unused, zero
+  long long lease;               // lease expiry (seconds since 1970)
+} job_t;
+
+typedef struct {
+  char path[STRLEN];             // queue file
+  char path_lock[STRLEN];        // lock file, the queue file is replaced
+  int fd_lock;                   // lock file
+  queue_header_t header;
+  job_t *jobs;                   // jobs, in the order they were enqueued
+  bool modified;                 // write the queue back when unlocking?
+} queue_t;
+
+void enqueue_jobs(char *path, job_t *jobs, int n_jobs, int max_attempts);
+int lease_job(char *path, char *worker, int lease_seconds, job_t *job);
+int renew_lease(char *path, job_t *job, int lease_seconds);
+void finish_job(char *path, job_t *job, int status);
+void poll_queue(char *path, int counts[_JOB_STATES_]);
+void print_queue(char *path, FILE *fp);
+int expand_command(char *command, job_t *job, char buffer[], size_t size);
+bool job_name_valid(const char *name, size_t size);
+const char *job_state_name(int state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,175 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains the per-pixel extension of the reference period
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "reference.h"
+
+
+/** Extend the reference period of one pixel
++++ This function decides whether the reference period of a pixel can be
++++ extended until the given year. If the reference period already ended
++++ before the previous year, the previous results are copied. Otherwise,
++++ the observations of the given year are checked for anomalies against
++++ the previous model, and the previous results are copied if an anomaly
++++ is confirmed. If the pixel is still stable, or in the initial run, the
++++ harmonic model is fitted to all observations. The outputs must be
++++ initialized with nodata by the caller, they are left untouched if
++++ there are not enough valid observations to fit the model.
+--- rule:                    reference period rule
+--- input:                   input images, ordered by date
+--- terms:                   harmonic terms of the input images
+--- n_images:                number of input images
+--- i_break:                 first image of the given year
+--- initial:                 initial run, i.e. there is no previous model
+--- input_reference_period:  previous reference period
+--- input_coefficients:      previous coefficients
+--- baseline:                baseline table of the given year's images,
++++                          or NULL to predict each observation
+--- p:                       pixel
+--- coef:                    fitted coefficients (scratch)
+--- cov:                     covariance matrix (scratch)
+--- output_reference_period: reference period (modified)
+--- output_coefficients:     coefficients (modified)
++++ Return:                  _REFERENCE_INVALID_, _REFERENCE_PREVIOUS_,
++++                          _REFERENCE_ANOMALY_, _REFERENCE_FITTED_ or
++++                          _REFERENCE_UNFIT_
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int extend_reference_period(reference_rule_t *rule, image_t *input, float **terms, int n_images, int i_break,
+  bool initial, image_t *input_reference_period, image_t *input_coefficients, baseline_t *baseline, int p,
+  gsl_vector *coef, gsl_matrix *cov, image_t *output_reference_period, image_t *output_coefficients){
+int n_coef = output_coefficients->nb;
+
+
+  // we already ended the reference period in a previous iteration -> no need to fit again
+  // if we are working in 2018, and the reference period already ended in 2016 or earlier, just copy previous results
+  if (!initial && input_reference_period->data[0][p] < (rule->year - 1)){
+    // safety check (should not happen)
+    if (input_reference_period->data[0][p] < 1900){
+      printf("Warning: pixel %d has invalid reference period year - should not happen - %d.\n", p, input_reference_period->data[0][p]);
+      return _REFERENCE_INVALID_;
+    }
+    for (int b=0; b<output_coefficients->nb; b++) output_coefficients->data[b][p] = input_coefficients->data[b][p];
+    for (int b=0; b<output_reference_period->nb; b++) output_reference_period->data[b][p] = input_reference_period->data[b][p];
+    return _REFERENCE_PREVIOUS_;
+  }
+
+
+  // check for anomalies in the period after the previous reference period until the current year
+  if (!initial){
+
+    if (baseline != NULL) predict_baseline(terms + i_break, input_coefficients, n_coef, p, baseline);
+
+    for (int i=i_break, anomaly_counter=0; i<n_images; i++){
+
+      if (input[i].data[0][p] == input[i].nodata) continue;
+
+      float residual;
+      if (baseline != NULL){
+        residual = input[i].data[0][p] - baseline->value[baseline->row[i - i_break]][p - baseline->p0];
+      } else {
+        float y_pred = predict_harmonic_value(terms[i], input_coefficients, p, n_coef, rule->modes, rule->trend);
+        residual = input[i].data[0][p] - y_pred;
+      }
+
+      if (rule->threshold > 0 && residual > rule->threshold){
+        anomaly_counter++;
+      } else if (rule->threshold < 0 && residual < rule->threshold){
+        anomaly_counter++;
+      } else {
+        anomaly_counter = 0;
+      }
+
+      // detected anomaly, stop extending reference period
+      if (anomaly_counter >= rule->confirmation_number){
+        for (int b=0; b<output_coefficients->nb; b++) output_coefficients->data[b][p] = input_coefficients->data[b][p];
+        for (int b=0; b<output_reference_period->nb; b++) output_reference_period->data[b][p] = input_reference_period->data[b][p];
+        return _REFERENCE_ANOMALY_;
+      }
+
+    }
+
+  }
+
+
+  // still stable or initial run, extend fitting period to the whole time frame
+  int n_valid = 0;
+  for (int i=0; i<n_images; i++){
+    if (input[i].data[0][p] != input[i].nodata) n_valid++;
+  }
+
+  // not enough valid observations to fit the harmonic model
+  if (n_valid <= n_coef) return _REFERENCE_UNFIT_;
+
+  gsl_matrix *x = gsl_matrix_alloc(n_valid, n_coef);
+  gsl_vector *y = gsl_vector_alloc(n_valid);
+
+  for (int i=0, k=0; i<n_images; i++){
+
+    if (input[i].data[0][p] == input[i].nodata) continue;
+
+    // explanatory variables
+    for (int c=0; c<n_coef; c++){
+      gsl_matrix_set(x, k, c, terms[i][c]);
+    }
+
+    // response variable
+    gsl_vector_set(y, k, input[i].data[0][p]);
+    k++;
+
+  }
+
+  // Iteratively Reweighted Least Squares (IRLS)
+  double sd = irls_fit(x, y, coef, cov);
+
+  // update coefficients image
+  for (int b=0; b<n_coef; b++){
+    output_coefficients->data[b][p] = (short)(gsl_vector_get(coef, b) * _COEF_SCALE_);
+  }
+
+  output_reference_period->data[0][p] = rule->year; // extended until current year
+  output_reference_period->data[1][p] = (short)sd;
+
+  gsl_matrix_free(x);
+  gsl_vector_free(y);
+
+  return _REFERENCE_FITTED_;
+}
+
+
+/** Variability in the last year of the reference period
++++ This function computes the standard deviation and a robust standard
++++ deviation of the valid observations of one pixel in the given year. At
++++ least two observations are needed.
+--- input:       input images
+--- range:       first and last+1 image of each year
+--- year:        last year of the reference period
+--- p:           pixel
+--- estimator:   robust estimator (_ROBUST_MAD_, _ROBUST_IQR_, _ROBUST_TRIMMED_)
+--- buffer:      scratch buffer with one element per input image
+--- variability: variability image (modified)
++++ Return:      void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void reference_variability(image_t *input, int **range, short year, int p, int estimator, double *buffer, image_t *variability){
+double mean = 0, var = 0;
+int n = 0;
+
+  if (year < 0 || year >= 2100) return;
+
+  for (int i=range[year][0]; i<range[year][1]; i++){
+
+    if (input[i].data[0][p] == input[i].nodata) continue;
+
+    buffer[n++] = (double)input[i].data[0][p];
+    var_recurrence(buffer[n-1], &mean, &var, (double)n);
+
+  }
+
+  if (n < 2) return;
+
+  variability->data[0][p] = (short)standdev(var, n);
+  variability->data[1][p] = (short)robust_standdev(buffer, n, estimator);
+
+  return;
+}
+
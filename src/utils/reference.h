@@ -0,0 +1,48 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Reference period header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include <stdio.h>    // core input and output functions
+#include <stdlib.h>   // standard general utilities library
+#include <stdbool.h>  // boolean data type
+
+#include "const.h"
+#include "harmonic.h"
+#include "image_io.h"
+#include "stats.h"
+
+/** GNU Scientific Library (GSL) **/
+#include <gsl/gsl_multifit.h> // Linear Least Squares Fitting
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// outcome of extending the reference period of one pixel
+enum { _REFERENCE_INVALID_, _REFERENCE_PREVIOUS_, _REFERENCE_ANOMALY_,
+       _REFERENCE_FITTED_, _REFERENCE_UNFIT_ };
+
+typedef struct {
+  int year;                // latest year to extend the reference period to
+  int threshold;           // residual threshold, the sign gives the direction
+  int confirmation_number; // consecutive anomalies to stop the extension
+  int modes;               // number of harmonic modes
+  int trend;               // use trend coefficient?
+} reference_rule_t;
+
+int extend_reference_period(reference_rule_t *rule, image_t *input, float **terms, int n_images, int i_break,
+  bool initial, image_t *input_reference_period, image_t *input_coefficients, baseline_t *baseline, int p,
+  gsl_vector *coef, gsl_matrix *cov, image_t *output_reference_period, image_t *output_coefficients);
+void reference_variability(image_t *input, int **range, short year, int p, int estimator, double *buffer, image_t *variability);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
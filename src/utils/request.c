@@ -0,0 +1,373 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains functions for requests to a server on a Unix domain
+socket, i.e. a stage with its arguments is sent by a client, and the
+exit status of the stage is sent back when it finished
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#define _GNU_SOURCE // struct ucred
+
+#include "request.h"
+
+
+static const char REQUEST_MAGIC[8] = "HBREQ01";
+
+
+void socket_address(char *path, struct sockaddr_un *address);
+int write_all(int fd, const void *buffer, size_t size);
+int read_all(int fd, void *buffer, size_t size);
+
+
+/** Listen on a socket
++++ A stale socket of a server that is gone is removed, the server fails
++++ if another server is listening on the socket. The socket is only
++++ accessible by the owner, as the stages run with the server's rights.
+--- path:   socket file
++++ Return: listening socket
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int listen_socket(char *path){
+struct sockaddr_un address;
+mode_t mask;
+int fd;
+
+
+  socket_address(path, &address);
+
+  if (fileexist(path)){
+    if ((fd = connect_socket(path)) >= 0){
+      fprintf(stderr, "A server is already listening on %s.\n", path);
+      exit(FAILURE);
+    }
+    unlink(path);
+  }
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0){
+    fprintf(stderr, "Unable to listen on %s: %s.\n", path, strerror(errno));
+    exit(FAILURE);
+  }
+
+  // no one else can connect between bind and chmod
+  mask = umask(0177);
+  int bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+  umask(mask);
+
+  if (bound != 0 || chmod(path, 0600) != 0 || listen(fd, 64) != 0){
+    fprintf(stderr, "Unable to listen on %s: %s.\n", path, strerror(errno));
+    exit(FAILURE);
+  }
+
+  return fd;
+}
+
+
+/** Is the peer of a connection the owner of this process?
+--- fd:     connected socket
++++ Return: true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool peer_is_owner(int fd){
+struct ucred credentials;
+socklen_t length = sizeof(credentials);
+
+
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) return false;
+
+  return credentials.uid == getuid();
+}
+
+
+/** Connect to a socket
+--- path:   socket file
++++ Return: connected socket, or -1 if no server is listening
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int connect_socket(char *path){
+struct sockaddr_un address;
+int fd;
+
+
+  socket_address(path, &address);
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return -1;
+
+  if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0){
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+
+/** Send a request
++++ The request holds the working directory of the client, the stage and
++++ its arguments. The standard output and error of the client are passed
++++ along, i.e. the stage writes to them directly.
+--- fd:     connected socket
+--- argc:   number of arguments, including the stage
+--- argv:   stage and arguments
++++ Return: SUCCESS or FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int send_request(int fd, int argc, char *argv[]){
+request_header_t header;
+char cwd[STRLEN];
+char *buffer = NULL;
+size_t length, offset = 0;
+struct msghdr message;
+struct iovec iov;
+union {
+  struct cmsghdr align;
+  char buffer[CMSG_SPACE(2 * sizeof(int))];
+} control;
+int fds[2] = { STDOUT_FILENO, STDERR_FILENO };
+
+
+  if (getcwd(cwd, STRLEN) == NULL){
+    fprintf(stderr, "Unable to get the working directory.\n");
+    return FAILURE;
+  }
+
+  length = strlen(cwd) + 1;
+  for (int i=0; i<argc; i++) length += strlen(argv[i]) + 1;
+
+  if (length > _REQUEST_MAXLEN_){
+    fprintf(stderr, "Request is too long (%lu bytes).\n", (unsigned long)length);
+    return FAILURE;
+  }
+
+  alloc((void**)&buffer, length, sizeof(char));
+
+  memcpy(buffer, cwd, strlen(cwd) + 1);
+  offset += strlen(cwd) + 1;
+  for (int i=0; i<argc; i++){
+    memcpy(buffer + offset, argv[i], strlen(argv[i]) + 1);
+    offset += strlen(argv[i]) + 1;
+  }
+
+  memcpy(header.magic, REQUEST_MAGIC, 8);
+  header.n_strings = argc + 1;
+  header.length = (int)length;
+
+  // the header carries the file descriptors
+  memset(&message, 0, sizeof(message));
+  memset(&control, 0, sizeof(control));
+  iov.iov_base = &header;
+  iov.iov_len = sizeof(header);
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control.buffer;
+  message.msg_controllen = sizeof(control.buffer);
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  if (sendmsg(fd, &message, MSG_NOSIGNAL) != sizeof(header) ||
+      write_all(fd, buffer, length) != SUCCESS){
+    fprintf(stderr, "Unable to send the request: %s.\n", strerror(errno));
+    free((void*)buffer);
+    return FAILURE;
+  }
+
+  free((void*)buffer);
+
+  return SUCCESS;
+}
+
+
+/** Receive a request
+--- fd:      connected socket
+--- request: request (returned), free with free_request
++++ Return:  SUCCESS or FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int receive_request(int fd, request_t *request){
+request_header_t header;
+struct msghdr message;
+struct iovec iov;
+union {
+  struct cmsghdr align;
+  char buffer[CMSG_SPACE(2 * sizeof(int))];
+} control;
+ssize_t n_read;
+
+
+  request->fd_output = -1;
+  request->fd_error = -1;
+  request->argc = 0;
+  request->argv = NULL;
+  request->buffer = NULL;
+
+  memset(&message, 0, sizeof(message));
+  iov.iov_base = &header;
+  iov.iov_len = sizeof(header);
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control.buffer;
+  message.msg_controllen = sizeof(control.buffer);
+
+  if ((n_read = recvmsg(fd, &message, MSG_CMSG_CLOEXEC)) <= 0) return FAILURE;
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+      cmsg->cmsg_len == CMSG_LEN(2 * sizeof(int))){
+    int fds[2];
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    request->fd_output = fds[0];
+    request->fd_error = fds[1];
+  }
+
+  if (request->fd_output < 0 || (message.msg_flags & MSG_CTRUNC)){
+    fprintf(stderr, "Request without output.\n");
+    free_request(request);
+    return FAILURE;
+  }
+
+  if (n_read < (ssize_t)sizeof(header) &&
+      read_all(fd, (char*)&header + n_read, sizeof(header) - n_read) != SUCCESS){
+    free_request(request);
+    return FAILURE;
+  }
+
+  if (memcmp(header.magic, REQUEST_MAGIC, 8) != 0 ||
+      header.n_strings < 2 || header.length < header.n_strings ||
+      header.length > _REQUEST_MAXLEN_){
+    fprintf(stderr, "Invalid request.\n");
+    free_request(request);
+    return FAILURE;
+  }
+
+  alloc((void**)&request->buffer, header.length, sizeof(char));
+
+  if (read_all(fd, request->buffer, header.length) != SUCCESS ||
+      request->buffer[header.length - 1] != '\0'){
+    fprintf(stderr, "Incomplete request.\n");
+    free_request(request);
+    return FAILURE;
+  }
+
+  // strings are separated by zeros, argv is terminated by NULL like main's
+  alloc((void**)&request->argv, header.n_strings, sizeof(char*));
+
+  char *string = request->buffer;
+  char *end = request->buffer + header.length;
+
+  request->cwd = string;
+  string += strlen(string) + 1;
+
+  for (int i=0; i<header.n_strings - 1; i++){
+    if (string >= end){
+      fprintf(stderr, "Invalid request.\n");
+      free_request(request);
+      return FAILURE;
+    }
+    request->argv[request->argc++] = string;
+    string += strlen(string) + 1;
+  }
+
+  return SUCCESS;
+}
+
+
+/** Free a request
+--- request: request
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void free_request(request_t *request){
+
+  if (request->fd_output >= 0) close(request->fd_output);
+  if (request->fd_error >= 0) close(request->fd_error);
+  if (request->argv != NULL) free((void*)request->argv);
+  if (request->buffer != NULL) free((void*)request->buffer);
+
+  request->fd_output = -1;
+  request->fd_error = -1;
+  request->argc = 0;
+  request->argv = NULL;
+  request->buffer = NULL;
+
+  return;
+}
+
+
+/** Send the exit status of a stage
+--- fd:     connected socket
+--- status: exit status, 128 + signal if the stage was killed
++++ Return: SUCCESS or FAILURE
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int send_status(int fd, int status){
+
+  return write_all(fd, &status, sizeof(int));
+}
+
+
+/** Receive the exit status of a stage
++++ This function blocks until the stage finished.
+--- fd:     connected socket
+--- status: exit status (returned)
++++ Return: SUCCESS, or FAILURE if the server is gone
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int receive_status(int fd, int *status){
+
+  return read_all(fd, status, sizeof(int));
+}
+
+
+/** Address of a socket file
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void socket_address(char *path, struct sockaddr_un *address){
+
+  memset(address, 0, sizeof(struct sockaddr_un));
+  address->sun_family = AF_UNIX;
+
+  if (strlen(path) >= sizeof(address->sun_path)){
+    fprintf(stderr, "Socket path %s is too long, at most %lu characters.\n",
+      path, (unsigned long)sizeof(address->sun_path) - 1);
+    exit(FAILURE);
+  }
+
+  copy_string(address->sun_path, sizeof(address->sun_path), path);
+
+  return;
+}
+
+
+/** Write a buffer completely
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int write_all(int fd, const void *buffer, size_t size){
+const char *data = (const char*)buffer;
+ssize_t n;
+
+
+  while (size > 0){
+    if ((n = send(fd, data, size, MSG_NOSIGNAL)) < 0){
+      if (errno == EINTR) continue;
+      return FAILURE;
+    }
+    data += n;
+    size -= n;
+  }
+
+  return SUCCESS;
+}
+
+
+/** Read a buffer completely
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int read_all(int fd, void *buffer, size_t size){
+char *data = (char*)buffer;
+ssize_t n;
+
+
+  while (size > 0){
+    if ((n = read(fd, data, size)) < 0){
+      if (errno == EINTR) continue;
+      return FAILURE;
+    }
+    if (n == 0) return FAILURE;
+    data += n;
+    size -= n;
+  }
+
+  return SUCCESS;
+}
+
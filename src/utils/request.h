@@ -0,0 +1,64 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Server request header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef REQUEST_H
+#define REQUEST_H
+
+#include <stdio.h>      // core input and output functions
+#include <stdlib.h>     // standard general utilities library
+#include <string.h>     // string handling functions
+#include <stdbool.h>    // boolean data type
+#include <errno.h>      // error numbers
+
+#include <unistd.h>     // essential POSIX functions and constants
+#include <sys/socket.h> // sockets
+#include <sys/stat.h>   // file permissions
+#include <sys/un.h>     // Unix domain sockets
+
+#include "alloc.h"
+#include "const.h"
+#include "dir.h"
+#include "string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// largest request, i.e. working directory, stage and arguments
+#define _REQUEST_MAXLEN_ (16 * 1024 * 1024)
+
+// header of a request (16 bytes), the standard output and error of the
+// client are passed along with it
+typedef struct {
+  char magic[8];                 // "HBREQ01"
+  int n_strings;                 // working directory, stage and arguments
+  int length;                    // bytes of the strings, with terminating zeros
+} request_header_t;
+
+typedef struct {
+  int fd_output;                 // standard output of the client
+  int fd_error;                  // standard error of the client
+  char *cwd;                     // working directory of the client
+  int argc;                      // stage and arguments
+  char **argv;                   // pointers into buffer, argv[0] is the stage
+  char *buffer;                  // strings
+} request_t;
+
+int listen_socket(char *path);
+bool peer_is_owner(int fd);
+int connect_socket(char *path);
+int send_request(int fd, int argc, char *argv[]);
+int receive_request(int fd, request_t *request);
+void free_request(request_t *request);
+int send_status(int fd, int status);
+int receive_status(int fd, int *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
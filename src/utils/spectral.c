@@ -0,0 +1,147 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+This file contains the computation of spectral indices from images
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#include "spectral.h"
+
+
+/** Select the bands of the indices
++++ This function lists the reflectance bands that are needed by the
++++ selected indices, i.e. the union of their band roles.
+--- indices: selected indices
+--- bands:   bands to read, number and wavelengths must hold
++++          _BAND_ROLES_ elements (returned)
+--- slot:    band of each band role in the band list, or -1 (returned)
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void select_index_bands(indexlist_t *indices, bandlist_t *bands, int slot[]){
+
+  bands->n = 0;
+
+  for (int r=0; r<_BAND_ROLES_; r++){
+    if (indices->bands & (1 << r)){
+      slot[r] = bands->n;
+      bands->number[bands->n] = INDEX_BAND_NUMBERS[r];
+      bands->wavelengths[bands->n] = INDEX_WAVELENGTHS[r];
+      bands->n++;
+    } else {
+      slot[r] = -1;
+    }
+  }
+
+  return;
+}
+
+
+/** Compute spectral indices
++++ This function screens the pixels by mask and QAI rules once per row,
++++ and then runs the row kernels of all selected indices on the same
++++ reflectance rows.
+--- reflectance: reflectance image
+--- slot:        band of each band role in the reflectance image, or -1
+--- quality:     quality image
+--- mask:        mask image
+--- qai_rules:   compiled QAI screening rules
+--- indices:     selected indices
+--- index:       index images, one per index (modified)
+--- n_threads:   number of threads
++++ Return:      SUCCESS, or FAILURE if out of memory
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int compute_indices(image_t *reflectance, int slot[], image_t *quality, image_t *mask, qai_rules_t *qai_rules, indexlist_t *indices, image_t *index, int n_threads){
+bool failed = false;
+
+  #pragma omp parallel num_threads(n_threads) shared(reflectance, slot, quality, mask, qai_rules, indices, index, failed) default(none)
+  {
+
+    // per-thread validity of the pixels in one row
+    bool *valid = NULL;
+    if (try_alloc((void**)&valid, mask->nx, sizeof(bool)) != SUCCESS){
+      #pragma omp atomic write
+      failed = true;
+    }
+
+    #pragma omp for schedule(static)
+    for (int row=0; row<mask->ny; row++){
+
+      if (valid == NULL) continue;
+
+      size_t p0 = (size_t)row * mask->nx;
+      const short *qai = quality->data[0] + p0;
+      const short *msk = mask->data[0] + p0;
+      const short *band[_BAND_ROLES_];
+
+      for (int r=0; r<_BAND_ROLES_; r++){
+        band[r] = (slot[r] >= 0) ? reflectance->data[slot[r]] + p0 : NULL;
+      }
+
+      // screening: nodata, mask and QAI lookup
+      for (int k=0; k<mask->nx; k++){
+        valid[k] = 
+          qai[k] != quality->nodata &&
+          msk[k] != mask->nodata &&
+          msk[k] != 0 &&
+          use_this_pixel(qai_rules, qai[k]);
+      }
+
+      // index kernels, these check the nodata of their own bands
+      for (int i=0; i<indices->n; i++){
+        indices->index[i]->kernel(band, valid, reflectance->nodata, 
+          index[i].data[0] + p0, index[i].nodata, mask->nx);
+      }
+
+    }
+
+    free((void*)valid);
+
+  } // end omp parallel region
+
+  return failed ? FAILURE : SUCCESS;
+}
+
+
+/** Compute the index of a block of rows of one scene
++++ This function reads the reflectance bands that are needed by the index
++++ and the quality image of a block of rows, and computes the first of the
++++ selected indices with one thread. The reflectance and quality are
++++ freed right away.
+--- path_reflectance: reflectance image
+--- path_quality:     quality image
+--- row:              first row of the block
+--- n_rows:           number of rows of the block
+--- mask:             mask of the block
+--- qai_rules:        compiled QAI screening rules
+--- indices:          selected indices
+--- index:            index of the block (returned)
++++ Return:           void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void compute_index_rows(char *path_reflectance, char *path_quality, int row, int n_rows, image_t *mask,
+  qai_rules_t *qai_rules, indexlist_t *indices, image_t *index){
+image_t reflectance;
+image_t quality;
+bandlist_t bands;
+int number[_BAND_ROLES_];
+float wavelengths[_BAND_ROLES_];
+int slot[_BAND_ROLES_];
+
+  bands.number = number;
+  bands.wavelengths = wavelengths;
+  select_index_bands(indices, &bands, slot);
+
+  read_image_rows(path_reflectance, &bands, row, n_rows, &reflectance);
+  read_image_rows(path_quality, NULL, row, n_rows, &quality);
+
+  copy_image(&reflectance, index, 1, SHRT_MIN, path_reflectance);
+
+  // one thread, the caller runs scenes or blocks in parallel
+  if (compute_indices(&reflectance, slot, &quality, mask, qai_rules, indices, index, 1) != SUCCESS){
+    fprintf(stderr, "Unable to allocate memory for the index.\n");
+    exit(FAILURE);
+  }
+
+  free_image(&reflectance);
+  free_image(&quality);
+
+  return;
+}
+
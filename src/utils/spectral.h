@@ -0,0 +1,33 @@
+/**+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+Spectral index computation header
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+
+
+#ifndef SPECTRAL_H
+#define SPECTRAL_H
+
+#include <stdio.h>    // core input and output functions
+#include <stdlib.h>   // standard general utilities library
+#include <stdbool.h>  // boolean data type
+
+#include "alloc.h"
+#include "const.h"
+#include "image_io.h"
+#include "indices.h"
+#include "quality.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void select_index_bands(indexlist_t *indices, bandlist_t *bands, int slot[]);
+int compute_indices(image_t *reflectance, int slot[], image_t *quality, image_t *mask, qai_rules_t *qai_rules, indexlist_t *indices, image_t *index, int n_threads);
+void compute_index_rows(char *path_reflectance, char *path_quality, int row, int n_rows, image_t *mask, qai_rules_t *qai_rules, indexlist_t *indices, image_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
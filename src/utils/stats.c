@@ -264,3 +264,387 @@ double covariance(double cov, double n){
   return(cov/(n-1));
 }
 
+
+/** Initialize moment accumulator
+--- acc:    moment accumulator
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_moments(moments_t *acc){
+
+  acc->n = 0;
+  acc->mean = 0;
+  acc->m2 = 0;
+  acc->m3 = 0;
+  acc->m4 = 0;
+
+  return;
+}
+
+
+/** Add observation to moment accumulator
++++ This function updates mean and the central moments of order 2-4 with
++++ one observation. Mean and variance are updated exactly like in
++++ var_recurrence, i.e. the results are identical.
++++-----------------------------------------------------------------------
++++ P. P�bay. SANDIA REPORT SAND2008-6212 (2008). Formulas for Robust, 
++++ One-Pass Parallel Computation of Co- variances and Arbitrary-Order 
++++ Statistical Moments.
++++-----------------------------------------------------------------------
+--- acc:    moment accumulator (is updated)
+--- x:      current x-value
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void add_moments(moments_t *acc, double x){
+double n, delta, delta_n, delta_n2, tmp;
+
+  n = ++acc->n;
+
+  delta = x-acc->mean;
+  delta_n = delta/n;
+  delta_n2 = delta_n*delta_n;
+  tmp = delta*delta_n*(n-1);
+
+  acc->mean = acc->mean + delta_n;
+  acc->m4 = acc->m4 + tmp*delta_n2*(n*n-3*n+3) + 6*delta_n2*acc->m2 - 4*delta_n*acc->m3;
+  acc->m3 = acc->m3 + tmp*delta_n*(n-2) - 3*delta_n*acc->m2;
+  acc->m2 = acc->m2 + delta*(x-acc->mean);
+
+  return;
+}
+
+
+/** Merge moment accumulators
++++ This function combines two accumulators of disjoint sets of observa-
++++ tions, e.g. of two time chunks or of two threads. The result is the
++++ same as if all observations had been added to one accumulator (up to
++++ rounding). Accumulators can be merged in any order.
++++-----------------------------------------------------------------------
++++ P. P�bay. SANDIA REPORT SAND2008-6212 (2008). Formulas for Robust, 
++++ One-Pass Parallel Computation of Co- variances and Arbitrary-Order 
++++ Statistical Moments.
++++-----------------------------------------------------------------------
+--- acc:    moment accumulator (is updated)
+--- other:  moment accumulator that is merged into acc
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void merge_moments(moments_t *acc, const moments_t *other){
+double na = acc->n, nb = other->n, n;
+double delta, delta_n, delta2, m2, m3, m4;
+
+  if (nb == 0) return;
+  if (na == 0){
+    *acc = *other;
+    return;
+  }
+
+  n = na + nb;
+  delta = other->mean - acc->mean;
+  delta_n = delta/n;
+  delta2 = delta*delta;
+
+  m2 = acc->m2 + other->m2 + delta2*na*nb/n;
+
+  m3 = acc->m3 + other->m3 
+     + delta*delta2*na*nb*(na-nb)/(n*n)
+     + 3*delta_n*(na*other->m2 - nb*acc->m2);
+
+  m4 = acc->m4 + other->m4 
+     + delta2*delta2*na*nb*(na*na - na*nb + nb*nb)/(n*n*n)
+     + 6*delta_n*delta_n*(na*na*other->m2 + nb*nb*acc->m2)
+     + 4*delta_n*(na*other->m3 - nb*acc->m3);
+
+  acc->mean = acc->mean + delta_n*nb;
+  acc->m2 = m2;
+  acc->m3 = m3;
+  acc->m4 = m4;
+  acc->n = n;
+
+  return;
+}
+
+
+/** Variance, standard deviation, skewness and kurtosis of accumulator
++++ These functions compute the statistics from a moment accumulator, see
++++ the functions for the recurrence formulas above.
+--- acc:    moment accumulator
++++ Return: statistic
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double moments_variance(const moments_t *acc){
+
+  return(variance(acc->m2, acc->n));
+}
+
+double moments_standdev(const moments_t *acc){
+
+  return(standdev(acc->m2, acc->n));
+}
+
+double moments_skewness(const moments_t *acc){
+
+  return(skewness(acc->m2, acc->m3, acc->n));
+}
+
+double moments_kurtosis(const moments_t *acc){
+
+  return(kurtosis(acc->m2, acc->m4, acc->n));
+}
+
+
+/** Initialize comoment accumulator
+--- acc:    comoment accumulator
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void init_comoments(comoments_t *acc){
+
+  acc->n = 0;
+  acc->mx = 0;
+  acc->my = 0;
+  acc->vx = 0;
+  acc->vy = 0;
+  acc->cv = 0;
+
+  return;
+}
+
+
+/** Add observation pair to comoment accumulator
++++ This function updates means, variances and covariance with one pair of
++++ observations, identical to covar_recurrence.
+--- acc:    comoment accumulator (is updated)
+--- x:      current x-value
+--- y:      current y-value
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void add_comoments(comoments_t *acc, double x, double y){
+
+  acc->n++;
+  covar_recurrence(x, y, &acc->mx, &acc->my, &acc->vx, &acc->vy, &acc->cv, acc->n);
+
+  return;
+}
+
+
+/** Merge comoment accumulators
++++ This function combines two accumulators of disjoint sets of observa-
++++ tion pairs.
++++-----------------------------------------------------------------------
++++ P. P�bay. SANDIA REPORT SAND2008-6212 (2008). Formulas for Robust, 
++++ One-Pass Parallel Computation of Co- variances and Arbitrary-Order 
++++ Statistical Moments.
++++-----------------------------------------------------------------------
+--- acc:    comoment accumulator (is updated)
+--- other:  comoment accumulator that is merged into acc
++++ Return: void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void merge_comoments(comoments_t *acc, const comoments_t *other){
+double na = acc->n, nb = other->n, n;
+double dx, dy, w;
+
+  if (nb == 0) return;
+  if (na == 0){
+    *acc = *other;
+    return;
+  }
+
+  n = na + nb;
+  dx = other->mx - acc->mx;
+  dy = other->my - acc->my;
+  w = na*nb/n;
+
+  acc->vx = acc->vx + other->vx + dx*dx*w;
+  acc->vy = acc->vy + other->vy + dy*dy*w;
+  acc->cv = acc->cv + other->cv + dx*dy*w;
+  acc->mx = acc->mx + dx*nb/n;
+  acc->my = acc->my + dy*nb/n;
+  acc->n = n;
+
+  return;
+}
+
+
+/** Covariance of comoment accumulator
+--- acc:    comoment accumulator
++++ Return: covariance
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double comoments_covariance(const comoments_t *acc){
+
+  return(covariance(acc->cv, acc->n));
+}
+
+
+/** Select the k-th smallest value
++++ This function finds the k-th smallest value (0-based) in linear time
++++ on average (quickselect with median-of-three pivots). The array is
++++ partially reordered: afterwards, all values before position k are
++++ smaller or equal, and all values after position k are larger or equal
++++ than the value at position k.
+--- x:      array (is reordered)
+--- n:      number of observations
+--- k:      rank of the value to select
++++ Return: k-th smallest value
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double select_kth(double *x, int n, int k){
+int lo = 0, hi = n-1;
+double pivot, tmp;
+
+  #define SWAP_DOUBLE(a, b) { tmp = (a); (a) = (b); (b) = tmp; }
+
+  while (hi > lo){
+
+    int mid = lo + (hi-lo)/2;
+    if (x[mid] < x[lo]) SWAP_DOUBLE(x[mid], x[lo]);
+    if (x[hi]  < x[lo]) SWAP_DOUBLE(x[hi],  x[lo]);
+    if (x[hi]  < x[mid]) SWAP_DOUBLE(x[hi], x[mid]);
+    pivot = x[mid];
+
+    int i = lo, j = hi;
+    while (i <= j){
+      while (x[i] < pivot) i++;
+      while (x[j] > pivot) j--;
+      if (i <= j){
+        SWAP_DOUBLE(x[i], x[j]);
+        i++; j--;
+      }
+    }
+
+    if (k <= j){
+      hi = j;
+    } else if (k >= i){
+      lo = i;
+    } else {
+      break;
+    }
+
+  }
+
+  #undef SWAP_DOUBLE
+
+  return x[k];
+}
+
+
+/** Compute quantile
++++ This function computes a quantile with linear interpolation between
++++ order statistics (type 7, as in R's default), using selection.
+--- x:      array (is reordered)
+--- n:      number of observations
+--- p:      probability (0-1)
++++ Return: quantile
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double quantile(double *x, int n, double p){
+double h = (n-1) * p;
+int k = (int)floor(h);
+double lower, upper;
+
+  lower = select_kth(x, n, k);
+  if (k+1 >= n || h == k) return lower;
+
+  // smallest value above position k is the next order statistic
+  upper = x[k+1];
+  for (int i=k+2; i<n; i++) if (x[i] < upper) upper = x[i];
+
+  return(lower + (h-k) * (upper-lower));
+}
+
+
+/** Compute median
++++ This function computes the median of an array using selection.
+--- x:      array (is reordered)
+--- n:      number of observations
++++ Return: median
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double median(double *x, int n){
+double upper, lower;
+
+  upper = select_kth(x, n, n/2);
+  if (n % 2 == 1) return upper;
+
+  // largest value below position n/2 is the other middle value
+  lower = x[0];
+  for (int i=1; i<n/2; i++) if (x[i] > lower) lower = x[i];
+
+  return((lower + upper) / 2.0);
+}
+
+
+/** Compute robust standard deviation
++++ This function computes a robust estimate of the standard deviation,
++++ i.e. the median absolute deviation from the median, scaled by 1.4826
++++ to be consistent with the standard deviation of normal distributions.
+--- x:      array (is overwritten)
+--- n:      number of observations
++++ Return: robust standard deviation
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double mad_standdev(double *x, int n){
+double med;
+
+  med = median(x, n);
+
+  for (int i=0; i<n; i++) x[i] = fabs(x[i] - med);
+
+  return(1.4826 * median(x, n));
+}
+
+
+/** Compute interquartile standard deviation
++++ This function computes a robust estimate of the standard deviation from
++++ the interquartile range, scaled by 1/1.349 to be consistent with the
++++ standard deviation of normal distributions.
+--- x:      array (is reordered)
+--- n:      number of observations
++++ Return: robust standard deviation
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double iqr_standdev(double *x, int n){
+double q25, q75;
+
+  q25 = quantile(x, n, 0.25);
+  q75 = quantile(x, n, 0.75);
+
+  return((q75 - q25) / 1.349);
+}
+
+
+/** Compute trimmed standard deviation
++++ This function computes the standard deviation of the central part of
++++ the observations, i.e. the floor(trim x n) smallest and largest values
++++ are discarded. The central part is found with two selections.
+--- x:      array (is reordered)
+--- n:      number of observations
+--- trim:   fraction to discard on each side (0-0.5)
++++ Return: trimmed standard deviation
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double trimmed_standdev(double *x, int n, double trim){
+int g = (int)floor(trim * n);
+double mx = 0, vx = 0;
+int m = n - 2*g;
+
+  if (g > 0){
+    select_kth(x, n, g);
+    select_kth(x + g, n - g, m - 1);
+  }
+
+  for (int i=0; i<m; i++) var_recurrence(x[g+i], &mx, &vx, (double)(i+1));
+
+  return(standdev(vx, m));
+}
+
+
+/** Compute robust standard deviation with given estimator
+--- x:         array (is overwritten)
+--- n:         number of observations
+--- estimator: _ROBUST_MAD_, _ROBUST_IQR_ or _ROBUST_TRIMMED_
++++ Return:    robust standard deviation
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+double robust_standdev(double *x, int n, int estimator){
+
+  switch (estimator){
+    case _ROBUST_IQR_:
+      return(iqr_standdev(x, n));
+    case _ROBUST_TRIMMED_:
+      return(trimmed_standdev(x, n, _ROBUST_TRIM_));
+    case _ROBUST_MAD_:
+    default:
+      return(mad_standdev(x, n));
+  }
+}
+
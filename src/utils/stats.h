@@ -19,6 +19,29 @@ Statistics header
 extern "C" {
 #endif
 
+// robust estimators of the standard deviation
+enum { _ROBUST_MAD_, _ROBUST_IQR_, _ROBUST_TRIMMED_ };
+
+// fraction of the observations discarded on each side by _ROBUST_TRIMMED_
+#define _ROBUST_TRIM_ 0.1
+
+// mergeable accumulator of mean and central moments (sums of powers of deviations)
+typedef struct {
+  double n;    // number of observations
+  double mean; // mean
+  double m2;   // sum of squared deviations
+  double m3;   // sum of cubed deviations
+  double m4;   // sum of deviations to the power of 4
+} moments_t;
+
+// mergeable accumulator of means, variances and covariance of two variables
+typedef struct {
+  double n;      // number of observations
+  double mx, my; // means
+  double vx, vy; // sums of squared deviations
+  double cv;     // sum of cross products of deviations
+} comoments_t;
+
 void covar_recurrence(double   x, double   y, double *mx, double *my, double *vx, double *vy, double *cv, double n);
 void cov_recurrence(double   x, double   y, double *mx, double *my, double *cv, double n);
 void kurt_recurrence(double   x,    double *mx, double *vx,    double *sx,double *kx, double n);
@@ -29,6 +52,24 @@ double skewness(double var, double skew, double n);
 double variance(double var, double n);
 double standdev(double var, double n);
 double covariance(double cov, double n);
+void init_moments(moments_t *acc);
+void add_moments(moments_t *acc, double x);
+void merge_moments(moments_t *acc, const moments_t *other);
+double moments_variance(const moments_t *acc);
+double moments_standdev(const moments_t *acc);
+double moments_skewness(const moments_t *acc);
+double moments_kurtosis(const moments_t *acc);
+void init_comoments(comoments_t *acc);
+void add_comoments(comoments_t *acc, double x, double y);
+void merge_comoments(comoments_t *acc, const comoments_t *other);
+double comoments_covariance(const comoments_t *acc);
+double select_kth(double *x, int n, int k);
+double quantile(double *x, int n, double p);
+double median(double *x, int n);
+double mad_standdev(double *x, int n);
+double iqr_standdev(double *x, int n);
+double trimmed_standdev(double *x, int n, double trim);
+double robust_standdev(double *x, int n, int estimator);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,696 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "utils/alloc.h"
+#include "utils/const.h"
+#include "utils/dir.h"
+#include "utils/string.h"
+#include "args/args_watcher.h"
+
+
+typedef struct {
+  char name[STRLEN];       // tile name, e.g. X0055_Y0053
+  char dir[STRLEN];        // tile directory
+  int wd;                  // inotify watch, -1 if the directory was removed
+} watched_tile_t;
+
+typedef struct {
+  int tile;                // watched tile
+  int year;                // year of the scene
+  char path_reflectance[STRLEN]; // BOA image
+  char path_quality[STRLEN];     // QAI image
+  off_t size[2];           // sizes of the images at the last check
+  time_t mtime[2];         // modification times at the last check
+  time_t changed;          // latest change time of the images
+  time_t first_event;      // arrival of the pair
+  time_t last_event;       // last write to one of the images
+  time_t retry;            // earliest retry after the command failed, 0 if not failed
+} arrival_t;
+
+typedef struct {
+  args_t *args;            // arguments
+  int fd;                  // inotify instance
+  int wd_cube;             // watch of the datacube directory
+  int n_tiles;             // number of watched tiles
+  watched_tile_t *tile;    // watched tiles
+  int n_arrivals;          // number of pairs waiting to be processed
+  int size_arrivals;       // number of allocated pairs
+  arrival_t *arrival;      // pairs waiting to be processed
+  time_t collected;        // time the last pass collected its pairs
+} watcher_t;
+
+
+bool accept_tile(watcher_t *watcher, char *name);
+void watch_tile(watcher_t *watcher, char *name, time_t since);
+void note_scene(watcher_t *watcher, int tile, char *file, time_t since);
+void check_arrivals(watcher_t *watcher, time_t now);
+bool pass_due(watcher_t *watcher, time_t now);
+void run_pass(watcher_t *watcher, time_t now);
+char **expand_pass(char *command, char *tile, int year, char **files, int n_files, int *n_args);
+char *expand_word(char *word, size_t length, char *tile, char *year, char *file);
+int run_command(char **argv);
+int scene_year(char *file);
+
+
+int main ( int argc, char *argv[] ){
+args_t args;
+watcher_t watcher;
+time_t since;
+struct stat st;
+dir_t dir;
+char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+
+  parse_args(argc, argv, &args);
+
+  watcher.args = &args;
+  watcher.n_tiles = 0;
+  watcher.tile = NULL;
+  watcher.n_arrivals = 0;
+  watcher.size_arrivals = 0;
+  watcher.arrival = NULL;
+  watcher.collected = time(NULL);
+
+  // pairs written after the stamp landed while no watcher was running
+  since = watcher.collected;
+
+  if (args.stamp[0] != '\0'){
+    if (stat(args.stamp, &st) == 0){
+      since = st.st_mtime;
+    } else {
+      FILE *fp = fopen(args.stamp, "w");
+      if (fp == NULL){
+        fprintf(stderr, "Unable to create stamp file %s.\n", args.stamp);
+        exit(FAILURE);
+      }
+      fclose(fp);
+    }
+  }
+
+  if ((watcher.fd = inotify_init1(IN_CLOEXEC)) < 0){
+    fprintf(stderr, "Unable to initialize inotify.\n");
+    exit(FAILURE);
+  }
+
+  // new tiles
+  if ((watcher.wd_cube = inotify_add_watch(watcher.fd, args.dir_cube, IN_CREATE | IN_MOVED_TO | IN_ONLYDIR)) < 0){
+    fprintf(stderr, "Unable to watch datacube directory %s.\n", args.dir_cube);
+    exit(FAILURE);
+  }
+
+  if (args.n_tiles > 0){
+    for (int t=0; t<args.n_tiles; t++){
+      concat_string_2(buffer, sizeof(buffer), args.dir_cube, args.tiles[t], "/");
+      if (!fileexist(buffer)){
+        printf("Tile %s does not exist yet.\n", args.tiles[t]);
+        continue;
+      }
+      watch_tile(&watcher, args.tiles[t], since);
+    }
+  } else {
+    if (read_dir(&dir, args.dir_cube, "", NULL) != SUCCESS){
+      fprintf(stderr, "Could not list datacube directory %s.\n", args.dir_cube);
+      exit(FAILURE);
+    }
+    for (int i=0; i<dir.n; i++){
+      if (dir.files[i][0] == '.' || !accept_tile(&watcher, dir.files[i])) continue;
+      if (stat(dir.paths[i], &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+      watch_tile(&watcher, dir.files[i], since);
+    }
+    free_dir(&dir);
+  }
+
+  printf("Watching %d tiles in %s.\n", watcher.n_tiles, args.dir_cube);
+  fflush(stdout);
+
+  while (true){
+
+    struct pollfd pfd = { watcher.fd, POLLIN, 0 };
+    int ready = poll(&pfd, 1, 1000);
+
+    if (ready < 0 && errno != EINTR){
+      fprintf(stderr, "Unable to wait for inotify events.\n");
+      exit(FAILURE);
+    }
+
+    if (ready > 0){
+
+      ssize_t length = read(watcher.fd, buffer, sizeof(buffer));
+
+      if (length < 0 && errno != EINTR){
+        fprintf(stderr, "Unable to read inotify events.\n");
+        exit(FAILURE);
+      }
+
+      for (char *ptr=buffer; length>0 && ptr<buffer+length; ){
+
+        struct inotify_event *event = (struct inotify_event*)ptr;
+        ptr += sizeof(struct inotify_event) + event->len;
+
+        // events were lost, look for pairs that were written since the last pass
+        if (event->mask & IN_Q_OVERFLOW){
+          printf("inotify queue overflowed, rescanning all tiles.\n");
+          for (int t=0; t<watcher.n_tiles; t++){
+            if (watcher.tile[t].wd < 0) continue;
+            if (read_dir(&dir, watcher.tile[t].dir, "", NULL) != SUCCESS) continue;
+            for (int i=0; i<dir.n; i++) note_scene(&watcher, t, dir.files[i], watcher.collected);
+            free_dir(&dir);
+          }
+          continue;
+        }
+
+        if (event->len == 0 && !(event->mask & IN_IGNORED)) continue;
+
+        if (event->wd == watcher.wd_cube){
+          if ((event->mask & IN_ISDIR) && event->name[0] != '.' && accept_tile(&watcher, event->name)){
+            printf("New tile %s.\n", event->name);
+            watch_tile(&watcher, event->name, 0);
+          }
+          continue;
+        }
+
+        for (int t=0; t<watcher.n_tiles; t++){
+          if (watcher.tile[t].wd != event->wd) continue;
+          if (event->mask & IN_IGNORED){
+            watcher.tile[t].wd = -1;
+          } else {
+            note_scene(&watcher, t, event->name, 0);
+          }
+          break;
+        }
+
+      }
+
+    }
+
+    time_t now = time(NULL);
+
+    check_arrivals(&watcher, now);
+
+    if (pass_due(&watcher, now)) run_pass(&watcher, now);
+
+  }
+
+  return SUCCESS;
+}
+
+
+/** Is the tile watched?
+--- watcher: watcher
+--- name:    tile name
++++ Return:  true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool accept_tile(watcher_t *watcher, char *name){
+args_t *args = watcher->args;
+
+
+  if (args->n_tiles == 0) return true;
+
+  for (int t=0; t<args->n_tiles; t++){
+    if (strcmp(args->tiles[t], name) == 0) return true;
+  }
+
+  return false;
+}
+
+
+/** Watch a tile
++++ This function watches the directory of a tile for images that were
++++ written or moved there, and notes the pairs that are already there and
++++ were written after the given time, e.g. while the watch was added.
+--- watcher: watcher (modified)
+--- name:    tile name
+--- since:   time after which existing pairs are noted
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void watch_tile(watcher_t *watcher, char *name, time_t since){
+watched_tile_t *tile = NULL;
+dir_t dir;
+int t;
+
+
+  for (t=0; t<watcher->n_tiles; t++){
+    if (strcmp(watcher->tile[t].name, name) == 0) break;
+  }
+
+  if (t == watcher->n_tiles){
+    if (watcher->n_tiles == 0){
+      alloc((void**)&watcher->tile, 1, sizeof(watched_tile_t));
+    } else {
+      re_alloc((void**)&watcher->tile, watcher->n_tiles, watcher->n_tiles + 1, sizeof(watched_tile_t));
+    }
+    watcher->n_tiles++;
+  }
+
+  tile = &watcher->tile[t];
+  copy_string(tile->name, STRLEN, name);
+  concat_string_2(tile->dir, STRLEN, watcher->args->dir_cube, name, "/");
+
+  if ((tile->wd = inotify_add_watch(watcher->fd, tile->dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR)) < 0){
+    fprintf(stderr, "Unable to watch tile directory %s.\n", tile->dir);
+    exit(FAILURE);
+  }
+
+  if (read_dir(&dir, tile->dir, "", NULL) != SUCCESS){
+    fprintf(stderr, "Could not list tile directory %s.\n", tile->dir);
+    exit(FAILURE);
+  }
+
+  for (int i=0; i<dir.n; i++) note_scene(watcher, t, dir.files[i], since);
+
+  free_dir(&dir);
+
+  return;
+}
+
+
+/** Note a written image
++++ This function notes the BOA/QAI pair of an image that was written, if
++++ both images exist. A pair that is already waiting is debounced again,
++++ and retried without delay if its command failed.
+--- watcher: watcher (modified)
+--- tile:    watched tile
+--- file:    file name of the BOA or QAI image
+--- since:   only note pairs that were written after this time, 0 for all
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void note_scene(watcher_t *watcher, int tile, char *file, time_t since){
+args_t *args = watcher->args;
+char fname[STRLEN];
+char ext[STRLEN];
+char path_reflectance[STRLEN];
+char path_quality[STRLEN];
+struct stat st[2];
+arrival_t *arrival = NULL;
+int year;
+
+
+  extension2(file, ext, STRLEN);
+  if (strcmp(ext, ".tif") != 0) return;
+  if ((year = scene_year(file)) < 0) return;
+
+  // BOA image: QAI with BOA in the file name
+  copy_string(fname, STRLEN, file);
+  if (strstr(fname, "QAI") != NULL) replace_string(fname, "QAI", "BOA", STRLEN);
+  if (strstr(fname, "BOA") == NULL) return;
+  if (args->pattern[0] != '\0' && strstr(fname, args->pattern) == NULL) return;
+
+  concat_string_2(path_reflectance, STRLEN, watcher->tile[tile].dir, fname, "/");
+  replace_string(fname, "BOA", "QAI", STRLEN);
+  concat_string_2(path_quality, STRLEN, watcher->tile[tile].dir, fname, "/");
+
+  if (stat(path_reflectance, &st[0]) != 0 || stat(path_quality, &st[1]) != 0) return;
+
+  // change time, as copies may keep the modification time of the source
+  if (st[0].st_ctime <= since && st[1].st_ctime <= since) return;
+
+  time_t now = time(NULL);
+
+  for (int a=0; a<watcher->n_arrivals; a++){
+    if (strcmp(watcher->arrival[a].path_reflectance, path_reflectance) == 0){
+      arrival = &watcher->arrival[a];
+      break;
+    }
+  }
+
+  if (arrival == NULL){
+
+    if (watcher->n_arrivals == watcher->size_arrivals){
+      int size = (watcher->size_arrivals > 0) ? watcher->size_arrivals * 2 : 64;
+      if (watcher->arrival == NULL){
+        alloc((void**)&watcher->arrival, size, sizeof(arrival_t));
+      } else {
+        re_alloc((void**)&watcher->arrival, watcher->size_arrivals, size, sizeof(arrival_t));
+      }
+      watcher->size_arrivals = size;
+    }
+
+    arrival = &watcher->arrival[watcher->n_arrivals++];
+    arrival->tile = tile;
+    arrival->year = year;
+    copy_string(arrival->path_reflectance, STRLEN, path_reflectance);
+    copy_string(arrival->path_quality, STRLEN, path_quality);
+    arrival->first_event = now;
+
+  }
+
+  for (int i=0; i<2; i++){
+    arrival->size[i] = st[i].st_size;
+    arrival->mtime[i] = st[i].st_mtime;
+  }
+  arrival->changed = (st[0].st_ctime > st[1].st_ctime) ? st[0].st_ctime : st[1].st_ctime;
+  arrival->last_event = now;
+  arrival->retry = 0;
+
+  return;
+}
+
+
+/** Check the waiting pairs
++++ This function debounces pairs whose images changed since the last
++++ check, e.g. writers that do not close the files in between, and drops
++++ pairs whose images were removed. Changed pairs whose command failed
++++ are retried without delay.
+--- watcher: watcher (modified)
+--- now:     current time
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void check_arrivals(watcher_t *watcher, time_t now){
+struct stat st[2];
+int n = 0;
+
+
+  for (int a=0; a<watcher->n_arrivals; a++){
+
+    arrival_t *arrival = &watcher->arrival[a];
+
+    if (stat(arrival->path_reflectance, &st[0]) != 0 ||
+        stat(arrival->path_quality, &st[1]) != 0) continue;
+
+    for (int i=0; i<2; i++){
+      if (st[i].st_size != arrival->size[i] || st[i].st_mtime != arrival->mtime[i]){
+        arrival->size[i] = st[i].st_size;
+        arrival->mtime[i] = st[i].st_mtime;
+        if (st[i].st_ctime > arrival->changed) arrival->changed = st[i].st_ctime;
+        arrival->last_event = now;
+        arrival->retry = 0;
+      }
+    }
+
+    if (n != a) memcpy(&watcher->arrival[n], arrival, sizeof(arrival_t));
+    n++;
+
+  }
+
+  watcher->n_arrivals = n;
+
+  return;
+}
+
+
+/** Is a pass due?
++++ A pass is due once all waiting pairs are complete, i.e. a burst of
++++ arrivals is processed in one pass, or once a complete pair waited for
++++ the maximum delay. Pairs whose command failed are left out until their
++++ retry is due.
+--- watcher: watcher
+--- now:     current time
++++ Return:  true/false
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+bool pass_due(watcher_t *watcher, time_t now){
+args_t *args = watcher->args;
+bool all_complete = true, overdue = false, any = false;
+
+
+  for (int a=0; a<watcher->n_arrivals; a++){
+
+    arrival_t *arrival = &watcher->arrival[a];
+    if (arrival->retry > now) continue;
+
+    bool complete = now - arrival->last_event >= args->debounce;
+
+    if (!complete) all_complete = false;
+    if (complete && now - arrival->first_event >= args->max_delay) overdue = true;
+    any = true;
+
+  }
+
+  return any && (all_complete || overdue);
+}
+
+
+/** Process the complete pairs
++++ This function runs the command once per tile and year of the complete
++++ pairs, one after another. Pairs that arrive meanwhile are processed in
++++ the next pass. Pairs whose command failed are kept, and retried after
++++ the maximum delay. The stamp is held before the pairs that are still
++++ waiting, such that a restart picks them up again.
+--- watcher: watcher (modified)
+--- now:     current time
++++ Return:  void
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+void run_pass(watcher_t *watcher, time_t now){
+args_t *args = watcher->args;
+bool *complete = NULL;
+bool *done = NULL;
+char **files = NULL;
+int *member = NULL;
+int n_complete = 0, n_failed = 0, n = 0;
+
+
+  alloc((void**)&complete, watcher->n_arrivals, sizeof(bool));
+  alloc((void**)&done, watcher->n_arrivals, sizeof(bool));
+  alloc((void**)&files, watcher->n_arrivals, sizeof(char*));
+  alloc((void**)&member, watcher->n_arrivals, sizeof(int));
+
+  for (int a=0; a<watcher->n_arrivals; a++){
+    complete[a] = watcher->arrival[a].retry <= now && 
+                  now - watcher->arrival[a].last_event >= args->debounce;
+    if (complete[a]) n_complete++;
+  }
+
+  watcher->collected = now;
+
+  printf("Processing %d new scenes.\n", n_complete);
+
+  for (int a=0; a<watcher->n_arrivals; a++){
+
+    if (!complete[a] || done[a]) continue;
+
+    arrival_t *group = &watcher->arrival[a];
+    int n_files = 0, n_args = 0;
+
+    // all complete pairs of the same tile and year
+    for (int b=a; b<watcher->n_arrivals; b++){
+      if (!complete[b] || done[b]) continue;
+      if (watcher->arrival[b].tile != group->tile || watcher->arrival[b].year != group->year) continue;
+      member[n_files] = b;
+      files[n_files++] = watcher->arrival[b].path_reflectance;
+      done[b] = true;
+    }
+
+    char **argv = expand_pass(args->command, watcher->tile[group->tile].name, group->year, files, n_files, &n_args);
+
+    printf("Tile %s, year %d: %d new scenes.\n", watcher->tile[group->tile].name, group->year, n_files);
+    fflush(stdout);
+
+    int status = run_command(argv);
+
+    if (status != 0){
+      fprintf(stderr, "Command for tile %s, year %d failed with status %d, retrying in %d seconds.\n",
+        watcher->tile[group->tile].name, group->year, status, args->max_delay);
+      for (int f=0; f<n_files; f++){
+        watcher->arrival[member[f]].retry = now + args->max_delay;
+        complete[member[f]] = false;
+        done[member[f]] = false;
+      }
+      n_failed++;
+    }
+
+    for (int i=0; i<n_args; i++) free((void*)argv[i]);
+    free((void*)argv);
+
+  }
+
+  // keep the pairs that were not complete yet, or failed
+  for (int a=0; a<watcher->n_arrivals; a++){
+    if (done[a]) continue;
+    if (n != a) memcpy(&watcher->arrival[n], &watcher->arrival[a], sizeof(arrival_t));
+    n++;
+  }
+  watcher->n_arrivals = n;
+
+  // restarts process all pairs changed after the stamp
+  if (args->stamp[0] != '\0'){
+    time_t stamp = now;
+    for (int a=0; a<watcher->n_arrivals; a++){
+      if (watcher->arrival[a].changed - 1 < stamp) stamp = watcher->arrival[a].changed - 1;
+    }
+    struct utimbuf times = { stamp, stamp };
+    if (utime(args->stamp, &times) != 0){
+      fprintf(stderr, "Unable to update stamp file %s.\n", args->stamp);
+    }
+  }
+
+  printf("Pass finished, %d commands failed, %d scenes waiting.\n", n_failed, watcher->n_arrivals);
+  fflush(stdout);
+
+  free((void*)complete);
+  free((void*)done);
+  free((void*)files);
+  free((void*)member);
+
+  return;
+}
+
+
+/** Expand the command of a pass
++++ This function splits the command into words at blanks, and replaces
++++ {tile}, {year} and {files} in each word. A word with {files} is
++++ repeated for each new BOA image. The words are arguments as they are,
++++ there is no shell, thus paths need no quoting.
+--- command: command template
+--- tile:    tile name
+--- year:    year
+--- files:   new BOA images
+--- n_files: number of new BOA images
+--- n_args:  number of arguments (returned)
++++ Return:  NULL-terminated arguments, free each and the array after use
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+char **expand_pass(char *command, char *tile, int year, char **files, int n_files, int *n_args){
+char cyear[16];
+char **argv = NULL;
+int n = 0, size = 0;
+
+
+  snprintf(cyear, sizeof(cyear), "%d", year);
+
+  // enough for every word, with every word repeated for each file
+  for (char *c=command; *c!='\0'; c++){
+    if (!isspace((unsigned char)*c) && (c == command || isspace((unsigned char)c[-1]))) size++;
+  }
+  size = size * (n_files + 1) + 1;
+
+  alloc((void**)&argv, size, sizeof(char*));
+
+  for (char *c=command; *c!='\0'; ){
+
+    if (isspace((unsigned char)*c)){ c++; continue; }
+
+    char *word = c;
+    while (*c != '\0' && !isspace((unsigned char)*c)) c++;
+    size_t length = c - word;
+
+    bool has_files = false;
+    for (size_t k=0; k+7<=length; k++){
+      if (strncmp(word + k, "{files}", 7) == 0) has_files = true;
+    }
+
+    if (has_files){
+      for (int f=0; f<n_files; f++) argv[n++] = expand_word(word, length, tile, cyear, files[f]);
+    } else {
+      argv[n++] = expand_word(word, length, tile, cyear, NULL);
+    }
+
+  }
+
+  argv[n] = NULL;
+  *n_args = n;
+
+  return argv;
+}
+
+
+/** Expand the placeholders of one word
+--- word:   first character of the word
+--- length: length of the word
+--- tile:   tile name
+--- year:   year
+--- file:   BOA image for {files}, or NULL
++++ Return: expanded word, free after use
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+char *expand_word(char *word, size_t length, char *tile, char *year, char *file){
+char *expanded = NULL;
+size_t size, n = 0;
+
+
+  // every placeholder is at least 6 characters long
+  size = length + 1 + (length / 6 + 1) *
+    (strlen(tile) + strlen(year) + ((file != NULL) ? strlen(file) : 0));
+
+  alloc((void**)&expanded, size, sizeof(char));
+
+  for (size_t k=0; k<length; ){
+
+    if (length - k >= 6 && strncmp(word + k, "{tile}", 6) == 0){
+      n += snprintf(expanded + n, size - n, "%s", tile);
+      k += 6;
+    } else if (length - k >= 6 && strncmp(word + k, "{year}", 6) == 0){
+      n += snprintf(expanded + n, size - n, "%s", year);
+      k += 6;
+    } else if (length - k >= 7 && file != NULL && strncmp(word + k, "{files}", 7) == 0){
+      n += snprintf(expanded + n, size - n, "%s", file);
+      k += 7;
+    } else {
+      expanded[n++] = word[k++];
+    }
+
+  }
+
+  expanded[n] = '\0';
+
+  return expanded;
+}
+
+
+/** Run a command
++++ This function runs the command in a child process and waits for it.
+--- argv:   NULL-terminated arguments, the first is the program
++++ Return: exit status of the command, 128 + signal if it was killed
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int run_command(char **argv){
+pid_t pid;
+int wstatus;
+
+
+  if (argv[0] == NULL) return 127;
+
+  fflush(stdout);
+  fflush(stderr);
+
+  if ((pid = fork()) < 0){
+    fprintf(stderr, "Unable to start %s.\n", argv[0]);
+    return 127;
+  }
+
+  if (pid == 0){
+    execvp(argv[0], argv);
+    fprintf(stderr, "Unable to run %s.\n", argv[0]);
+    _exit(127);
+  }
+
+  while (waitpid(pid, &wstatus, 0) < 0){
+    if (errno != EINTR){
+      fprintf(stderr, "Unable to wait for %s.\n", argv[0]);
+      return 127;
+    }
+  }
+
+  if (WIFEXITED(wstatus)) return WEXITSTATUS(wstatus);
+  if (WIFSIGNALED(wstatus)) return 128 + WTERMSIG(wstatus);
+
+  return 127;
+}
+
+
+/** Year of a scene
++++ FORCE file names start with the acquisition date, e.g. 20180701_...
+--- file:   file name
++++ Return: year, -1 if the file name does not start with a date
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int scene_year(char *file){
+char cyear[5];
+
+
+  for (int c=0; c<8; c++){
+    if (!isdigit((unsigned char)file[c])) return -1;
+  }
+  if (file[8] != '_') return -1;
+
+  memcpy(cyear, file, 4);
+  cyear[4] = '\0';
+
+  return atoi(cyear);
+}
+
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "utils/const.h"
+#include "utils/dir.h"
+#include "utils/queue.h"
+#include "utils/string.h"
+#include "args/args_worker.h"
+
+
+int run_job(args_t *args, job_t *job, char *command, bool *lost);
+
+
+int main ( int argc, char *argv[] ){
+args_t args;
+char host[_JOB_NAMELEN_ - 16];
+char worker[_JOB_NAMELEN_];
+char command[STRLEN];
+job_t job;
+int n_done = 0, n_failed = 0;
+
+
+  parse_args(argc, argv, &args);
+
+  if (gethostname(host, sizeof(host)) != 0) copy_string(host, sizeof(host), "localhost");
+  host[sizeof(host) - 1] = '\0';
+  snprintf(worker, sizeof(worker), "%s:%d", host, (int)getpid());
+
+  while (true){
+
+    // with -w, the queue may not have been created yet
+    if (!fileexist(args.queue)){
+      sleep(args.poll);
+      continue;
+    }
+
+    int state = lease_job(args.queue, worker, args.lease, &job);
+
+    if (state == _QUEUE_DRAINED_ && !args.wait) break;
+
+    if (state != _QUEUE_LEASED_){
+      sleep(args.poll);
+      continue;
+    }
+
+    printf("Worker %s: job %d (%s, %d, %s), attempt %d.\n", worker,
+      job.id, job.tile, job.year, job.stage, job.attempts);
+
+    int status;
+    bool lost = false;
+
+    if (expand_command(args.command, &job, command, STRLEN) != SUCCESS){
+      fprintf(stderr, "Command of job %d is too long.\n", job.id);
+      status = 127;
+    } else {
+      status = run_job(&args, &job, command, &lost);
+    }
+
+    if (lost) continue;
+
+    if (status == 0){
+      n_done++;
+    } else {
+      printf("Worker %s: job %d (%s, %d, %s) exited with %d.\n", worker,
+        job.id, job.tile, job.year, job.stage, status);
+      n_failed++;
+    }
+
+    finish_job(args.queue, &job, status);
+
+  }
+
+  printf("Worker %s: queue drained, %d jobs done, %d attempts failed.\n", worker, n_done, n_failed);
+
+  exit(SUCCESS);
+}
+
+
+/** Run a job
++++ This function runs the command of a job in its own process group, and
++++ renews the lease while the command runs. If the lease was lost, the
++++ job was reassigned, thus the command is stopped.
+--- args:    arguments
+--- job:     leased job
+--- command: expanded command
+--- lost:    was the lease lost? (returned)
++++ Return:  exit status of the command, 128 + signal if it was killed
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++**/
+int run_job(args_t *args, job_t *job, char *command, bool *lost){
+pid_t pid;
+int wstatus, elapsed = 0;
+int heartbeat = args->lease / 3;
+
+
+  fflush(stdout);
+  fflush(stderr);
+
+  if ((pid = fork()) < 0){
+    fprintf(stderr, "Unable to start job %d.\n", job->id);
+    exit(FAILURE);
+  }
+
+  if (pid == 0){
+    setpgid(0, 0);
+    execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+    _exit(127);
+  }
+
+  setpgid(pid, pid);
+
+  while (true){
+
+    pid_t result = waitpid(pid, &wstatus, WNOHANG);
+
+    if (result == pid) break;
+
+    if (result < 0 && errno != EINTR){
+      fprintf(stderr, "Unable to wait for job %d.\n", job->id);
+      exit(FAILURE);
+    }
+
+    sleep(1);
+
+    if (++elapsed < heartbeat) continue;
+    elapsed = 0;
+
+    if (renew_lease(args->queue, job, args->lease) != SUCCESS){
+      printf("Lease of job %d (%s, %d, %s) was lost, stopping the command.\n",
+        job->id, job->tile, job->year, job->stage);
+      kill(-pid, SIGTERM);
+      waitpid(pid, &wstatus, 0);
+      *lost = true;
+      return -1;
+    }
+
+  }
+
+  if (WIFEXITED(wstatus)) return WEXITSTATUS(wstatus);
+  if (WIFSIGNALED(wstatus)) return 128 + WTERMSIG(wstatus);
+
+  return -1;
+}
+
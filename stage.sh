@@ -0,0 +1,102 @@
+#!/bin/bash
+
+# runs one stage of one tile and year, i.e. one job of the worker, e.g.
+#   ${bin_dir}/worker -q /shared/queue -c "./stage.sh {stage} {tile} {year}"
+# the stages are those of the yearly loop in workflow.sh:
+#   init                  = mask, initial reference and indices of a year
+#                           before the first detection year (2015..2017)
+#   reference_period      = reference period and coefficients of the year before
+#   spectral_index        = indices of the year
+#   disturbance_detection = disturbances of the year, updated and combined mask
+
+stage=$1
+tile=$2
+this_year=$3
+
+cube_dir="/nvme2/ahsoka/gi-sds/testdata"
+mask_dir="/data/ahsoka/eocp/borkenkaefer/forst"
+mask="forest.tif"
+out_dir="$HOME/temp/beetle-with-reverse-5/${tile}"
+
+bin_dir="src/temp/bin"
+
+# a job can be retried, or re-run by the coordinator, only redo what changed
+incremental="-f stat"
+
+set -e
+
+if [ $# -ne 3 ]; then
+  echo "Usage: $0 stage tile year" >&2
+  exit 1
+fi
+
+before_prev_year=$((this_year - 2))
+prev_year=$((this_year - 1))
+
+mkdir -p ${out_dir}
+
+case ${stage} in
+
+  init)
+
+    cp -p ${mask_dir}/${tile}/${mask} ${out_dir}/mask_${this_year}.tif
+
+    cp -p ${mask_dir}/${tile}/${mask} ${out_dir}/reference_period_${prev_year}.tif
+    cp -p ${mask_dir}/${tile}/${mask} ${out_dir}/coefficients_${prev_year}.tif
+
+    ${bin_dir}/spectral_index -j 64 ${incremental} \
+      -x ${out_dir}/mask_${this_year}.tif \
+      -d ${out_dir} \
+      ${cube_dir}/${tile}/${this_year}*SEN2[ABC]*BOA.tif
+    ;;
+
+  reference_period)
+
+    reference_input=()
+    for index in ${out_dir}/*_CREM.tif; do
+      index_name=$(basename ${index})
+      if [ ${index_name:0:4} -le ${prev_year} ]; then reference_input+=(${index}); fi
+    done
+
+    ${bin_dir}/reference_period -j 64 ${incremental} \
+      -p ${out_dir}/reference_period_${before_prev_year}.tif \
+      -r ${out_dir}/reference_period_${prev_year}.tif \
+      -i ${out_dir}/coefficients_${before_prev_year}.tif \
+      -c ${out_dir}/coefficients_${prev_year}.tif \
+      -x ${out_dir}/mask_${prev_year}.tif \
+      -m 3 -t 0 -y ${prev_year} -s 200 -n 3 \
+      ${reference_input[@]}
+    ;;
+
+  spectral_index)
+
+    ${bin_dir}/spectral_index -j 64 ${incremental} \
+      -x ${out_dir}/mask_${prev_year}.tif \
+      -d ${out_dir} \
+      ${cube_dir}/${tile}/${this_year}*SEN2[ABC]*BOA.tif
+    ;;
+
+  disturbance_detection)
+
+    combined_input=""
+    if [ -f ${out_dir}/disturbances_${prev_year}.tif ]; then
+      combined_input="-i ${out_dir}/disturbances_${prev_year}.tif"
+    fi
+
+    ${bin_dir}/disturbance_detection -j 64 ${incremental} \
+      -c ${out_dir}/coefficients_${prev_year}.tif \
+      -s ${out_dir}/reference_period_${prev_year}.tif \
+      -x ${out_dir}/mask_${prev_year}.tif \
+      -o ${out_dir}/disturbance_${this_year}.tif \
+      -u ${out_dir}/mask_${this_year}.tif \
+      ${combined_input} -k ${out_dir}/disturbances_${this_year}.tif \
+      -m 3 -t 0 -d 5 -r 500 -n 3 \
+      ${out_dir}/${this_year}*_CREM.tif
+    ;;
+
+  *)
+    echo "Unknown stage ${stage}." >&2
+    exit 1
+    ;;
+
+esac
@@ -8,9 +8,45 @@ out_dir="$HOME/temp/beetle-with-reverse-5"
 
 bin_dir="src/temp/bin"
 
+# "-f stat" or "-f hash" re-runs only the stages whose inputs or parameters
+# changed, e.g. after a scene was reprocessed upstream, and the stages down-
+# stream of them; each output has a manifest next to it (output.manifest)
+incremental=""
+
 set -e
 
-# boa and qai must be in the same order and match one-to-one
+# to back-process the whole history of a tile in one pass, compute the indices 
+# of all years with the initial mask and replay the yearly chain below, e.g.
+#   ${bin_dir}/replay -j 64 -x ${mask_dir}/${tile}/${mask} -o ${out_dir} -y 2018 \
+#     -m 3 -t 0 -s 200 -n 3 -d 5 -r 500 -c 3 ${out_dir}/*_CREM.tif
+# or run the whole chain in one process from the reflectance images, the index
+# and all intermediates stay in memory (-w writes them for debugging), e.g.
+#   ${bin_dir}/pipeline -j 64 -x ${mask_dir}/${tile}/${mask} -o ${out_dir} -y 2018 \
+#     -m 3 -t 0 -s 200 -n 3 -d 5 -r 500 -c 3 ${cube_dir}/${tile}/*SEN2[ABC]*BOA.tif
+# several tiles share one process and one memory budget (in MB) with
+#   ${bin_dir}/scheduler -j 64 -g 65536 -l ${cube_dir} -x ${mask_dir} -o ${out_dir} \
+#     -y 2018 -e 2023 -m 3 -t 0 -s 200 -n 3 -d 5 -r 500 -c 3 -p SEN2 X0055_Y0053 X0056_Y0053
+# to spread tiles over several nodes, enqueue jobs in a queue on a shared file
+# system and start workers on each node, stage.sh (next to this script, with
+# the same directories) runs one stage of one tile and year with the calls of
+# the loops below, the init stage is the first loop, e.g.
+#   ${bin_dir}/coordinator -q /shared/queue -y 2015 -e 2017 -s init X0055_Y0053 X0056_Y0053
+#   ${bin_dir}/coordinator -q /shared/queue -y 2018 -e 2023 \
+#     -s reference_period,spectral_index,disturbance_detection X0055_Y0053 X0056_Y0053
+#   ${bin_dir}/worker -q /shared/queue -c "./stage.sh {stage} {tile} {year}"
+# for near-real-time processing, run the index and detection for the scenes of
+# a tile and year as they land, nrt.sh (next to this script) gets the tile, the
+# year and the new BOA images, pairs that land in a burst are processed in one
+# pass, e.g.
+#   ${bin_dir}/watcher -l ${cube_dir} -c "./nrt.sh {tile} {year} {files}" -p SEN2 \
+#     -t ${out_dir}/watcher.stamp
+# small jobs like these are dominated by startup and reading the same masks and
+# coefficients, a resident server runs the stages and keeps those in memory,
+# the client takes the place of the stage executable, e.g.
+#   ${bin_dir}/server -s /tmp/hungrybeetle.sock -g 4096 -n 4 &
+#   ${bin_dir}/client -s /tmp/hungrybeetle.sock disturbance_detection -j 8 ...
+
+# qai images are found next to the boa images (BOA -> QAI in the file name)
 
 # compute the indices for 2015 and 2016 without reference period masking
 # this is just because it is too complicated to do in the bash loop
@@ -18,19 +54,15 @@ for this_year in {2015..2017}; do
 
   echo "Processing year ${this_year}..."
   prev_year=$((this_year - 1))
-  cp ${mask_dir}/${tile}/${mask} ${out_dir}/mask_${this_year}.tif
-
-  cp ${mask_dir}/${tile}/${mask} ${out_dir}/reference_period_${prev_year}.tif
-  cp ${mask_dir}/${tile}/${mask} ${out_dir}/coefficients_${prev_year}.tif
+  cp -p ${mask_dir}/${tile}/${mask} ${out_dir}/mask_${this_year}.tif
 
-  boa_files=$(ls ${cube_dir}/${tile}/${this_year}*SEN2[ABC]*BOA.tif | tr '\n' ' ')
-  qai_files=$(ls ${cube_dir}/${tile}/${this_year}*SEN2[ABC]*QAI.tif | tr '\n' ' ')
+  cp -p ${mask_dir}/${tile}/${mask} ${out_dir}/reference_period_${prev_year}.tif
+  cp -p ${mask_dir}/${tile}/${mask} ${out_dir}/coefficients_${prev_year}.tif
 
-  parallel --eta --link \
-    ${bin_dir}/spectral_index -r {1} -q {2} \
+  ${bin_dir}/spectral_index -j 64 ${incremental} \
     -x ${out_dir}/mask_${this_year}.tif \
-    -o ${out_dir}/{1/.}_CREM.tif \
-    ::: $boa_files ::: $qai_files
+    -d ${out_dir} \
+    ${cube_dir}/${tile}/${this_year}*SEN2[ABC]*BOA.tif
 
 
 done
@@ -44,51 +76,54 @@ for this_year in {2018..2025}; do
 
   echo "Processing year ${this_year}..."
 
-  # Generate reference period and coefficients from previous year's data
-  time ${bin_dir}/reference_period -j 64 \
+  # Generate reference period and coefficients from previous year's data,
+  # indices of later years exist when the workflow is re-run
+  reference_input=()
+  for index in ${out_dir}/*_CREM.tif; do
+    index_name=$(basename ${index})
+    if [ ${index_name:0:4} -le ${prev_year} ]; then reference_input+=(${index}); fi
+  done
+
+  time ${bin_dir}/reference_period -j 64 ${incremental} \
     -p ${out_dir}/reference_period_${before_prev_year}.tif \
     -r ${out_dir}/reference_period_${prev_year}.tif \
     -i ${out_dir}/coefficients_${before_prev_year}.tif \
     -c ${out_dir}/coefficients_${prev_year}.tif \
     -x ${out_dir}/mask_${prev_year}.tif \
     -m 3 -t 0 -y ${prev_year} -s 200 -n 3\
-    ${out_dir}/*_CREM.tif
+    ${reference_input[@]}
 
-  # Compute temporal variability from previous year's data
-  #time ${bin_dir}/temporal_variability -j 64 \
-  #  -o ${out_dir}/variability_${prev_year}.tif \
-  #  -r ${out_dir}/reference_period_${prev_year}.tif \
-  #  -x ${out_dir}/mask_${prev_year}.tif \
-  #  ${out_dir}/*_CREM.tif
+  # Temporal variability from previous year's data: add
+  #  -v ${out_dir}/variability_${prev_year}.tif
+  # to the reference_period call above, this computes it in the same pass
 
   # Now compute the indices for the current year
-  boa_files=$(ls ${cube_dir}/${tile}/${this_year}*SEN2[ABC]*BOA.tif | tr '\n' ' ')
-  qai_files=$(ls ${cube_dir}/${tile}/${this_year}*SEN2[ABC]*QAI.tif | tr '\n' ' ')
-
-  time parallel --eta --link \
-    ${bin_dir}/spectral_index -r {1} -q {2} \
+  time ${bin_dir}/spectral_index -j 64 ${incremental} \
     -x ${out_dir}/mask_${prev_year}.tif \
-    -o ${out_dir}/{1/.}_CREM.tif \
-    ::: $boa_files ::: $qai_files
+    -d ${out_dir} \
+    ${cube_dir}/${tile}/${this_year}*SEN2[ABC]*BOA.tif
 
 #-s ${out_dir}/variability_${prev_year}.tif \
-  # Finally, detect disturbances for the current year
-  time ${bin_dir}/disturbance_detection -j 64 \
+  # Finally, detect disturbances for the current year, 
+  # update the mask and merge into the combined disturbances in the same pass
+  combined_input=""
+  if [ -f ${out_dir}/disturbances_${prev_year}.tif ]; then
+    combined_input="-i ${out_dir}/disturbances_${prev_year}.tif"
+  fi
+
+  time ${bin_dir}/disturbance_detection -j 64 ${incremental} \
     -c ${out_dir}/coefficients_${prev_year}.tif \
     -s ${out_dir}/reference_period_${prev_year}.tif \
     -x ${out_dir}/mask_${prev_year}.tif \
     -o ${out_dir}/disturbance_${this_year}.tif \
+    -u ${out_dir}/mask_${this_year}.tif \
+    ${combined_input} -k ${out_dir}/disturbances_${this_year}.tif \
     -m 3 -t 0 -d 5 -r 500 -n 3 \
     ${out_dir}/${this_year}*_CREM.tif
 
-  time ${bin_dir}/update_mask \
-    -d ${out_dir}/disturbance_${this_year}.tif \
-    -x ${out_dir}/mask_${prev_year}.tif \
-    -o ${out_dir}/mask_${this_year}.tif
-
 done
 
 
 
-${bin_dir}/combine_disturbances ${out_dir}/disturbance_20*.tif -o ${out_dir}/disturbances.tif -j 16
+cp ${out_dir}/disturbances_${this_year}.tif ${out_dir}/disturbances.tif
 